@@ -102,7 +102,7 @@ int main(int argc, char* argv[]) {
                    "Load in byte to be inserted");
 
     clp.add_string('h', "hash-table", "H", hashtable,
-                   "Set hashtable: probing or bucket");
+                   "Set hashtable: probing, fingerprint, bucket or adaptive");
 
     clp.add_unsigned('w', "workers", "W", workers,
                      "Open hashtable with W workers, default = 1.");
@@ -127,6 +127,12 @@ int main(int argc, char* argv[]) {
         [&](api::Context& ctx) {
             if (hashtable == "bucket")
                 return RunBenchmark<core::ReduceTableImpl::BUCKET>(ctx, config);
+            else if (hashtable == "fingerprint")
+                return RunBenchmark<
+                    core::ReduceTableImpl::FINGERPRINT>(ctx, config);
+            else if (hashtable == "adaptive")
+                return RunBenchmark<
+                    core::ReduceTableImpl::ADAPTIVE>(ctx, config);
             else
                 return RunBenchmark<core::ReduceTableImpl::PROBING>(ctx, config);
         });
@@ -35,6 +35,12 @@ struct Record {
     bool operator < (const Record& b) const {
         return std::lexicographical_compare(key, key + 10, b.key, b.key + 10);
     }
+    //! first eight key bytes as big-endian integer for Sort(NormalizedKeyTag)
+    uint64_t normalized_key() const {
+        uint64_t k = 0;
+        for (size_t i = 0; i < 8; ++i) k = (k << 8) | key[i];
+        return k;
+    }
     friend std::ostream& operator << (std::ostream& os, const Record& c) {
         return os << tlx::hexdump(c.key, 10);
     }
@@ -51,6 +57,14 @@ struct RecordSigned {
     bool operator < (const RecordSigned& b) const {
         return std::lexicographical_compare(key, key + 10, b.key, b.key + 10);
     }
+    //! first eight key bytes as big-endian integer for Sort(NormalizedKeyTag),
+    //! the sign bits are flipped to order signed characters correctly.
+    uint64_t normalized_key() const {
+        uint64_t k = 0;
+        for (size_t i = 0; i < 8; ++i)
+            k = (k << 8) | (static_cast<uint8_t>(key[i]) ^ 0x80);
+        return k;
+    }
     friend std::ostream& operator << (std::ostream& os, const RecordSigned& c) {
         return os << tlx::hexdump(c.key, 10);
     }
@@ -174,7 +188,10 @@ int main(int argc, char* argv[]) {
 
                 auto r =
                     Generate(ctx, size / sizeof(Record), GenerateRecord())
-                    .Sort();
+                    .Sort(NormalizedKeyTag,
+                          [](const Record& rec) {
+                              return rec.normalized_key();
+                          });
 
                 if (output.size())
                     r.WriteBinary(output);
@@ -183,7 +200,11 @@ int main(int argc, char* argv[]) {
             }
             else {
                 if (use_signed_char) {
-                    auto r = ReadBinary<RecordSigned>(ctx, input).Sort();
+                    auto r = ReadBinary<RecordSigned>(ctx, input).Sort(
+                        NormalizedKeyTag,
+                        [](const RecordSigned& rec) {
+                            return rec.normalized_key();
+                        });
 
                     if (output.size())
                         r.WriteBinary(output);
@@ -191,7 +212,9 @@ int main(int argc, char* argv[]) {
                         r.Size();
                 }
                 else {
-                    auto r = ReadBinary<Record>(ctx, input).Sort();
+                    auto r = ReadBinary<Record>(ctx, input).Sort(
+                        NormalizedKeyTag,
+                        [](const Record& rec) { return rec.normalized_key(); });
 
                     if (output.size())
                         r.WriteBinary(output);
@@ -9,9 +9,11 @@
  ******************************************************************************/
 
 #include <thrill/api/all_gather.hpp>
+#include <thrill/api/collapse.hpp>
 #include <thrill/api/generate.hpp>
 #include <thrill/api/group_by_key.hpp>
 #include <thrill/api/group_to_index.hpp>
+#include <thrill/api/reduce_by_key.hpp>
 #include <thrill/api/size.hpp>
 #include <thrill/api/sum.hpp>
 #include <thrill/common/logger.hpp>
@@ -124,6 +126,57 @@ TEST(GroupByNode, Median) {
     api::RunLocalTests(start_func);
 }
 
+struct HashGroupByConfig : public DefaultGroupByConfig {
+    static constexpr GroupByImpl group_by_impl_ = GroupByImpl::HASH;
+};
+
+TEST(GroupByNode, HashMedian) {
+
+    auto start_func =
+        [](Context& ctx) {
+            size_t n = 9999;
+            static constexpr size_t m = 31;
+
+            auto sizets = Generate(ctx, n);
+
+            auto modulo_keyfn = [](size_t in) { return (in % m); };
+
+            // groups are not sorted by key, hence return the key as well
+            auto median_fn =
+                [](auto& r, size_t key) {
+                    std::vector<size_t> all;
+                    while (r.HasNext()) {
+                        all.push_back(r.Next());
+                    }
+                    std::sort(std::begin(all), std::end(all));
+                    return std::make_pair(key, all[all.size() / 2]);
+                };
+
+            using Result = std::pair<size_t, size_t>;
+
+            auto grouped = sizets.GroupByKey<Result>(
+                NoLocationDetectionTag, modulo_keyfn, median_fn,
+                std::hash<size_t>(), HashGroupByConfig());
+            std::vector<Result> out_vec = grouped.AllGather();
+            std::sort(out_vec.begin(), out_vec.end());
+
+            // compute vector with expected results
+            std::vector<std::vector<size_t> > res_vecvec(m);
+            for (size_t t = 0; t < n; ++t) {
+                res_vecvec[t % m].push_back(t);
+            }
+
+            ASSERT_EQ(m, out_vec.size());
+            for (size_t i = 0; i < m; ++i) {
+                ASSERT_EQ(i, out_vec[i].first);
+                ASSERT_EQ(res_vecvec[i][res_vecvec[i].size() / 2],
+                          out_vec[i].second);
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
 TEST(GroupByNode, GroupToIndexCorrectResults) {
 
     auto start_func =
@@ -195,4 +248,60 @@ TEST(GroupByNode, GroupToIndexCorrectSize) {
     api::RunLocalTests(start_func);
 }
 
+//! stateless key extractor, which ReduceByKey() declares its output
+//! partitioned by.
+struct KeyModulo100 {
+    size_t operator () (const size_t& in) const { return in % 100; }
+};
+
+TEST(GroupByNode, KeyPartitionedSkipsShuffle) {
+
+    auto start_func =
+        [](Context& ctx) {
+            size_t n = 10000;
+
+            auto reduced = Generate(ctx, n).ReduceByKey(
+                KeyModulo100(),
+                [](const size_t& a, const size_t& b) { return std::min(a, b); });
+            ASSERT_TRUE(reduced.properties().IsPartitionedBy<KeyModulo100>());
+
+            auto count_fn =
+                [](auto& r, size_t /* key */) {
+                    size_t count = 0;
+                    while (r.HasNext()) {
+                        r.Next();
+                        ++count;
+                    }
+                    return count;
+                };
+
+            // one item per key after ReduceByKey()
+            std::vector<size_t> ones =
+                reduced.Keep().GroupByKey<size_t>(KeyModulo100(), count_fn)
+                .AllGather();
+            ASSERT_EQ(100u, ones.size());
+            for (const size_t& c : ones) ASSERT_EQ(1u, c);
+
+            // FlatMap() keeps the items on their worker, which the user declares
+            auto copies = reduced.FlatMap<size_t>(
+                [](const size_t& in, auto emit) {
+                    for (size_t i = 0; i < in + 1; ++i) emit(in + 100 * i);
+                })
+                          .AssumeKeyPartitioned(KeyModulo100());
+            ASSERT_TRUE(copies.properties().IsPartitionedBy<KeyModulo100>());
+
+            std::vector<size_t> counts =
+                copies.GroupByKey<size_t>(KeyModulo100(), count_fn)
+                .AllGather();
+
+            std::sort(counts.begin(), counts.end());
+            ASSERT_EQ(100u, counts.size());
+            for (size_t i = 0; i < counts.size(); ++i) {
+                ASSERT_EQ(i + 1, counts[i]);
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
 /******************************************************************************/
@@ -220,4 +220,168 @@ TEST(Join, DifferentTypes) {
     api::RunLocalTests(start_func);
 }
 
+template <JoinImpl join_impl>
+struct JoinImplConfig : public DefaultJoinConfig {
+    static constexpr JoinImpl join_impl_ = join_impl;
+};
+
+struct BroadcastJoinConfig : public DefaultJoinConfig {
+    static constexpr bool use_broadcast_ = true;
+};
+
+//! Join inputs with many items per key, of which not all have a partner.
+template <typename JoinConfig, bool LocationDetectionValue>
+void TestJoinManyKeys(size_t m, size_t n,
+                      const JoinConfig& join_config = JoinConfig()) {
+
+    auto start_func =
+        [m, n, &join_config](Context& ctx) {
+
+            using IntPair = std::pair<size_t, size_t>;
+
+            auto dia1 = Generate(ctx, m, [](const size_t& e) {
+                                     return IntPair(e % 100, e);
+                                 });
+
+            auto dia2 = Generate(ctx, n, [](const size_t& e) {
+                                     return IntPair(e % 150, e * e);
+                                 });
+
+            auto key_ex = [](const IntPair& input) {
+                              return input.first;
+                          };
+
+            auto join_fn = [](const IntPair& input1, const IntPair& input2) {
+                               return IntPair(input1.second, input2.second);
+                           };
+
+            auto joined = InnerJoin(
+                LocationDetectionFlag<LocationDetectionValue>(),
+                dia1, dia2, key_ex, key_ex, join_fn,
+                std::hash<size_t>(), join_config);
+            std::vector<IntPair> out_vec = joined.AllGather();
+            std::sort(out_vec.begin(), out_vec.end());
+
+            std::vector<IntPair> expected;
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    if (i % 100 == j % 150)
+                        expected.emplace_back(i, j * j);
+                }
+            }
+            std::sort(expected.begin(), expected.end());
+
+            ASSERT_EQ(expected, out_vec);
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Join, ManyKeysSortMerge) {
+    TestJoinManyKeys<JoinImplConfig<JoinImpl::SORT_MERGE>, true>(1000, 3000);
+}
+
+TEST(Join, ManyKeysHashBuildFirst) {
+    TestJoinManyKeys<JoinImplConfig<JoinImpl::HASH>, true>(1000, 3000);
+    TestJoinManyKeys<JoinImplConfig<JoinImpl::HASH>, false>(1000, 3000);
+}
+
+TEST(Join, ManyKeysHashBuildSecond) {
+    TestJoinManyKeys<JoinImplConfig<JoinImpl::HASH>, true>(3000, 1000);
+    TestJoinManyKeys<JoinImplConfig<JoinImpl::HASH>, false>(3000, 1000);
+}
+
+TEST(Join, ManyKeysAuto) {
+    TestJoinManyKeys<JoinImplConfig<JoinImpl::AUTO>, false>(3000, 1000);
+}
+
+TEST(Join, ManyKeysBroadcast) {
+    TestJoinManyKeys<BroadcastJoinConfig, true>(1000, 3000);
+    TestJoinManyKeys<BroadcastJoinConfig, false>(3000, 1000);
+}
+
+TEST(Join, ManyKeysBroadcastTooLarge) {
+    BroadcastJoinConfig config;
+    config.broadcast_max_bytes_ = 0;
+    TestJoinManyKeys<BroadcastJoinConfig, true>(1000, 3000, config);
+    TestJoinManyKeys<BroadcastJoinConfig, false>(3000, 1000, config);
+}
+
+struct BloomFilterJoinConfig : public DefaultJoinConfig {
+    static constexpr bool use_bloom_filter_ = true;
+};
+
+TEST(Join, ManyKeysBloomFilter) {
+    TestJoinManyKeys<BloomFilterJoinConfig, false>(1000, 3000);
+    TestJoinManyKeys<BloomFilterJoinConfig, false>(3000, 1000);
+}
+
+TEST(Join, ManyKeysBloomFilterTooLarge) {
+    BloomFilterJoinConfig config;
+    config.bloom_filter_max_bytes_ = 0;
+    TestJoinManyKeys<BloomFilterJoinConfig, false>(1000, 3000, config);
+    TestJoinManyKeys<BloomFilterJoinConfig, false>(3000, 1000, config);
+}
+
+struct HeavyKeysJoinConfig : public DefaultJoinConfig {
+    static constexpr bool use_heavy_keys_ = true;
+};
+
+//! Join inputs of which the first has a third of its items with key zero.
+template <typename JoinConfig, bool LocationDetectionValue>
+void TestJoinSkewedKeys(size_t m, size_t n) {
+
+    auto start_func =
+        [m, n](Context& ctx) {
+
+            using IntPair = std::pair<size_t, size_t>;
+
+            auto skewed_key = [](const size_t& e) {
+                                  return e % 3 == 0 ? 0 : e % 100;
+                              };
+
+            auto dia1 = Generate(ctx, m, [&skewed_key](const size_t& e) {
+                                     return IntPair(skewed_key(e), e);
+                                 });
+
+            auto dia2 = Generate(ctx, n, [](const size_t& e) {
+                                     return IntPair(e % 150, e * e);
+                                 });
+
+            auto key_ex = [](const IntPair& input) {
+                              return input.first;
+                          };
+
+            auto join_fn = [](const IntPair& input1, const IntPair& input2) {
+                               return IntPair(input1.second, input2.second);
+                           };
+
+            auto joined = InnerJoin(
+                LocationDetectionFlag<LocationDetectionValue>(),
+                dia1, dia2, key_ex, key_ex, join_fn,
+                std::hash<size_t>(), JoinConfig());
+            std::vector<IntPair> out_vec = joined.AllGather();
+            std::sort(out_vec.begin(), out_vec.end());
+
+            std::vector<IntPair> expected;
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    if (skewed_key(i) == j % 150)
+                        expected.emplace_back(i, j * j);
+                }
+            }
+            std::sort(expected.begin(), expected.end());
+
+            ASSERT_EQ(expected, out_vec);
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Join, SkewedKeysHeavyKeys) {
+    TestJoinSkewedKeys<HeavyKeysJoinConfig, true>(3000, 1000);
+    TestJoinSkewedKeys<HeavyKeysJoinConfig, false>(3000, 1000);
+    TestJoinSkewedKeys<HeavyKeysJoinConfig, false>(1000, 3000);
+}
+
 /******************************************************************************/
@@ -29,6 +29,7 @@
 #include <thrill/api/size.hpp>
 #include <thrill/api/sort.hpp>
 #include <thrill/api/sum.hpp>
+#include <thrill/api/top_k.hpp>
 #include <thrill/api/union.hpp>
 #include <thrill/api/window.hpp>
 
@@ -991,6 +992,69 @@ TEST(Operations, ActionFutures) {
     api::RunLocalTests(start_func);
 }
 
+TEST(Operations, TopK) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            std::default_random_engine generator(std::random_device { } ());
+            std::uniform_int_distribution<size_t> distribution(0, 1000);
+
+            auto integers = Generate(
+                ctx, 10000,
+                [&distribution, &generator](const size_t&) -> size_t {
+                    return distribution(generator);
+                }).Cache();
+
+            std::vector<size_t> all = integers.AllGather();
+            std::sort(all.begin(), all.end());
+
+            std::vector<size_t> smallest = integers.TopK(100);
+            ASSERT_EQ(100u, smallest.size());
+            ASSERT_TRUE(std::equal(smallest.begin(), smallest.end(),
+                                   all.begin()));
+
+            std::vector<size_t> largest =
+                integers.TopK(10, std::greater<size_t>());
+            ASSERT_EQ(10u, largest.size());
+            ASSERT_TRUE(std::equal(largest.begin(), largest.end(),
+                                   all.rbegin()));
+
+            // k larger than the DIA
+            Future<std::vector<size_t> > allf = integers.TopKFuture(20000);
+            ASSERT_EQ(all, allf.get());
+
+            ASSERT_EQ(0u, integers.TopK(0).size());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Operations, TopKNonDefaultConstructible) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            auto integers = Generate(
+                ctx, 10000,
+                [](const size_t& index) {
+                    return Integer((index * 7919) % 10000);
+                });
+
+            std::vector<Integer> smallest = integers.TopK(
+                50, [](const Integer& a, const Integer& b) {
+                    return a.value() < b.value();
+                });
+
+            ASSERT_EQ(50u, smallest.size());
+            for (size_t i = 0; i < smallest.size(); ++i) {
+                ASSERT_EQ(i, smallest[i].value());
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
 namespace thrill {
 namespace api {
 
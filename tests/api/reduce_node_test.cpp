@@ -12,6 +12,7 @@
 #include <gtest/gtest.h>
 #include <thrill/api/all_gather.hpp>
 #include <thrill/api/generate.hpp>
+#include <thrill/api/keyed_state.hpp>
 #include <thrill/api/reduce_by_key.hpp>
 #include <thrill/api/reduce_to_index.hpp>
 #include <thrill/api/size.hpp>
@@ -86,6 +87,10 @@ TEST(ReduceNode, ReduceModulo2CorrectResults) {
         TestReduceModulo2CorrectResults<ReduceTableImpl::BUCKET>());
     api::RunLocalTests(
         TestReduceModulo2CorrectResults<ReduceTableImpl::OLD_PROBING>());
+    api::RunLocalTests(
+        TestReduceModulo2CorrectResults<ReduceTableImpl::FINGERPRINT>());
+    api::RunLocalTests(
+        TestReduceModulo2CorrectResults<ReduceTableImpl::ADAPTIVE>());
 }
 
 //! Test sums of integers 0..n-1 for n=100 in 1000 buckets in the reduce table
@@ -135,6 +140,183 @@ TEST(ReduceNode, ReduceModuloPairsCorrectResults) {
         TestReduceModuloPairsCorrectResults<ReduceTableImpl::BUCKET>());
     api::RunLocalTests(
         TestReduceModuloPairsCorrectResults<ReduceTableImpl::OLD_PROBING>());
+    api::RunLocalTests(
+        TestReduceModuloPairsCorrectResults<ReduceTableImpl::FINGERPRINT>());
+    api::RunLocalTests(
+        TestReduceModuloPairsCorrectResults<ReduceTableImpl::ADAPTIVE>());
+}
+
+TEST(ReduceNode, ReduceStringsWithArenaTable) {
+    auto start_func =
+        [](Context& ctx) {
+            static constexpr size_t test_size = 100000u;
+            static constexpr size_t mod_size = 1000u;
+
+            using StringPair = std::pair<std::string, size_t>;
+
+            auto words = Generate(
+                ctx, test_size,
+                [](const size_t& index) {
+                    std::string w = std::to_string(index % mod_size);
+                    if (index % 3 == 0) w += "-a-rather-long-word-suffix";
+                    return StringPair(w, 1);
+                });
+
+            auto config = core::DefaultReduceConfigSelect<
+                ReduceTableImpl::ARENA>();
+
+            // the arena table requires VolatileKey
+            auto by_key = words.ReduceByKey(
+                VolatileKeyTag,
+                [](const StringPair& p) { return p.first; },
+                [](const StringPair& a, const StringPair& b) {
+                    return StringPair(a.first, a.second + b.second);
+                },
+                config);
+
+            auto by_pair = words.ReducePair(
+                [](const size_t& a, const size_t& b) { return a + b; },
+                config);
+
+            for (std::vector<StringPair> out_vec :
+                 { by_key.AllGather(), by_pair.AllGather() })
+            {
+                std::sort(out_vec.begin(), out_vec.end());
+
+                // keys with and without suffix, as 3 does not divide 1000
+                ASSERT_EQ(2 * mod_size, out_vec.size());
+
+                size_t total = 0;
+                for (const StringPair& p : out_vec) total += p.second;
+                ASSERT_EQ(test_size, total);
+                ASSERT_TRUE(std::adjacent_find(
+                                out_vec.begin(), out_vec.end(),
+                                [](const StringPair& a, const StringPair& b) {
+                                    return a.first == b.first;
+                                }) == out_vec.end());
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+struct HotKeysReduceConfig : public core::DefaultReduceConfig {
+    static constexpr bool use_hot_keys_ = true;
+    static constexpr size_t hot_key_sample_size_ = 1024;
+};
+
+TEST(ReduceNode, ReduceSkewedPairsWithHotKeys) {
+    auto start_func =
+        [](Context& ctx) {
+            static constexpr size_t test_size = 200000u;
+            static constexpr size_t cold_size = 5000u;
+
+            using IntPair = std::pair<size_t, size_t>;
+
+            // a third of the items has key 0, another third keys 1..7
+            auto key_of = [](size_t index) -> size_t {
+                              if (index % 3 == 0) return 0;
+                              if (index % 3 == 1) return 1 + index % 7;
+                              return 8 + index % cold_size;
+                          };
+
+            auto pairs = Generate(
+                ctx, test_size,
+                [key_of](const size_t& index) {
+                    return IntPair(key_of(index), 1);
+                });
+
+            auto reduced = pairs.ReducePair(
+                [](const size_t& a, const size_t& b) { return a + b; },
+                HotKeysReduceConfig());
+
+            std::vector<size_t> expected(8 + cold_size);
+            for (size_t i = 0; i < test_size; ++i)
+                ++expected[key_of(i)];
+
+            std::vector<IntPair> out_vec = reduced.AllGather();
+            std::sort(out_vec.begin(), out_vec.end());
+
+            ASSERT_EQ(expected.size(), out_vec.size());
+            for (size_t i = 0; i < out_vec.size(); ++i) {
+                ASSERT_EQ(i, out_vec[i].first);
+                ASSERT_EQ(expected[i], out_vec[i].second);
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+struct HostCombineReduceConfig : public core::DefaultReduceConfig {
+    static constexpr bool use_host_combine_ = true;
+};
+
+TEST(ReduceNode, ReduceModuloPairsWithHostCombine) {
+    auto start_func =
+        [](Context& ctx) {
+            static constexpr size_t test_size = 100000u;
+            static constexpr size_t mod_size = 1000u;
+            static constexpr size_t div_size = test_size / mod_size;
+
+            using IntPair = std::pair<size_t, size_t>;
+
+            auto integers = Generate(
+                ctx, test_size,
+                [](const size_t& index) {
+                    return IntPair(index % mod_size, index / mod_size);
+                });
+
+            auto reduced = integers.ReducePair(
+                [](const size_t& a, const size_t& b) { return a + b; },
+                HostCombineReduceConfig());
+
+            std::vector<IntPair> out_vec = reduced.AllGather();
+            std::sort(out_vec.begin(), out_vec.end());
+
+            ASSERT_EQ(mod_size, out_vec.size());
+            for (size_t i = 0; i < out_vec.size(); ++i) {
+                ASSERT_EQ(i, out_vec[i].first);
+                ASSERT_EQ((div_size * (div_size - 1)) / 2u, out_vec[i].second);
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+struct SharedBudgetReduceConfig : public core::DefaultReduceConfig {
+    static constexpr bool use_shared_memory_budget_ = true;
+};
+
+TEST(ReduceNode, ReduceModuloPairsWithSharedMemoryBudget) {
+    auto start_func =
+        [](Context& ctx) {
+            static constexpr size_t test_size = 200000u;
+            static constexpr size_t mod_size = 50000u;
+            static constexpr size_t div_size = test_size / mod_size;
+
+            using IntPair = std::pair<size_t, size_t>;
+
+            auto integers = Generate(
+                ctx, test_size,
+                [](const size_t& index) {
+                    return IntPair(index % mod_size, index / mod_size);
+                });
+
+            auto reduced = integers.ReducePair(
+                [](const size_t& a, const size_t& b) { return a + b; },
+                SharedBudgetReduceConfig());
+
+            std::vector<IntPair> out_vec = reduced.AllGather();
+            std::sort(out_vec.begin(), out_vec.end());
+
+            ASSERT_EQ(mod_size, out_vec.size());
+            for (size_t i = 0; i < out_vec.size(); ++i) {
+                ASSERT_EQ(i, out_vec[i].first);
+                ASSERT_EQ((div_size * (div_size - 1)) / 2u, out_vec[i].second);
+            }
+        };
+
+    api::RunLocalTests(start_func);
 }
 
 template <ReduceTableImpl table_impl>
@@ -211,6 +393,10 @@ TEST(ReduceNode, ReduceToIndexCorrectResults) {
         TestReduceToIndexCorrectResults<ReduceTableImpl::BUCKET>());
     api::RunLocalTests(
         TestReduceToIndexCorrectResults<ReduceTableImpl::OLD_PROBING>());
+    api::RunLocalTests(
+        TestReduceToIndexCorrectResults<ReduceTableImpl::FINGERPRINT>());
+    api::RunLocalTests(
+        TestReduceToIndexCorrectResults<ReduceTableImpl::ADAPTIVE>());
 }
 
 TEST(ReduceToIndexNode, OutputSizeCheck) {
@@ -235,4 +421,88 @@ TEST(ReduceToIndexNode, OutputSizeCheck) {
     api::RunLocalTests(start_func);
 }
 
+template <typename KeyedStateConfig>
+void TestKeyedStateUpdates(Context& ctx, const KeyedStateConfig& config) {
+    using Pair = std::pair<size_t, size_t>;
+
+    auto state = MakeKeyedState<size_t>(
+        ctx, size_t(0),
+        [](const size_t& a, const size_t& b) { return std::max(a, b); },
+        core::DefaultReduceConfig(), config);
+
+    auto max_fn = [](const size_t& a, const size_t& b) {
+                      return std::max(a, b);
+                  };
+
+    // all keys are new
+    auto changed = state.Update(
+        Generate(ctx, 1000,
+                 [](const size_t& i) { return Pair(i % 100, i); }),
+        max_fn);
+    ASSERT_EQ(100u, changed.Size());
+
+    // no value increases
+    changed = state.Update(
+        Generate(ctx, 100,
+                 [](const size_t& i) { return Pair(i, i); }),
+        max_fn);
+    ASSERT_EQ(0u, changed.Size());
+
+    // ten values increase and one key is new
+    changed = state.Update(
+        Generate(ctx, 11,
+                 [](const size_t& i) {
+                     return Pair(i < 10 ? i : 150, 5000);
+                 }),
+        max_fn);
+    ASSERT_EQ(11u, changed.Size());
+
+    std::vector<Pair> all = state.All().AllGather();
+    std::sort(all.begin(), all.end());
+
+    ASSERT_EQ(101u, all.size());
+    for (size_t k = 0; k < 100; ++k) {
+        ASSERT_EQ(k, all[k].first);
+        ASSERT_EQ(k < 10 ? 5000 : 900 + k, all[k].second);
+    }
+    ASSERT_EQ(Pair(150, 5000), all[100]);
+}
+
+TEST(ReduceNode, KeyedStateUpdates) {
+    auto start_func =
+        [](Context& ctx) {
+            TestKeyedStateUpdates(ctx, api::DefaultKeyedStateConfig());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(ReduceNode, KeyedStateUpdatesSmallRuns) {
+    auto start_func =
+        [](Context& ctx) {
+            // runs of a few deltas, hence many runs are merged with the state.
+            api::DefaultKeyedStateConfig config;
+            config.run_memory_rate_ =
+                16.0 * sizeof(std::pair<size_t, size_t>) / ctx.mem_limit();
+            TestKeyedStateUpdates(ctx, config);
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+class KeyedStateInMemoryConfig : public api::DefaultKeyedStateConfig
+{
+public:
+    static constexpr bool in_memory_ = true;
+};
+
+TEST(ReduceNode, KeyedStateUpdatesInMemory) {
+    auto start_func =
+        [](Context& ctx) {
+            TestKeyedStateUpdates(ctx, KeyedStateInMemoryConfig());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
 /******************************************************************************/
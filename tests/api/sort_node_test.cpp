@@ -9,6 +9,7 @@
  ******************************************************************************/
 
 #include <thrill/api/all_gather.hpp>
+#include <thrill/api/collapse.hpp>
 #include <thrill/api/generate.hpp>
 #include <thrill/api/read_binary.hpp>
 #include <thrill/api/sort.hpp>
@@ -16,6 +17,7 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <functional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -159,6 +161,255 @@ TEST(Sort, SortRandomIntIntStructs) {
     api::RunLocalTests(start_func);
 }
 
+TEST(Sort, SortRandomIntegersMultiLevel) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            std::default_random_engine generator(std::random_device { } ());
+            std::uniform_int_distribution<size_t> distribution(0, 1000);
+
+            auto integers = Generate(
+                ctx, 100000,
+                [&distribution, &generator](const size_t&) -> size_t {
+                    return distribution(generator);
+                });
+
+            // force multi-level splitter selection with binary fanout
+            api::DefaultSortConfig config;
+            config.multi_level_min_workers_ = 1;
+            config.multi_level_fanout_ = 2;
+
+            auto sorted = integers.Sort(
+                std::less<size_t>(), api::DefaultSortAlgorithm(), config);
+
+            std::vector<size_t> out_vec = sorted.AllGather();
+
+            for (size_t i = 0; i < out_vec.size() - 1; i++) {
+                ASSERT_FALSE(out_vec[i + 1] < out_vec[i]);
+            }
+
+            ASSERT_EQ(100000u, out_vec.size());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Sort, SortRandomIntegersBackgroundThreads) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            std::default_random_engine generator(std::random_device { } ());
+            std::uniform_int_distribution<size_t> distribution(0, 100000);
+
+            auto integers = Generate(
+                ctx, 100000,
+                [&distribution, &generator](const size_t&) -> size_t {
+                    return distribution(generator);
+                });
+
+            // receive in background and form runs in a helper thread
+            api::DefaultSortConfig config;
+            config.use_background_thread_ = true;
+            config.pipelined_run_formation_ = true;
+
+            auto sorted = integers.Sort(
+                std::less<size_t>(), api::DefaultSortAlgorithm(), config);
+
+            std::vector<size_t> out_vec = sorted.AllGather();
+
+            for (size_t i = 0; i < out_vec.size() - 1; i++) {
+                ASSERT_FALSE(out_vec[i + 1] < out_vec[i]);
+            }
+
+            ASSERT_EQ(100000u, out_vec.size());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Sort, SortRandomIntegersReplacementSelection) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            std::default_random_engine generator(std::random_device { } ());
+            std::uniform_int_distribution<size_t> distribution(0, 100000);
+
+            auto integers = Generate(
+                ctx, 100000,
+                [&distribution, &generator](const size_t&) -> size_t {
+                    return distribution(generator);
+                });
+
+            // form runs using replacement selection
+            api::DefaultSortConfig config;
+            config.replacement_selection_ = true;
+
+            auto sorted = integers.Sort(
+                std::less<size_t>(), api::DefaultSortAlgorithm(), config);
+
+            std::vector<size_t> out_vec = sorted.AllGather();
+
+            for (size_t i = 0; i < out_vec.size() - 1; i++) {
+                ASSERT_FALSE(out_vec[i + 1] < out_vec[i]);
+            }
+
+            ASSERT_EQ(100000u, out_vec.size());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Sort, SortRandomStringsStringSort) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            std::default_random_engine generator(std::random_device { } ());
+            std::uniform_int_distribution<size_t> distribution(0, 25);
+
+            auto strings = Generate(
+                ctx, 10000,
+                [&distribution, &generator](const size_t& index) {
+                    std::string s = "common/prefix/";
+                    for (size_t i = 0; i < index % 16; ++i)
+                        s += static_cast<char>('a' + distribution(generator));
+                    return s;
+                });
+
+            auto sorted = strings.Sort(
+                std::less<std::string>(), api::StringSortAlgorithm());
+
+            std::vector<std::string> out_vec = sorted.AllGather();
+
+            for (size_t i = 0; i + 1 < out_vec.size(); i++) {
+                ASSERT_FALSE(out_vec[i + 1] < out_vec[i]);
+            }
+
+            ASSERT_EQ(10000u, out_vec.size());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Sort, SortRandomIntIntStructsNormalizedKey) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            std::default_random_engine generator(std::random_device { } ());
+            std::uniform_int_distribution<int> distribution(1, 1000);
+
+            auto integers = Generate(
+                ctx, 100000,
+                [&distribution, &generator](const size_t&) -> IntIntStruct {
+                    return IntIntStruct {
+                        distribution(generator), distribution(generator)
+                    };
+                });
+
+            auto cmp_fn = [](const IntIntStruct& in1, const IntIntStruct& in2) {
+                              if (in1.a != in2.a) {
+                                  return in1.a < in2.a;
+                              }
+                              else {
+                                  return in1.b < in2.b;
+                              }
+                          };
+
+            // key is only a prefix of the order, ties are broken by cmp_fn
+            auto key_fn = [](const IntIntStruct& in) -> uint32_t {
+                              return static_cast<uint32_t>(in.a);
+                          };
+
+            auto sorted = integers.Sort(NormalizedKeyTag, key_fn, cmp_fn);
+
+            std::vector<IntIntStruct> out_vec = sorted.AllGather();
+
+            for (size_t i = 0; i < out_vec.size() - 1; i++) {
+                ASSERT_FALSE(cmp_fn(out_vec[i + 1], out_vec[i]));
+            }
+
+            ASSERT_EQ(100000u, out_vec.size());
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Sort, SortPresortedSkipsExchange) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            std::default_random_engine generator(std::random_device { } ());
+            std::uniform_int_distribution<int> distribution(0, 10000);
+
+            auto integers = Generate(
+                ctx, 100000,
+                [&distribution, &generator](const size_t&) -> int {
+                    return distribution(generator);
+                });
+
+            auto sorted = integers.Sort();
+            ASSERT_TRUE(sorted.properties().IsSortedBy<std::less<int> >());
+            ASSERT_FALSE(sorted.Map([](const int& i) { return i; })
+                         .properties().IsSortedBy<std::less<int> >());
+
+            // sorting again keeps the items in place
+            auto resorted = sorted.Keep().Sort();
+            ASSERT_TRUE(resorted.properties().IsSortedBy<std::less<int> >());
+
+            std::vector<int> out_vec = sorted.AllGather();
+            ASSERT_EQ(out_vec, resorted.AllGather());
+            ASSERT_TRUE(std::is_sorted(out_vec.begin(), out_vec.end()));
+            ASSERT_EQ(100000u, out_vec.size());
+
+            // Generate() delivers the indexes in order
+            auto indexes = Generate(ctx, 10000)
+                           .AssumeSorted(std::less<size_t>()).Sort();
+
+            std::vector<size_t> index_vec = indexes.AllGather();
+            ASSERT_EQ(10000u, index_vec.size());
+            for (size_t i = 0; i < index_vec.size(); ++i) {
+                ASSERT_EQ(i, index_vec[i]);
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
+TEST(Sort, AssumeSortedKeepsOriginalHandle) {
+
+    auto start_func =
+        [](Context& ctx) {
+
+            auto cached = Generate(ctx, 10000).Cache();
+            auto assumed = cached.AssumeSorted(std::less<size_t>());
+
+            // the property is only declared on the new handle
+            ASSERT_TRUE(assumed.properties().IsSortedBy<std::less<size_t> >());
+            ASSERT_FALSE(cached.properties().IsSortedBy<std::less<size_t> >());
+
+            // the original handle is still sorted with an exchange
+            std::vector<size_t> desc_vec =
+                cached.Keep().Sort(std::greater<size_t>()).AllGather();
+            ASSERT_EQ(10000u, desc_vec.size());
+            for (size_t i = 0; i < desc_vec.size(); ++i) {
+                ASSERT_EQ(desc_vec.size() - 1 - i, desc_vec[i]);
+            }
+
+            std::vector<size_t> index_vec = assumed.Sort().AllGather();
+            ASSERT_EQ(10000u, index_vec.size());
+            for (size_t i = 0; i < index_vec.size(); ++i) {
+                ASSERT_EQ(i, index_vec[i]);
+            }
+        };
+
+    api::RunLocalTests(start_func);
+}
+
 TEST(Sort, SortZeros) {
 
     auto start_func =
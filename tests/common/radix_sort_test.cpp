@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <random>
+#include <utility>
 #include <vector>
 
 using namespace thrill;
@@ -51,4 +52,25 @@ TEST(RadixSort, RandomStrings) {
     ASSERT_TRUE(std::is_sorted(vec.begin(), vec.end()));
 }
 
+TEST(RadixSort, RandomKeysWithTies) {
+
+    std::default_random_engine rng(std::random_device { } ());
+
+    // generate pairs with few distinct keys, ties are resolved by the second
+    size_t test_size = 1024000 + rng() % 20480;
+    std::vector<std::pair<uint64_t, uint32_t> > vec;
+    vec.reserve(test_size);
+
+    for (size_t i = 0; i < test_size; ++i) {
+        vec.emplace_back((rng() % 1000) << 40, static_cast<uint32_t>(rng()));
+    }
+
+    common::radix_sort_key_CI(
+        vec.begin(), vec.end(),
+        [](const std::pair<uint64_t, uint32_t>& p) { return p.first; },
+        std::less<std::pair<uint64_t, uint32_t> >());
+
+    ASSERT_TRUE(std::is_sorted(vec.begin(), vec.end()));
+}
+
 /******************************************************************************/
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * tests/core/group_by_hash_table_test.cpp
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <thrill/core/group_by_hash_table.hpp>
+#include <thrill/data/file.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+using namespace thrill; // NOLINT
+
+struct GroupByHashTable : public ::testing::Test {
+    data::BlockPool block_pool_;
+
+    //! items are key + num_keys * i, hence the key is the item modulo num_keys
+    struct KeyModulo {
+        size_t num_keys;
+        size_t operator () (const size_t& v) const { return v % num_keys; }
+    };
+
+    using Table = core::GroupByHashTable<
+              size_t, size_t, KeyModulo, std::hash<size_t> >;
+
+    //! memory limit for a table with capacity items
+    static size_t LimitFor(size_t capacity) {
+        return capacity * (sizeof(size_t) + Table::item_overhead);
+    }
+
+    //! visit all groups, check each key occurs once, and return the sorted
+    //! items of each key.
+    std::map<size_t, std::vector<size_t> > Groups(Table& table, bool consume) {
+        std::map<size_t, std::vector<size_t> > groups;
+        table.ForEachGroup(
+            [&groups](Table::GroupIterator& iter, const size_t& key) {
+                EXPECT_EQ(0u, groups.count(key));
+                EXPECT_EQ(key, iter.GetNextKey());
+                std::vector<size_t>& group = groups[key];
+                while (iter.HasNext())
+                    group.push_back(iter.Next());
+                std::sort(group.begin(), group.end());
+            },
+            consume);
+        return groups;
+    }
+
+    //! check that all groups are complete: each key has all its items.
+    void CheckGroups(const std::map<size_t, std::vector<size_t> >& groups,
+                     size_t num_keys, size_t items_per_key) {
+        ASSERT_EQ(num_keys, groups.size());
+        for (const auto& g : groups) {
+            ASSERT_EQ(items_per_key, g.second.size());
+            for (size_t i = 0; i < items_per_key; ++i)
+                ASSERT_EQ(g.first + num_keys * i, g.second[i]);
+        }
+    }
+};
+
+TEST_F(GroupByHashTable, InMemory) {
+    const size_t num_keys = 100, items_per_key = 5;
+
+    Table table(block_pool_, 0, 0, KeyModulo { num_keys }, std::hash<size_t>());
+    table.Initialize(LimitFor(num_keys * items_per_key));
+
+    for (size_t i = 0; i < num_keys * items_per_key; ++i)
+        table.Insert(i);
+    table.Finish();
+
+    ASSERT_FALSE(table.has_spilled());
+    ASSERT_EQ(num_keys * items_per_key, table.size());
+
+    CheckGroups(Groups(table, /* consume */ false), num_keys, items_per_key);
+    CheckGroups(Groups(table, /* consume */ true), num_keys, items_per_key);
+    ASSERT_EQ(0u, table.size());
+}
+
+TEST_F(GroupByHashTable, SpillAndSplitPartitions) {
+    // each first level partition holds about 625 items, which are split again
+    // into Files of about 40 items.
+    const size_t num_keys = 2000, items_per_key = 5, capacity = 100;
+
+    Table table(block_pool_, 0, 0, KeyModulo { num_keys }, std::hash<size_t>());
+    table.Initialize(LimitFor(capacity));
+
+    // items of each key are spread over the whole input, hence over several
+    // spills.
+    for (size_t i = 0; i < num_keys * items_per_key; ++i)
+        table.Insert(i);
+
+    ASSERT_TRUE(table.has_spilled());
+    ASSERT_LE(table.size(), capacity);
+
+    // Finish() spills the remaining items too.
+    table.Finish();
+    ASSERT_EQ(0u, table.size());
+
+    // non-consuming grouping can be repeated
+    CheckGroups(Groups(table, /* consume */ false), num_keys, items_per_key);
+    CheckGroups(Groups(table, /* consume */ false), num_keys, items_per_key);
+    CheckGroups(Groups(table, /* consume */ true), num_keys, items_per_key);
+    ASSERT_FALSE(table.has_spilled());
+}
+
+TEST_F(GroupByHashTable, LargeGroupReachesMaxLevel) {
+    // each key has more items than the capacity, hence the partitions are
+    // split up to max_level and then sorted and merged.
+    const size_t num_keys = 50, items_per_key = 40, capacity = 20;
+
+    Table table(block_pool_, 0, 0, KeyModulo { num_keys }, std::hash<size_t>());
+    table.Initialize(LimitFor(capacity));
+
+    for (size_t i = 0; i < num_keys * items_per_key; ++i)
+        table.Insert(i);
+    table.Finish();
+
+    ASSERT_TRUE(table.has_spilled());
+
+    CheckGroups(Groups(table, /* consume */ false), num_keys, items_per_key);
+    CheckGroups(Groups(table, /* consume */ true), num_keys, items_per_key);
+}
+
+/******************************************************************************/
@@ -11,6 +11,8 @@
 #include <gtest/gtest.h>
 
 #include <thrill/common/function_traits.hpp>
+#include <thrill/common/string_sort.hpp>
+#include <thrill/core/lcp_multiway_merge.hpp>
 #include <thrill/core/multiway_merge.hpp>
 #include <thrill/core/multiway_merge_attic.hpp>
 #include <thrill/data/file.hpp>
@@ -22,6 +24,7 @@
 #include <functional>
 #include <random>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -133,4 +136,115 @@ TEST_F(MultiwayMerge, GetMultiwayMergePuller) {
     ASSERT_FALSE(puller.HasNext());
 }
 
+TEST_F(MultiwayMerge, LcpMergeFrontCodedStrings) {
+    std::mt19937 gen(0);
+    const size_t a = 7, b = 500;
+
+    // random strings over a small alphabet with long common prefixes
+    auto random_string = [&gen]() {
+                             std::string s = "prefix";
+                             size_t len = gen() % 12;
+                             for (size_t i = 0; i < len; ++i)
+                                 s += static_cast<char>('a' + gen() % 3);
+                             return s;
+                         };
+
+    std::vector<std::string> ref;
+    std::vector<data::File> in;
+
+    for (size_t i = 0; i < a; ++i) {
+        std::vector<std::string> tmp;
+        for (size_t j = 0; j < b; ++j)
+            tmp.push_back(random_string());
+        common::multikey_quicksort(tmp.begin(), tmp.end());
+        ASSERT_TRUE(std::is_sorted(tmp.begin(), tmp.end()));
+        ref.insert(ref.end(), tmp.begin(), tmp.end());
+
+        data::File f(block_pool_, 0, /* dia_id */ 0);
+        core::FrontCodedStringWriter<data::File::Writer> w(f.GetWriter());
+        for (const std::string& t : tmp)
+            w.Put(t);
+        w.Close();
+        in.emplace_back(std::move(f));
+    }
+
+    using Reader = core::FrontCodedStringReader<data::File::ConsumeReader>;
+    std::vector<Reader> seq;
+    for (size_t t = 0; t < in.size(); ++t)
+        seq.emplace_back(in[t].GetConsumeReader());
+
+    auto puller = core::make_lcp_multiway_merge_tree(seq.begin(), seq.end());
+
+    std::sort(ref.begin(), ref.end());
+
+    for (size_t i = 0; i < ref.size(); ++i) {
+        ASSERT_TRUE(puller.HasNext());
+        std::string e = puller.Next();
+        ASSERT_EQ(ref[i], e);
+        if (i != 0) {
+            ASSERT_EQ(core::string_lcp(ref[i - 1], ref[i]), puller.lcp());
+        }
+    }
+    ASSERT_FALSE(puller.HasNext());
+}
+
+//! comparator delivering a coarse key prefix, which leaves many ties.
+struct PrefixKeyCompare {
+    using Item = std::pair<size_t, size_t>;
+    size_t key(const Item& a) const { return a.first / 16; }
+    bool operator () (const Item& a, const Item& b) const { return a < b; }
+};
+
+TEST_F(MultiwayMerge, PrefixMergeTree) {
+    std::mt19937 gen(0);
+    const size_t a = 5;
+
+    using Item = std::pair<size_t, size_t>;
+    static_assert(core::HasNormalizedKey<PrefixKeyCompare, Item>::value,
+                  "PrefixKeyCompare delivers keys");
+    static_assert(!core::HasNormalizedKey<std::less<Item>, Item>::value,
+                  "std::less delivers no keys");
+
+    std::vector<Item> ref;
+    std::vector<data::File> in;
+
+    for (size_t i = 0; i < a; ++i) {
+        // input 3 is empty, the others have different lengths
+        size_t b = (i == 3) ? 0 : 100 * i + 37;
+        std::vector<Item> tmp;
+        for (size_t j = 0; j < b; ++j)
+            tmp.emplace_back(gen() % 1000, gen() % 4);
+        std::sort(tmp.begin(), tmp.end());
+        ref.insert(ref.end(), tmp.begin(), tmp.end());
+
+        data::File f(block_pool_, 0, /* dia_id */ 0);
+        {
+            auto w = f.GetWriter();
+            for (const Item& t : tmp)
+                w.Put(t);
+        }
+        in.emplace_back(std::move(f));
+    }
+
+    std::vector<data::File::ConsumeReader> seq;
+    for (size_t t = 0; t < in.size(); ++t)
+        seq.emplace_back(in[t].GetConsumeReader());
+
+    auto puller = core::make_multiway_merge_tree<Item>(
+        seq.begin(), seq.end(), PrefixKeyCompare());
+    static_assert(
+        std::is_same<decltype(puller),
+                     core::PrefixMultiwayMergeTree<
+                         Item, decltype(seq.begin()), PrefixKeyCompare> >::value,
+        "comparator with key() selects PrefixMultiwayMergeTree");
+
+    std::sort(ref.begin(), ref.end());
+
+    for (size_t i = 0; i < ref.size(); ++i) {
+        ASSERT_TRUE(puller.HasNext());
+        ASSERT_EQ(ref[i], puller.Next());
+    }
+    ASSERT_FALSE(puller.HasNext());
+}
+
 /******************************************************************************/
@@ -9,7 +9,11 @@
  * All rights reserved. Published under the BSD-2 license in the LICENSE file.
  ******************************************************************************/
 
+#include <thrill/core/reduce_adaptive_hash_table.hpp>
+#include <thrill/core/reduce_arena_hash_table.hpp>
 #include <thrill/core/reduce_bucket_hash_table.hpp>
+#include <thrill/core/reduce_fingerprint_hash_table.hpp>
+#include <thrill/core/reduce_memory_budget.hpp>
 #include <thrill/core/reduce_old_probing_hash_table.hpp>
 #include <thrill/core/reduce_probing_hash_table.hpp>
 
@@ -19,6 +23,8 @@
 
 #include <algorithm>
 #include <functional>
+#include <map>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -143,4 +149,167 @@ TEST(ReduceHashTable, OldProbingAddIntegers) {
         });
 }
 
+TEST(ReduceHashTable, FingerprintAddIntegers) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructModulo<core::ReduceFingerprintHashTable>(ctx);
+        });
+}
+
+TEST(ReduceHashTable, AdaptiveAddIntegers) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructModulo<core::ReduceAdaptiveHashTable>(ctx);
+        });
+}
+
+//! Two ProbingHashTables sharing a memory budget: the first grows while the
+//! second is idle, and returns memory when the second is starved.
+TEST(ReduceHashTable, ProbingSharedMemoryBudget) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            auto key_ex = [](const MyStruct& in) { return in.key; };
+
+            auto red_fn = [](const MyStruct& in1, const MyStruct& in2) {
+                              return MyStruct(in1.key, in1.value + in2.value);
+                          };
+
+            using Collector = TableCollector<MyStruct>;
+
+            using Table = core::ReduceProbingHashTable<
+                      MyStruct, size_t, MyStruct,
+                      decltype(key_ex), decltype(red_fn), Collector,
+                      /* VolatileKey */ false, core::DefaultReduceConfig,
+                      core::ReduceByHash<size_t> >;
+
+            static constexpr size_t limit = 256 * 1024;
+            static constexpr size_t reserve = limit / 4;
+
+            core::ReduceMemoryBudget budget(/* num_accounts */ 2, 0.25);
+            budget.Initialize(limit);
+
+            Collector pre_collector(4), post_collector(4);
+
+            Table pre(ctx, 0, key_ex, red_fn, pre_collector,
+                      /* num_partitions */ 4, core::DefaultReduceConfig(),
+                      /* immediate_flush */ true);
+            pre.SetMemoryBudget(&budget, 0);
+            pre.Initialize(budget.max_account_bytes());
+
+            Table post(ctx, 0, key_ex, red_fn, post_collector,
+                       /* num_partitions */ 4, core::DefaultReduceConfig(),
+                       /* immediate_flush */ false);
+            post.SetMemoryBudget(&budget, 1);
+            post.Initialize(budget.max_account_bytes());
+
+            size_t key = 1;
+
+            // the first table takes all memory not reserved for the second.
+            for (size_t i = 0; i < 20000; ++i, ++key)
+                pre.Insert(MyStruct(key, 1));
+
+            ASSERT_GT(budget.held_bytes(0), limit / 2);
+            ASSERT_LE(budget.used_bytes(), limit);
+
+            // the second table is denied to grow beyond its reserve.
+            for (size_t i = 0; i < 20000; ++i, ++key)
+                post.Insert(MyStruct(key, 1));
+
+            ASSERT_GT(budget.num_denied(1), 0u);
+            ASSERT_LE(budget.held_bytes(1), reserve);
+            ASSERT_TRUE(post.has_spilled_data());
+
+            // the first table shrinks a flushed partition, the second grows.
+            size_t pre_held = budget.held_bytes(0);
+            for (size_t i = 0; i < 20000; ++i, ++key) {
+                pre.Insert(MyStruct(key, 1));
+                post.Insert(MyStruct(key, 1));
+                ASSERT_LE(budget.used_bytes(), limit);
+            }
+
+            ASSERT_LT(budget.held_bytes(0), pre_held);
+            ASSERT_GT(budget.held_bytes(1), reserve);
+
+            pre.FlushAll();
+
+            size_t num_flushed = 0;
+            for (const std::vector<MyStruct>& partition : pre_collector)
+                num_flushed += partition.size();
+            ASSERT_EQ(40000u, num_flushed);
+
+            // disposing the tables returns all memory
+            pre.Dispose();
+            post.Dispose();
+            ASSERT_EQ(0u, budget.used_bytes());
+        });
+}
+
+using StringPair = std::pair<std::string, size_t>;
+
+struct AddCounts {
+    size_t operator () (const size_t& a, const size_t& b) const {
+        return a + b;
+    }
+};
+
+//! Reduce short and long string keys with little memory, such that partitions
+//! are flushed due to full arenas.
+void TestArenaAddStringPairs(Context& ctx) {
+    static constexpr size_t test_size = 50000;
+    static constexpr size_t mod_size = 1000;
+
+    auto make_key = [](size_t i) {
+                        std::string k = std::to_string(i % mod_size);
+                        if (i % 2 == 0) k += std::string(40, 'x');
+                        return k;
+                    };
+
+    auto key_ex = [](const StringPair& p) { return p.first; };
+
+    using Collector = TableCollector<StringPair>;
+
+    Collector collector(7);
+
+    using Table = core::ReduceArenaHashTable<
+              StringPair, std::string, size_t,
+              decltype(key_ex), AddCounts, Collector,
+              /* VolatileKey */ true, core::DefaultReduceConfig,
+              core::ReduceByHash<std::string> >;
+
+    Table table(ctx, 0, key_ex, AddCounts(), collector,
+                /* num_partitions */ 7,
+                typename Table::ReduceConfig(),
+                /* immediate_flush */ true);
+    table.Initialize(/* limit_memory_bytes */ 16 * 1024);
+
+    for (size_t i = 0; i < test_size; ++i) {
+        table.Insert(StringPair(make_key(i), 1));
+    }
+
+    table.FlushAll();
+
+    // sum up partial results of flushed partitions
+    std::map<std::string, size_t> result;
+
+    for (size_t pi = 0; pi < collector.size(); ++pi) {
+        for (const StringPair& p : collector[pi]) {
+            ASSERT_EQ(pi, table.calculate_index(p).partition_id);
+            result[p.first] += p.second;
+        }
+    }
+
+    ASSERT_EQ(mod_size, result.size());
+
+    for (size_t i = 0; i < mod_size; ++i) {
+        ASSERT_EQ(test_size / mod_size, result[make_key(i)]);
+    }
+}
+
+TEST(ReduceHashTable, ArenaAddStringPairs) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestArenaAddStringPairs(ctx);
+        });
+}
+
 /******************************************************************************/
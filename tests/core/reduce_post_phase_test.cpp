@@ -32,7 +32,7 @@ struct MyStruct {
 
 /******************************************************************************/
 
-template <core::ReduceTableImpl table_impl>
+template <core::ReduceTableImpl table_impl, bool Batched = false>
 static void TestAddMyStructByHash(Context& ctx) {
     static constexpr bool debug = false;
     static constexpr size_t mod_size = 601;
@@ -66,7 +66,10 @@ static void TestAddMyStructByHash(Context& ctx) {
     phase.Initialize(/* limit_memory_bytes */ 64 * 1024);
 
     for (size_t i = 0; i < test_size; ++i) {
-        phase.Insert(MyStruct { i, i / mod_size });
+        if (Batched)
+            phase.InsertBatched(MyStruct { i, i / mod_size });
+        else
+            phase.Insert(MyStruct { i, i / mod_size });
     }
 
     phase.PushData(/* consume */ true);
@@ -110,6 +113,125 @@ TEST(ReduceHashPhase, ProbingAddMyStructByHash) {
         });
 }
 
+TEST(ReduceHashPhase, FingerprintAddMyStructByHash) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::FINGERPRINT>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, AdaptiveTableAddMyStructByHash) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::ADAPTIVE>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, BucketAddMyStructByHashBatched) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::BUCKET, true>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, OldProbingAddMyStructByHashBatched) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::OLD_PROBING, true>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, ProbingAddMyStructByHashBatched) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::PROBING, true>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, FingerprintAddMyStructByHashBatched) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::FINGERPRINT, true>(ctx);
+        });
+}
+
+template <core::ReduceTableImpl table_impl>
+static void TestAddManyKeysSpilled(Context& ctx) {
+    static constexpr size_t mod_size = 20000;
+    static constexpr size_t test_size = mod_size * 4;
+
+    auto key_ex = [](const MyStruct& in) {
+                      return in.key % mod_size;
+                  };
+
+    auto red_fn = [](const MyStruct& in1, const MyStruct& in2) {
+                      return MyStruct {
+                                 in1.key, in1.value + in2.value
+                      };
+                  };
+
+    std::vector<MyStruct> result;
+
+    auto emit_fn = [&result](const MyStruct& in) {
+                       result.emplace_back(in);
+                   };
+
+    using Phase = core::ReduceByHashPostPhase<
+              MyStruct, size_t, MyStruct,
+              decltype(key_ex), decltype(red_fn), decltype(emit_fn),
+              /* VolatileKey */ false,
+              core::DefaultReduceConfigSelect<table_impl> >;
+
+    // far too little memory for all keys: partitions are spilled and split.
+    Phase phase(ctx, 0, key_ex, red_fn, emit_fn);
+    phase.Initialize(/* limit_memory_bytes */ 16 * 1024);
+
+    for (size_t i = 0; i < test_size; ++i)
+        phase.Insert(MyStruct { i, 1 });
+
+    phase.PushData(/* consume */ true);
+
+    std::sort(result.begin(), result.end(),
+              [](const MyStruct& a, const MyStruct& b) {
+                  return a.key % mod_size < b.key % mod_size;
+              });
+
+    ASSERT_EQ(size_t(mod_size), result.size());
+
+    for (size_t i = 0; i < result.size(); ++i) {
+        ASSERT_EQ(i, result[i].key % mod_size);
+        ASSERT_EQ(size_t(test_size / mod_size), result[i].value);
+    }
+}
+
+TEST(ReduceHashPhase, BucketAddManyKeysSpilled) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddManyKeysSpilled<core::ReduceTableImpl::BUCKET>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, ProbingAddManyKeysSpilled) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddManyKeysSpilled<core::ReduceTableImpl::PROBING>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, FingerprintAddManyKeysSpilled) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddManyKeysSpilled<core::ReduceTableImpl::FINGERPRINT>(ctx);
+        });
+}
+
+TEST(ReduceHashPhase, AdaptiveTableAddManyKeysSpilled) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddManyKeysSpilled<core::ReduceTableImpl::ADAPTIVE>(ctx);
+        });
+}
+
 /******************************************************************************/
 
 TEST(ReduceHashPhase, PostReduceByIndex) {
@@ -222,6 +344,13 @@ TEST(ReduceHashPhase, ProbingAddMyStructByIndex) {
         });
 }
 
+TEST(ReduceHashPhase, FingerprintAddMyStructByIndex) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByIndex<core::ReduceTableImpl::FINGERPRINT>(ctx);
+        });
+}
+
 /******************************************************************************/
 
 template <core::ReduceTableImpl table_impl>
@@ -305,4 +434,11 @@ TEST(ReduceHashPhase, ProbingAddMyStructByIndexWithHoles) {
         });
 }
 
+TEST(ReduceHashPhase, FingerprintAddMyStructByIndexWithHoles) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByIndexWithHoles<core::ReduceTableImpl::FINGERPRINT>(ctx);
+        });
+}
+
 /******************************************************************************/
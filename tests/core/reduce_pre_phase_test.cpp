@@ -126,6 +126,95 @@ TEST(ReducePrePhase, ProbingAddMyStructByHash) {
         });
 }
 
+TEST(ReducePrePhase, FingerprintAddMyStructByHash) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::FINGERPRINT>(ctx);
+        });
+}
+
+TEST(ReducePrePhase, AdaptiveTableAddMyStructByHash) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByHash<core::ReduceTableImpl::ADAPTIVE>(ctx);
+        });
+}
+
+TEST(ReducePrePhase, AdaptiveBypass) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            using Config = core::DefaultReduceConfig;
+            static constexpr size_t sample_size = Config::bypass_sample_size_;
+            static constexpr size_t unique_size =
+                sample_size + Config::bypass_skip_size_;
+            static constexpr size_t mod_size = 601;
+            static constexpr size_t dup_size = 4 * sample_size;
+
+            auto key_ex = [](const MyStruct& in) { return in.key; };
+
+            auto red_fn = [](const MyStruct& in1, const MyStruct& in2) {
+                              return MyStruct {
+                                         in1.key, in1.value + in2.value
+                              };
+                          };
+
+            const size_t num_partitions = 13;
+
+            std::vector<data::File> files;
+            for (size_t i = 0; i < num_partitions; ++i)
+                files.emplace_back(ctx.GetFile(nullptr));
+
+            std::vector<data::File::Writer> emitters;
+            for (size_t i = 0; i < num_partitions; ++i)
+                emitters.emplace_back(files[i].GetWriter());
+
+            using Phase = core::ReducePrePhase<
+                      MyStruct, size_t, MyStruct,
+                      decltype(key_ex), decltype(red_fn),
+                      /* VolatileKey */ false, data::File::Writer, Config>;
+
+            Phase phase(ctx, 0, num_partitions, key_ex, red_fn, emitters);
+            phase.Initialize(/* limit_memory_bytes */ 16 * 1024 * 1024);
+
+            // unique keys: the table is bypassed after the first sample
+            for (size_t i = 0; i < unique_size; ++i) {
+                phase.InsertAdaptive(MyStruct { mod_size + i, 1 });
+                if (i == sample_size) ASSERT_TRUE(phase.bypass());
+            }
+            ASSERT_FALSE(phase.bypass());
+
+            // few keys: the table is used again
+            for (size_t i = 0; i < dup_size; ++i)
+                phase.InsertAdaptive(MyStruct { i % mod_size, 1 });
+
+            ASSERT_FALSE(phase.bypass());
+            ASSERT_EQ(size_t(Config::bypass_skip_size_), phase.num_bypassed());
+
+            phase.FlushAll();
+            phase.CloseAll();
+
+            // reduce the emitted items and check result
+            std::vector<size_t> count(mod_size + unique_size);
+            size_t num_emitted = 0;
+
+            for (size_t i = 0; i < num_partitions; ++i) {
+                data::File::Reader r = files[i].GetReader(/* consume */ true);
+                while (r.HasNext()) {
+                    MyStruct m = r.Next<MyStruct>();
+                    count[m.key] += m.value;
+                    ++num_emitted;
+                }
+            }
+
+            ASSERT_GE(mod_size + unique_size, num_emitted);
+
+            for (size_t i = 0; i < count.size(); ++i) {
+                ASSERT_EQ(i < mod_size ? dup_size / mod_size +
+                          (i < dup_size % mod_size) : 1, count[i]);
+            }
+        });
+}
+
 /******************************************************************************/
 
 template <core::ReduceTableImpl table_impl>
@@ -217,4 +306,11 @@ TEST(ReducePrePhase, ProbingAddMyStructByIndex) {
         });
 }
 
+TEST(ReducePrePhase, FingerprintAddMyStructByIndex) {
+    api::RunLocalSameThread(
+        [](Context& ctx) {
+            TestAddMyStructByIndex<core::ReduceTableImpl::FINGERPRINT>(ctx);
+        });
+}
+
 /******************************************************************************/
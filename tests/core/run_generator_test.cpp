@@ -0,0 +1,157 @@
+/*******************************************************************************
+ * tests/core/run_generator_test.cpp
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <thrill/core/run_generator.hpp>
+#include <thrill/data/file.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace thrill; // NOLINT
+
+struct RunGenerator : public ::testing::Test {
+    data::BlockPool block_pool_;
+
+    using Generator = core::RunGenerator<size_t, std::less<size_t> >;
+
+    //! check that all files are sorted and return all items
+    std::vector<size_t> CheckRuns(std::deque<data::File>& files) {
+        std::vector<size_t> all;
+        for (data::File& file : files) {
+            std::vector<size_t> run;
+            data::File::KeepReader reader = file.GetKeepReader();
+            while (reader.HasNext())
+                run.push_back(reader.Next<size_t>());
+            EXPECT_TRUE(std::is_sorted(run.begin(), run.end()));
+            all.insert(all.end(), run.begin(), run.end());
+        }
+        std::sort(all.begin(), all.end());
+        return all;
+    }
+};
+
+TEST_F(RunGenerator, RandomInput) {
+    std::mt19937 rng(42);
+    const size_t capacity = 1000, total = 100000;
+
+    std::deque<data::File> files;
+    Generator gen(block_pool_, 0, 0, files, capacity);
+
+    std::vector<size_t> input;
+    for (size_t i = 0; i < total; ++i) {
+        input.push_back(rng() % 100000);
+        gen.Insert(input.back());
+    }
+    gen.Finish();
+
+    ASSERT_EQ(files.size(), gen.num_runs());
+    ASSERT_EQ(total, gen.total_items());
+
+    // replacement selection produces runs of about twice the capacity
+    ASSERT_GE(files.size(), total / capacity / 3);
+    ASSERT_LE(files.size(), total / capacity * 2 / 3);
+
+    std::sort(input.begin(), input.end());
+    ASSERT_EQ(input, CheckRuns(files));
+}
+
+TEST_F(RunGenerator, PresortedInput) {
+    std::deque<data::File> files;
+    Generator gen(block_pool_, 0, 0, files, 100);
+
+    for (size_t i = 0; i < 10000; ++i)
+        gen.Insert(i / 3);
+    gen.Finish();
+
+    ASSERT_EQ(1u, files.size());
+    ASSERT_EQ(10000u, CheckRuns(files).size());
+}
+
+TEST_F(RunGenerator, FitsInMemory) {
+    std::mt19937 rng(42);
+    std::deque<data::File> files;
+    Generator gen(block_pool_, 0, 0, files, 1000);
+
+    std::vector<size_t> input;
+    for (size_t i = 0; i < 1000; ++i) {
+        input.push_back(rng() % 100);
+        gen.Insert(input.back());
+    }
+    gen.LimitCapacity();
+    gen.Finish();
+
+    ASSERT_EQ(1u, files.size());
+    std::sort(input.begin(), input.end());
+    ASSERT_EQ(input, CheckRuns(files));
+}
+
+TEST_F(RunGenerator, LimitCapacityInHeapMode) {
+    std::mt19937 rng(42);
+    std::deque<data::File> files;
+    Generator gen(block_pool_, 0, 0, files, 1000);
+
+    std::vector<size_t> input;
+    for (size_t i = 0; i < 10000; ++i) {
+        input.push_back(rng() % 100000);
+        gen.Insert(input.back());
+        // shrink the heap repeatedly, which writes parts of the current run
+        if (i % 2000 == 1999)
+            gen.LimitCapacity();
+    }
+    gen.Finish();
+
+    ASSERT_EQ(files.size(), gen.num_runs());
+    ASSERT_EQ(input.size(), gen.total_items());
+    std::sort(input.begin(), input.end());
+    ASSERT_EQ(input, CheckRuns(files));
+}
+
+TEST_F(RunGenerator, MemoryPressureEpisode) {
+    std::mt19937 rng(42);
+    std::deque<data::File> files;
+    Generator gen(block_pool_, 0, 0, files, 1000);
+
+    std::vector<size_t> input;
+    for (size_t i = 0; i < 20000; ++i) {
+        // memory is exceeded during the items [4000,6000)
+        bool memory_exceeded = (i >= 4000 && i < 6000);
+        gen.UpdateMemoryPressure(memory_exceeded);
+
+        // the capacity is limited once per episode, not on every item
+        if (memory_exceeded)
+            ASSERT_EQ(500u, gen.capacity());
+        else
+            ASSERT_EQ(1000u, gen.capacity());
+
+        input.push_back(rng() % 100000);
+        gen.Insert(input.back());
+    }
+    gen.Finish();
+
+    // the heap grew back, hence runs are about twice the capacity long again
+    ASSERT_LE(files.size(), 20000u / 1000 * 2 / 3 + 2);
+
+    ASSERT_EQ(files.size(), gen.num_runs());
+    ASSERT_EQ(input.size(), gen.total_items());
+    std::sort(input.begin(), input.end());
+    ASSERT_EQ(input, CheckRuns(files));
+}
+
+TEST_F(RunGenerator, Empty) {
+    std::deque<data::File> files;
+    Generator gen(block_pool_, 0, 0, files, 100);
+    gen.Finish();
+    ASSERT_EQ(0u, files.size());
+}
+
+/******************************************************************************/
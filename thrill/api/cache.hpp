@@ -48,6 +48,9 @@ public:
                        };
         auto lop_chain = parent.stack().push(save_fn).fold();
         parent.node()->AddChild(this, lop_chain);
+
+        // cached items keep the order and location of the parent's items
+        this->set_properties(parent.properties());
     }
 
     bool OnPreOpFile(const data::File& file, size_t /* parent_index */) final {
@@ -18,6 +18,7 @@
 #include <tlx/meta/function_stack.hpp>
 
 #include <algorithm>
+#include <typeinfo>
 
 namespace thrill {
 namespace api {
@@ -159,6 +160,35 @@ DIA<ValueType> DIA<ValueType, Stack>::Collapse() const {
     return CollapseSwitch<ValueType, Stack>::MakeCollapse(*this);
 }
 
+template <typename ValueType, typename Stack>
+template <typename CompareFunction>
+DIA<ValueType> DIA<ValueType, Stack>::AssumeSorted(
+    const CompareFunction& /* compare_function */) const {
+    assert(IsValid());
+
+    // always create a new CollapseNode carrying the property, as the parent's
+    // node may be shared with other DIA handles.
+    auto node = tlx::make_counting<api::CollapseNode<ValueType> >(*this);
+    DIAProperties props = properties();
+    props.sorted_by = &typeid(CompareFunction);
+    node->set_properties(props);
+    return DIA<ValueType>(node);
+}
+
+template <typename ValueType, typename Stack>
+template <typename KeyExtractor>
+DIA<ValueType> DIA<ValueType, Stack>::AssumeKeyPartitioned(
+    const KeyExtractor& /* key_extractor */) const {
+    assert(IsValid());
+
+    // always create a new CollapseNode carrying the property, see above.
+    auto node = tlx::make_counting<api::CollapseNode<ValueType> >(*this);
+    DIAProperties props = properties();
+    props.partitioned_by = &typeid(KeyExtractor);
+    node->set_properties(props);
+    return DIA<ValueType>(node);
+}
+
 } // namespace api
 } // namespace thrill
 
@@ -124,6 +124,14 @@ const struct LocationDetectionFlag<true> LocationDetectionTag;
 //! global const LocationDetectionFlag instance
 const struct LocationDetectionFlag<false> NoLocationDetectionTag;
 
+//! tag structure for Sort()
+struct NormalizedKeyTag {
+    NormalizedKeyTag() { }
+};
+
+//! global const NormalizedKeyTag instance
+const struct NormalizedKeyTag NormalizedKeyTag;
+
 /*!
  * DIA is the interface between the user and the Thrill framework. A DIA can be
  * imagined as an immutable array, even though the data does not need to be
@@ -265,6 +273,13 @@ public:
         return stack_;
     }
 
+    //! Returns the properties of the DIA's items, which are those declared for
+    //! the DIANode if the function stack is empty, as LOps may destroy them.
+    DIAProperties properties() const {
+        assert(IsValid());
+        return stack_empty ? node_->properties() : DIAProperties();
+    }
+
     //! Return context_ of DIANode, e.g. for creating new LOps and DOps
     Context& context() const {
         assert(IsValid());
@@ -655,6 +670,39 @@ public:
     Future<ValueType> MaxFuture(
         const ValueType& initial_value = ValueType()) const;
 
+    /*!
+     * TopK is an Action, which returns the k smallest elements of the DIA in
+     * sorted order on each worker. Only O(k) items per worker are exchanged,
+     * instead of sorting the whole DIA.
+     *
+     * \param k Number of elements to select.
+     *
+     * \param compare_function Function, which compares two elements. Returns
+     * true, if first element is smaller than second. False otherwise.
+     *
+     * \ingroup dia_actions
+     */
+    template <typename CompareFunction = std::less<ValueType> >
+    std::vector<ValueType> TopK(
+        size_t k,
+        const CompareFunction& compare_function = CompareFunction()) const;
+
+    /*!
+     * TopK is an ActionFuture, which returns the k smallest elements of the
+     * DIA in sorted order on each worker.
+     *
+     * \param k Number of elements to select.
+     *
+     * \param compare_function Function, which compares two elements. Returns
+     * true, if first element is smaller than second. False otherwise.
+     *
+     * \ingroup dia_actions
+     */
+    template <typename CompareFunction = std::less<ValueType> >
+    Future<std::vector<ValueType> > TopKFuture(
+        size_t k,
+        const CompareFunction& compare_function = CompareFunction()) const;
+
     /*!
      * Compute the approximate number of distinct elements in the DIA.
      *
@@ -1363,13 +1411,18 @@ public:
      *
      * \param hash_function Hash method for Keys
      *
+     * \param groupby_config Selection of the local grouping algorithm, see
+     * DefaultGroupByConfig.
+     *
      * \ingroup dia_dops
      */
     template <typename ValueOut, typename KeyExtractor,
-              typename GroupByFunction, typename HashFunction>
+              typename GroupByFunction, typename HashFunction,
+              typename GroupByConfig = class DefaultGroupByConfig>
     auto GroupByKey(const KeyExtractor& key_extractor,
                     const GroupByFunction& groupby_function,
-                    const HashFunction& hash_function) const;
+                    const HashFunction& hash_function,
+                    const GroupByConfig& groupby_config = GroupByConfig()) const;
 
     /*!
      * GroupByKey is a DOp, which groups elements of the DIA by its key.
@@ -1401,17 +1454,21 @@ public:
      *
      * \param hash_function Hash method for Keys
      *
+     * \param groupby_config Selection of the local grouping algorithm, see
+     * DefaultGroupByConfig.
+     *
      * \ingroup dia_dops
      */
     template <typename ValueOut, bool LocationDetectionTagValue,
               typename KeyExtractor, typename GroupByFunction,
               typename HashFunction =
-                  std::hash<typename FunctionTraits<KeyExtractor>::result_type>
-              >
+                  std::hash<typename FunctionTraits<KeyExtractor>::result_type>,
+              typename GroupByConfig = class DefaultGroupByConfig>
     auto GroupByKey(const LocationDetectionFlag<LocationDetectionTagValue>&,
                     const KeyExtractor& key_extractor,
                     const GroupByFunction& groupby_function,
-                    const HashFunction& hash_function = HashFunction()) const;
+                    const HashFunction& hash_function = HashFunction(),
+                    const GroupByConfig& groupby_config = GroupByConfig()) const;
 
     /*!
      * GroupBy is a DOp, which groups elements of the DIA by its key.
@@ -1601,6 +1658,57 @@ public:
     auto Sort(const CompareFunction& compare_function,
               const SortFunction& sort_algorithm) const;
 
+    /*!
+     * Sort is a DOp, which sorts a given DIA according to the given compare_function.
+     *
+     * \tparam CompareFunction Type of the compare_function.
+     *  Should be (ValueType,ValueType)->bool
+     *
+     * \param compare_function Function, which compares two elements. Returns
+     * true, if first element is smaller than second. False otherwise.
+     *
+     * \param sort_algorithm Algorithm class used to sort items. Merging is
+     * always done using a tournament tree with compare_function.
+     *
+     * \param sort_config Configuration of operational parameters of the
+     * SortNode, see DefaultSortConfig.
+     *
+     * \ingroup dia_dops
+     */
+    template <typename CompareFunction, typename SortFunction,
+              typename SortConfig>
+    auto Sort(const CompareFunction& compare_function,
+              const SortFunction& sort_algorithm,
+              const SortConfig& sort_config) const;
+
+    /*!
+     * Sort is a DOp, which sorts a given DIA according to the given
+     * compare_function using normalized keys. The key_extractor maps each item
+     * to an unsigned integer key, which must be consistent with the order:
+     * key(a) < key(b) implies compare_function(a,b). Splitter classification,
+     * run formation by MSD radix sort, and merging compare the keys and only
+     * call compare_function to break ties of equal keys.
+     *
+     * \tparam KeyExtractor Type of the key_extractor.
+     *  Should be ValueType->(unsigned integer)
+     *
+     * \tparam CompareFunction Type of the compare_function.
+     *  Should be (ValueType,ValueType)->bool
+     *
+     * \param key_extractor Function, which maps items to normalized keys.
+     *
+     * \param compare_function Function, which compares two elements with equal
+     * keys. Returns true, if first element is smaller than second. False
+     * otherwise.
+     *
+     * \ingroup dia_dops
+     */
+    template <typename KeyExtractor,
+              typename CompareFunction = std::less<ValueType> >
+    auto Sort(struct NormalizedKeyTag const&,
+              const KeyExtractor& key_extractor,
+              const CompareFunction& compare_function = CompareFunction()) const;
+
     /*!
      * Merge is a DOp, which merges two sorted DIAs to a single sorted DIA.
      * Both input DIAs must be used sorted conforming to the given comparator.
@@ -1774,6 +1882,33 @@ public:
      */
     DIA<ValueType> Cache() const;
 
+    /*!
+     * Declare that the items of this DIA are globally sorted by
+     * compare_function: each worker's items are sorted and precede those of
+     * the next worker. Sort() of a DIA which is sorted by a comparator of the
+     * same type skips sampling, exchange and local sorting. The property is
+     * declared for all comparators of type CompareFunction on a new
+     * CollapseNode, this DIA itself is not changed.
+     *
+     * \ingroup dia_dops
+     */
+    template <typename CompareFunction>
+    DIA<ValueType> AssumeSorted(
+        const CompareFunction& compare_function = CompareFunction()) const;
+
+    /*!
+     * Declare that the items of this DIA are partitioned by key_extractor: all
+     * items with equal keys reside on the same worker. GroupByKey() of such a
+     * DIA with a key extractor of the same type skips the shuffle. The
+     * property is declared for all key extractors of type KeyExtractor on a
+     * new CollapseNode, this DIA itself is not changed.
+     *
+     * \ingroup dia_dops
+     */
+    template <typename KeyExtractor>
+    DIA<ValueType> AssumeKeyPartitioned(
+        const KeyExtractor& key_extractor = KeyExtractor()) const;
+
     //! \}
 
 private:
@@ -1835,6 +1970,9 @@ using api::DuplicateDetectionTag;
 //! imported from api namespace
 using api::NoDuplicateDetectionTag;
 
+//! imported from api namespace
+using api::NormalizedKeyTag;
+
 //! imported from api namespace
 using api::LocationDetectionFlag;
 
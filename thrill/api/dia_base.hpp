@@ -19,6 +19,8 @@
 #include <thrill/api/context.hpp>
 
 #include <string>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
 namespace thrill {
@@ -76,6 +78,46 @@ private:
     static constexpr size_t max_limit_ = static_cast<size_t>(-1);
 };
 
+/*!
+ * Properties of the layout of a DIANode's output items, which DOps declare and
+ * which downstream DOps exploit to skip a shuffle or a local sort. Functors are
+ * identified by their type. DOps only declare properties for stateless (empty)
+ * functor types, since all their instances behave identically, while users may
+ * declare them for any type via DIA::AssumeSorted() and
+ * DIA::AssumeKeyPartitioned().
+ */
+class DIAProperties
+{
+public:
+    //! Type of the comparator by which the items are globally sorted, i.e.
+    //! each worker's items are sorted and all precede those of the next
+    //! worker, or nullptr.
+    const std::type_info* sorted_by = nullptr;
+
+    //! Type of the key extractor by which the items are partitioned, i.e. all
+    //! items with equal keys reside on the same worker, or nullptr.
+    const std::type_info* partitioned_by = nullptr;
+
+    //! Return identity of a functor type if it is stateless, else nullptr.
+    template <typename Functor>
+    static const std::type_info * Stateless() {
+        return std::is_empty<Functor>::value ? &typeid(Functor) : nullptr;
+    }
+
+    //! Test if the items are globally sorted by comparator type Compare.
+    template <typename Compare>
+    bool IsSortedBy() const {
+        return sorted_by != nullptr && *sorted_by == typeid(Compare);
+    }
+
+    //! Test if the items are partitioned by key extractor type KeyExtractor.
+    template <typename KeyExtractor>
+    bool IsPartitionedBy() const {
+        return partitioned_by != nullptr &&
+               *partitioned_by == typeid(KeyExtractor);
+    }
+};
+
 /*!
  * The DIABase is the untyped super class of DIANode. DIABases are used to build
  * the execution graph, which is used to execute the computation.
@@ -285,6 +327,14 @@ public:
 
     void set_mem_limit(const DIAMemUse& mem_limit) { mem_limit_ = mem_limit; }
 
+    //! Returns the properties of the output items.
+    const DIAProperties& properties() const { return properties_; }
+
+    //! Set the properties of the output items.
+    void set_properties(const DIAProperties& properties) {
+        properties_ = properties;
+    }
+
 protected:
     //! \name Fixed DIA Information
     //! \{
@@ -313,6 +363,9 @@ protected:
     //! is allowed to use.
     DIAMemUse mem_limit_ = 0;
 
+    //! Properties of the output items, declared by the DOp or the user.
+    DIAProperties properties_;
+
     //! Consumption counter: when it reaches zero, PushData() is called with
     //! consume = true
     size_t consume_counter_ = 1;
@@ -35,7 +35,7 @@ namespace api {
 // forward declarations for friend classes
 template <typename ValueType,
           typename KeyExtractor, typename GroupFunction, typename HashFunction,
-          bool UseLocationDetection>
+          bool UseLocationDetection, typename GroupByConfig>
 class GroupByNode;
 
 template <typename ValueType,
@@ -51,7 +51,8 @@ class GroupByIterator
               typename T2,
               typename T3,
               typename T4,
-              bool T5>
+              bool T5,
+              typename T6>
     friend class GroupByNode;
 
     template <typename T1,
@@ -135,7 +136,8 @@ class GroupByMultiwayMergeIterator
               typename T2,
               typename T3,
               typename T4,
-              bool T5>
+              bool T5,
+              typename T6>
     friend class GroupByNode;
 
     template <typename T1,
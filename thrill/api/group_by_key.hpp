@@ -20,8 +20,10 @@
 #include <thrill/api/group_by_iterator.hpp>
 #include <thrill/common/functional.hpp>
 #include <thrill/common/logger.hpp>
+#include <thrill/core/group_by_hash_table.hpp>
 #include <thrill/core/location_detection.hpp>
 #include <thrill/core/reduce_functional.hpp>
+#include <thrill/core/run_generator.hpp>
 #include <thrill/data/file.hpp>
 
 #include <algorithm>
@@ -36,12 +38,33 @@
 namespace thrill {
 namespace api {
 
+//! Enum class to select the local grouping algorithm of GroupByKey.
+enum class GroupByImpl {
+    //! sort the items into runs and multiway merge them, the groups are handed
+    //! to the group function in key order
+    SORT,
+    //! chain the items of each key in a hash table, the groups are handed to
+    //! the group function in no particular order
+    HASH
+};
+
+/*!
+ * Configuration class to define operational parameters of GroupByKey. Members
+ * can be defined static constexpr or be mutable variables.
+ */
+class DefaultGroupByConfig
+{
+public:
+    //! select the local grouping algorithm by enum
+    static constexpr GroupByImpl group_by_impl_ = GroupByImpl::SORT;
+};
+
 /*!
  * \ingroup api_layer
  */
 template <typename ValueType,
           typename KeyExtractor, typename GroupFunction, typename HashFunction,
-          bool UseLocationDetection>
+          bool UseLocationDetection, typename GroupByConfig>
 class GroupByNode final : public DOpNode<ValueType>
 {
 private:
@@ -55,6 +78,26 @@ private:
     using ValueIn =
               typename common::FunctionTraits<KeyExtractor>::template arg_plain<0>;
 
+    static constexpr bool use_hash_ =
+        GroupByConfig::group_by_impl_ == GroupByImpl::HASH;
+
+    //! tag selecting the hash or sort implementation at compile time
+    using UseHash = std::integral_constant<bool, use_hash_>;
+
+    //! empty stand-in for the hash table in GroupByImpl::SORT
+    struct NoHashTable {
+        template <typename... Args>
+        explicit NoHashTable(Args&& ...) { }
+        void Dispose() { }
+    };
+
+    //! the hash table is only instantiated for GroupByImpl::HASH, such that
+    //! SORT does not require Key equality or the hash table's iterator type.
+    using HashTable = typename std::conditional<
+              use_hash_,
+              core::GroupByHashTable<ValueIn, Key, KeyExtractor, HashFunction>,
+              NoHashTable>::type;
+
     struct ValueComparator {
     public:
         explicit ValueComparator(const GroupByNode& node) : node_(node) { }
@@ -119,13 +162,18 @@ public:
     GroupByNode(const ParentDIA& parent,
                 const KeyExtractor& key_extractor,
                 const GroupFunction& groupby_function,
-                const HashFunction& hash_function = HashFunction())
+                const HashFunction& hash_function = HashFunction(),
+                const GroupByConfig& /* config */ = GroupByConfig())
         : Super(parent.ctx(), "GroupByKey", { parent.id() }, { parent.node() }),
           key_extractor_(key_extractor),
           groupby_function_(groupby_function),
           hash_function_(hash_function),
           location_detection_(parent.ctx(), Super::id()),
-          pre_file_(context_.GetFile(this))
+          hash_table_(context_.block_pool(), context_.local_worker_id(),
+                      Super::id(), key_extractor, hash_function),
+          pre_file_(context_.GetFile(this)),
+          partitioned_(
+              parent.properties().template IsPartitionedBy<KeyExtractor>())
     {
         // Hook PreOp
         auto pre_op_fn = [=](const ValueIn& input) {
@@ -140,12 +188,17 @@ public:
     void StartPreOp(size_t /* id */) final {
         emitters_ = stream_->GetWriters();
         pre_writer_ = pre_file_.GetWriter();
-        if (UseLocationDetection)
+        if (UseLocationDetection && !partitioned_)
             location_detection_.Initialize(DIABase::mem_limit_);
     }
 
     //! Send all elements to their designated PEs
     void PreOp(const ValueIn& v) {
+        if (partitioned_) {
+            // all items with this key are local, keep them
+            pre_writer_.Put(v);
+            return;
+        }
         size_t hash = hash_function_(key_extractor_(v));
         if (UseLocationDetection) {
             pre_writer_.Put(v);
@@ -170,6 +223,10 @@ public:
     }
 
     DIAMemUse PushDataMemUse() final {
+        if (use_hash_) {
+            // the hash table is kept, and spilled partitions are read back
+            return DIAMemUse::Max();
+        }
         if (files_.size() <= 1) {
             // direct push, no merge necessary
             return 0;
@@ -181,6 +238,19 @@ public:
     }
 
     void Execute() override {
+        if (partitioned_) {
+            // nothing to exchange, wait until all workers closed the stream
+            emitters_.Close();
+            {
+                auto reader = stream_->GetCatReader(/* consume */ true);
+                die_unless(!reader.HasNext());
+            }
+            stream_.reset();
+            // group the local items
+            auto reader = pre_file_.GetConsumeReader();
+            MainOp(reader);
+            return;
+        }
         if (UseLocationDetection) {
             std::unordered_map<size_t, size_t> target_processors;
             size_t max_hash = location_detection_.Flush(target_processors);
@@ -201,6 +271,49 @@ public:
     }
 
     void PushData(bool consume) final {
+        PushData(consume, UseHash());
+    }
+
+    void Dispose() override {
+        hash_table_.Dispose();
+    }
+
+private:
+    KeyExtractor key_extractor_;
+    GroupFunction groupby_function_;
+    HashFunction hash_function_;
+
+    core::LocationDetection<HashCount> location_detection_;
+
+    //! items grouped by key for GroupByImpl::HASH
+    HashTable hash_table_;
+
+    data::CatStreamPtr stream_ { context_.GetNewCatStream(this) };
+    data::CatStream::Writers emitters_;
+
+    std::deque<data::File> files_;
+    data::File sorted_elems_ { context_.GetFile(this) };
+    size_t totalsize_ = 0;
+
+    //! location detection and associated files
+    data::File pre_file_;
+    data::File::Writer pre_writer_;
+
+    //! Whether the parent's items are already partitioned by a key extractor
+    //! of type KeyExtractor, which makes the shuffle unnecessary.
+    const bool partitioned_;
+
+    //! Push the groups of the hash table.
+    void PushData(bool consume, std::true_type /* use_hash */) {
+        hash_table_.ForEachGroup(
+            [this](auto& iter, const Key& key) {
+                // call user function and push result to callback functions
+                this->PushItem(groupby_function_(iter, key));
+            }, consume);
+    }
+
+    //! Merge the sorted runs and push their groups.
+    void PushData(bool consume, std::false_type /* use_hash */) {
         LOG << "sort data";
         common::StatsTimerStart timer;
         const size_t num_runs = files_.size();
@@ -284,26 +397,6 @@ public:
             << " multiwaymerge=" << (num_runs > 1);
     }
 
-    void Dispose() override { }
-
-private:
-    KeyExtractor key_extractor_;
-    GroupFunction groupby_function_;
-    HashFunction hash_function_;
-
-    core::LocationDetection<HashCount> location_detection_;
-
-    data::CatStreamPtr stream_ { context_.GetNewCatStream(this) };
-    data::CatStream::Writers emitters_;
-
-    std::deque<data::File> files_;
-    data::File sorted_elems_ { context_.GetFile(this) };
-    size_t totalsize_ = 0;
-
-    //! location detection and associated files
-    data::File pre_file_;
-    data::File::Writer pre_writer_;
-
     void RunUserFunc(data::File& f, bool consume) {
         auto r = f.GetReader(consume);
         if (r.HasNext()) {
@@ -323,42 +416,49 @@ private:
         }
     }
 
-    //! Sort and store elements in a file
-    void FlushVectorToFile(std::vector<ValueIn>& v) {
-        // sort run and sort to file
-        std::sort(v.begin(), v.end(), ValueComparator(*this));
-        totalsize_ += v.size();
-
-        files_.emplace_back(context_.GetFile(this));
-        data::File::Writer w = files_.back().GetWriter();
-        for (const ValueIn& e : v) {
-            w.Put(e);
-        }
-        w.Close();
-    }
-
     //! Receive elements from other workers.
     void MainOp() {
+        auto reader = stream_->GetCatReader(/* consume */ true);
+        MainOp(reader);
+        stream_.reset();
+    }
+
+    //! Form sorted runs of the items delivered by reader, or insert them into
+    //! the hash table.
+    template <typename Reader>
+    void MainOp(Reader& reader) {
         LOG << "running group by main op";
+        MainOp(reader, UseHash());
+    }
+
+    //! Insert the items delivered by reader into the hash table.
+    template <typename Reader>
+    void MainOp(Reader& reader, std::true_type /* use_hash */) {
+        hash_table_.Initialize(DIABase::mem_limit_);
+        while (reader.HasNext())
+            hash_table_.Insert(reader.template Next<ValueIn>());
+        hash_table_.Finish();
+    }
 
-        std::vector<ValueIn> incoming;
+    //! Form sorted runs of the items delivered by reader.
+    template <typename Reader>
+    void MainOp(Reader& reader, std::false_type /* use_hash */) {
+        // form sorted runs of incoming elements using replacement selection
+        core::RunGenerator<ValueIn, ValueComparator> run_generator(
+            context_.block_pool(), context_.local_worker_id(), this->id(),
+            files_, DIABase::mem_limit_ / sizeof(ValueIn),
+            ValueComparator(*this));
 
         common::StatsTimerStart timer;
         // get incoming elements
-        auto reader = stream_->GetCatReader(/* consume */ true);
         while (reader.HasNext()) {
-            // if vector is full save to disk
-            if (mem::memory_exceeded) {
-                FlushVectorToFile(incoming);
-                incoming.clear();
-            }
-            // store incoming element
-            incoming.emplace_back(reader.template Next<ValueIn>());
+            // if memory is exhausted, do not grow the run buffer further
+            run_generator.UpdateMemoryPressure(mem::memory_exceeded);
+            run_generator.Insert(reader.template Next<ValueIn>());
         }
-        FlushVectorToFile(incoming);
-        std::vector<ValueIn>().swap(incoming);
+        run_generator.Finish();
+        totalsize_ += run_generator.total_items();
         LOG << "finished receiving elems";
-        stream_.reset();
 
         timer.Stop();
 
@@ -391,12 +491,14 @@ private:
 
 template <typename ValueType, typename Stack>
 template <typename ValueOut, bool LocationDetectionValue,
-          typename KeyExtractor, typename GroupFunction, typename HashFunction>
+          typename KeyExtractor, typename GroupFunction, typename HashFunction,
+          typename GroupByConfig>
 auto DIA<ValueType, Stack>::GroupByKey(
     const LocationDetectionFlag<LocationDetectionValue>&,
     const KeyExtractor& key_extractor,
     const GroupFunction& groupby_function,
-    const HashFunction& hash_function) const {
+    const HashFunction& hash_function,
+    const GroupByConfig& groupby_config) const {
 
     static_assert(
         std::is_same<
@@ -407,24 +509,27 @@ auto DIA<ValueType, Stack>::GroupByKey(
 
     using GroupByNode = api::GroupByNode<
               ValueOut, KeyExtractor, GroupFunction, HashFunction,
-              LocationDetectionValue>;
+              LocationDetectionValue, GroupByConfig>;
 
     auto node = tlx::make_counting<GroupByNode>(
-        *this, key_extractor, groupby_function, hash_function);
+        *this, key_extractor, groupby_function, hash_function, groupby_config);
 
     return DIA<ValueOut>(node);
 }
 
 template <typename ValueType, typename Stack>
 template <typename ValueOut, typename KeyExtractor,
-          typename GroupFunction, typename HashFunction>
+          typename GroupFunction, typename HashFunction,
+          typename GroupByConfig>
 auto DIA<ValueType, Stack>::GroupByKey(
     const KeyExtractor& key_extractor,
     const GroupFunction& groupby_function,
-    const HashFunction& hash_function) const {
+    const HashFunction& hash_function,
+    const GroupByConfig& groupby_config) const {
     // forward to other method _without_ location detection
     return GroupByKey<ValueOut>(
-        NoLocationDetectionTag, key_extractor, groupby_function, hash_function);
+        NoLocationDetectionTag, key_extractor, groupby_function, hash_function,
+        groupby_config);
 }
 
 template <typename ValueType, typename Stack>
@@ -439,6 +544,13 @@ auto DIA<ValueType, Stack>::GroupByKey(
 }
 
 } // namespace api
+
+//! imported from api namespace
+using api::DefaultGroupByConfig;
+
+//! imported from api namespace
+using api::GroupByImpl;
+
 } // namespace thrill
 
 #endif // !THRILL_API_GROUP_BY_KEY_HEADER
@@ -19,18 +19,103 @@
 #include <thrill/common/logger.hpp>
 #include <thrill/common/stats_timer.hpp>
 #include <thrill/core/buffered_multiway_merge.hpp>
+#include <thrill/core/golomb_bloom_filter.hpp>
+#include <thrill/core/join_heavy_keys.hpp>
+#include <thrill/core/join_hash_table.hpp>
 #include <thrill/core/location_detection.hpp>
+#include <thrill/core/run_generator.hpp>
 #include <thrill/data/file.hpp>
 
 #include <algorithm>
+#include <array>
 #include <deque>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
 namespace thrill {
 namespace api {
 
+//! Enum class to select the local join algorithm of InnerJoin.
+enum class JoinImpl {
+    //! sort both inputs into runs and merge-join them
+    SORT_MERGE,
+    //! build a hash table of the smaller input, and stream the other through.
+    //! Falls back to SORT_MERGE if the table exceeds the memory limit.
+    HASH,
+    //! HASH if the smaller input of a worker fits into memory, else SORT_MERGE
+    AUTO
+};
+
+/*!
+ * Configuration class to define operational parameters of InnerJoin. Members
+ * can be defined static constexpr or be mutable variables.
+ */
+class DefaultJoinConfig
+{
+public:
+    //! select the local join algorithm by enum
+    static constexpr JoinImpl join_impl_ = JoinImpl::SORT_MERGE;
+
+    //! only for AUTO: hash join if the hash table of the smaller input, as
+    //! estimated from the received bytes, takes at most this fraction of the
+    //! memory limit.
+    double hash_join_memory_rate_ = 0.5;
+
+    //! replicate the smaller input to all hosts instead of shuffling both
+    //! inputs, if its total size is at most broadcast_max_bytes_. The items of
+    //! the larger input then stay on their worker.
+    static constexpr bool use_broadcast_ = false;
+
+    //! only for use_broadcast_: maximum total size of the replicated input.
+    size_t broadcast_max_bytes_ = 16 * 1024 * 1024;
+
+    //! spread the items of heavy keys over several workers and replicate the
+    //! items of the other input to them, see core::JoinHeavyKeys.
+    static constexpr bool use_heavy_keys_ = false;
+
+    //! only for use_heavy_keys_: number of counters in the sketch, which is
+    //! also the maximum number of heavy keys.
+    static constexpr size_t heavy_key_capacity_ = 64;
+
+    //! only for use_heavy_keys_: number of items of each input sampled per
+    //! worker to detect heavy keys.
+    static constexpr size_t heavy_key_sample_size_ = 16384;
+
+    //! only for use_heavy_keys_: fraction of all sampled items a key must have
+    //! to be heavy.
+    double heavy_key_rate_ = 0.01;
+
+    //! drop the items of the larger input whose key is not in a bloom filter
+    //! of the smaller input's keys before the shuffle, see
+    //! core::GolombBloomFilter. Only used without location detection, which
+    //! already drops items whose key hash is not in both inputs.
+    static constexpr bool use_bloom_filter_ = false;
+
+    //! only for use_bloom_filter_: maximum size of the filter, which every
+    //! worker holds and receives Golomb encoded from all others. The inputs are
+    //! not filtered if the smaller one has more keys than fit.
+    size_t bloom_filter_max_bytes_ = 16 * 1024 * 1024;
+
+    //! \name Accessors
+    //! \{
+
+    //! Returns hash_join_memory_rate_
+    double hash_join_memory_rate() const { return hash_join_memory_rate_; }
+
+    //! Returns broadcast_max_bytes_
+    size_t broadcast_max_bytes() const { return broadcast_max_bytes_; }
+
+    //! Returns heavy_key_rate_
+    double heavy_key_rate() const { return heavy_key_rate_; }
+
+    //! Returns bloom_filter_max_bytes_
+    size_t bloom_filter_max_bytes() const { return bloom_filter_max_bytes_; }
+
+    //! \}
+};
+
 /*!
  * Performs an inner join between two DIAs. The key from each DIA element is
  * hereby extracted with a key extractor function. All pairs of elements with
@@ -58,7 +143,7 @@ namespace api {
 template <typename ValueType, typename FirstDIA, typename SecondDIA,
           typename KeyExtractor1, typename KeyExtractor2,
           typename JoinFunction, typename HashFunction,
-          bool UseLocationDetection>
+          bool UseLocationDetection, typename JoinConfig>
 class JoinNode final : public DOpNode<ValueType>
 {
 private:
@@ -73,6 +158,28 @@ private:
     //! Key type of join. must be equal to the other key extractor
     using Key = typename common::FunctionTraits<KeyExtractor1>::result_type;
 
+    using HashTable1 = core::JoinHashTable<
+              InputTypeFirst, Key, KeyExtractor1, HashFunction>;
+    using HashTable2 = core::JoinHashTable<
+              InputTypeSecond, Key, KeyExtractor2, HashFunction>;
+
+    //! whether the items sent to each worker are counted to select the join
+    //! algorithm and the build side of the hash join.
+    static constexpr bool count_sent_ =
+        JoinConfig::join_impl_ != JoinImpl::SORT_MERGE;
+
+    //! whether the larger input is filtered by a bloom filter of the keys of
+    //! the smaller one.
+    static constexpr bool use_bloom_filter_ =
+        JoinConfig::use_bloom_filter_ && !UseLocationDetection;
+
+    //! whether the inputs are written to pre files and shuffled only in
+    //! Execute(), for location detection, to decide on a broadcast join, to
+    //! detect heavy keys or to build the bloom filter.
+    static constexpr bool buffer_inputs_ =
+        UseLocationDetection || JoinConfig::use_broadcast_ ||
+        JoinConfig::use_heavy_keys_ || use_bloom_filter_;
+
     //! hash counter used by LocationDetection
     class HashCount
     {
@@ -135,15 +242,25 @@ public:
              const KeyExtractor1& key_extractor1,
              const KeyExtractor2& key_extractor2,
              const JoinFunction& join_function,
-             const HashFunction& hash_function)
+             const HashFunction& hash_function,
+             const JoinConfig& config)
         : Super(parent1.ctx(), "Join",
                 { parent1.id(), parent2.id() },
                 { parent1.node(), parent2.node() }),
           key_extractor1_(key_extractor1),
           key_extractor2_(key_extractor2),
           join_function_(join_function),
-          hash_function_(hash_function)
+          hash_function_(hash_function),
+          config_(config),
+          table1_(key_extractor1, hash_function),
+          table2_(key_extractor2, hash_function),
+          heavy_keys_(JoinConfig::heavy_key_capacity_,
+                      JoinConfig::heavy_key_sample_size_,
+                      config.heavy_key_rate())
     {
+        if (count_sent_)
+            num_sent_.resize(2 * context_.num_workers(), 0);
+
         auto pre_op_fn1 = [this](const InputTypeFirst& input) {
                               PreOp1(input);
                           };
@@ -160,6 +277,18 @@ public:
 
     void Execute() final {
 
+        if (JoinConfig::use_broadcast_ && SelectBroadcast()) {
+            if (UseLocationDetection)
+                location_detection_.Dispose();
+            return BroadcastMainOp();
+        }
+
+        if (JoinConfig::use_heavy_keys_)
+            SelectHeavyKeys();
+
+        if (use_bloom_filter_)
+            BuildBloomFilter();
+
         if (UseLocationDetection) {
             std::unordered_map<size_t, size_t> target_processors;
             size_t max_hash = location_detection_.Flush(target_processors);
@@ -168,29 +297,43 @@ public:
             auto file1reader = pre_file1_.GetConsumeReader();
             while (file1reader.HasNext()) {
                 InputTypeFirst in1 = file1reader.template Next<InputTypeFirst>();
-                auto target_processor =
-                    target_processors.find(
-                        hash_function_(key_extractor1_(in1)) % max_hash);
-                if (target_processor != target_processors.end()) {
-                    hash_writers1_[target_processor->second].Put(in1);
-                }
+                size_t hash = hash_function_(key_extractor1_(in1));
+                if (SendHeavy(hash_writers1_, 0, hash, in1))
+                    continue;
+                auto target_processor = target_processors.find(hash % max_hash);
+                if (target_processor != target_processors.end())
+                    SendItem(hash_writers1_, 0, target_processor->second, in1);
             }
 
             auto file2reader = pre_file2_.GetConsumeReader();
             while (file2reader.HasNext()) {
                 InputTypeSecond in2 = file2reader.template Next<InputTypeSecond>();
-                auto target_processor =
-                    target_processors.find(
-                        hash_function_(key_extractor2_(in2)) % max_hash);
-                if (target_processor != target_processors.end()) {
-                    hash_writers2_[target_processor->second].Put(in2);
-                }
+                size_t hash = hash_function_(key_extractor2_(in2));
+                if (SendHeavy(hash_writers2_, 1, hash, in2))
+                    continue;
+                auto target_processor = target_processors.find(hash % max_hash);
+                if (target_processor != target_processors.end())
+                    SendItem(hash_writers2_, 1, target_processor->second, in2);
             }
         }
+        else if (buffer_inputs_) {
+            auto file1reader = pre_file1_.GetConsumeReader();
+            while (file1reader.HasNext())
+                ShuffleItem1(file1reader.template Next<InputTypeFirst>());
+
+            auto file2reader = pre_file2_.GetConsumeReader();
+            while (file2reader.HasNext())
+                ShuffleItem2(file2reader.template Next<InputTypeSecond>());
+
+            if (use_bloom_filter_)
+                bloom_filter_.Clear();
+        }
 
         hash_writers1_.Close();
         hash_writers2_.Close();
 
+        SelectJoinImpl();
+
         MainOp();
     }
 
@@ -213,6 +356,50 @@ public:
 
     void PushData(bool consume) final {
 
+        if (use_broadcast_join_) {
+            if (build_first_) {
+                if (shared_table1_) {
+                    HashJoin<InputTypeSecond>(
+                        *shared_table1_, pre_file2_, key_extractor2_,
+                        [this](const InputTypeFirst& b, const InputTypeSecond& p) {
+                            return join_function_(b, p);
+                        }, consume);
+                }
+                if (consume) shared_table1_.reset();
+            }
+            else {
+                if (shared_table2_) {
+                    HashJoin<InputTypeFirst>(
+                        *shared_table2_, pre_file1_, key_extractor1_,
+                        [this](const InputTypeSecond& b, const InputTypeFirst& p) {
+                            return join_function_(p, b);
+                        }, consume);
+                }
+                if (consume) shared_table2_.reset();
+            }
+            return;
+        }
+
+        if (use_hash_join_) {
+            if (build_first_) {
+                HashJoin<InputTypeSecond>(
+                    table1_, probe_file_, key_extractor2_,
+                    [this](const InputTypeFirst& b, const InputTypeSecond& p) {
+                        return join_function_(b, p);
+                    }, consume);
+                if (consume) table1_.Clear();
+            }
+            else {
+                HashJoin<InputTypeFirst>(
+                    table2_, probe_file_, key_extractor1_,
+                    [this](const InputTypeSecond& b, const InputTypeFirst& p) {
+                        return join_function_(p, b);
+                    }, consume);
+                if (consume) table2_.Clear();
+            }
+            return;
+        }
+
         auto compare_function_1 =
             [this](const InputTypeFirst& in1, const InputTypeFirst& in2) {
                 return key_extractor1_(in1) < key_extractor1_(in2);
@@ -290,6 +477,13 @@ public:
     void Dispose() final {
         files1_.clear();
         files2_.clear();
+        table1_.Clear();
+        table2_.Clear();
+        probe_file_.Clear();
+        shared_table1_.reset();
+        shared_table2_.reset();
+        pre_file1_.Clear();
+        pre_file2_.Clear();
     }
 
 private:
@@ -303,6 +497,58 @@ private:
     JoinFunction join_function_;
     HashFunction hash_function_;
 
+    //! join configuration
+    JoinConfig config_;
+
+    //! \name Hash Join
+    //! \{
+
+    //! number of items sent to each worker, first and second input interleaved
+    std::vector<size_t> num_sent_;
+
+    //! number of items received from the first and second input
+    size_t num_received1_ = 0, num_received2_ = 0;
+
+    //! whether this worker performs a hash join instead of a sort-merge join
+    bool use_hash_join_ = false;
+
+    //! whether the hash table is built from the first input
+    bool build_first_ = false;
+
+    //! hash table of the first or second input
+    HashTable1 table1_;
+    HashTable2 table2_;
+
+    //! unsorted items of the input streamed through the hash table
+    data::File probe_file_ { context_.GetFile(this) };
+
+    //! \}
+
+    //! heavy keys whose items are split across several workers
+    core::JoinHeavyKeys heavy_keys_;
+
+    //! bloom filter of the keys of the smaller input
+    core::GolombBloomFilter bloom_filter_;
+
+    //! whether the items of the first or second input are filtered by
+    //! bloom_filter_
+    bool filter1_ = false, filter2_ = false;
+
+    //! \name Broadcast Join
+    //! \{
+
+    //! whether the smaller input is replicated to all hosts
+    bool use_broadcast_join_ = false;
+
+    //! total number of items of the replicated input
+    size_t num_broadcast_ = 0;
+
+    //! hash table of the replicated input, shared by all workers of a host
+    std::shared_ptr<const HashTable1> shared_table1_;
+    std::shared_ptr<const HashTable2> shared_table2_;
+
+    //! \}
+
     //! data streams for inter-worker communication of DIA elements
     data::MixStreamPtr hash_stream1_ { context_.GetNewMixStream(this) };
     data::MixStream::Writers hash_writers1_ { hash_stream1_->GetWriters() };
@@ -319,29 +565,324 @@ private:
     bool location_detection_initialized_ = false;
 
     void PreOp1(const InputTypeFirst& input) {
+        if (!buffer_inputs_)
+            return ShuffleItem1(input);
+
         size_t hash = hash_function_(key_extractor1_(input));
-        if (UseLocationDetection) {
-            pre_writer1_.Put(input);
+        if (UseLocationDetection)
             location_detection_.Insert(HashCount { hash, 1, /* dia_mask */ 1 });
-        }
-        else {
-            hash_writers1_[hash % context_.num_workers()].Put(input);
-        }
+        if (JoinConfig::use_heavy_keys_)
+            heavy_keys_.Insert(hash, 0);
+        pre_writer1_.Put(input);
     }
 
     void PreOp2(const InputTypeSecond& input) {
+        if (!buffer_inputs_)
+            return ShuffleItem2(input);
+
         size_t hash = hash_function_(key_extractor2_(input));
-        if (UseLocationDetection) {
-            pre_writer2_.Put(input);
+        if (UseLocationDetection)
             location_detection_.Insert(HashCount { hash, 1, /* dia_mask */ 2 });
+        if (JoinConfig::use_heavy_keys_)
+            heavy_keys_.Insert(hash, 1);
+        pre_writer2_.Put(input);
+    }
+
+    //! send an item of the first input to the worker of its key's hash
+    void ShuffleItem1(const InputTypeFirst& input) {
+        size_t hash = hash_function_(key_extractor1_(input));
+        if (use_bloom_filter_ && filter1_ && !bloom_filter_.Contains(hash))
+            return;
+        if (SendHeavy(hash_writers1_, 0, hash, input))
+            return;
+        SendItem(hash_writers1_, 0, hash % context_.num_workers(), input);
+    }
+
+    //! send an item of the second input to the worker of its key's hash
+    void ShuffleItem2(const InputTypeSecond& input) {
+        size_t hash = hash_function_(key_extractor2_(input));
+        if (use_bloom_filter_ && filter2_ && !bloom_filter_.Contains(hash))
+            return;
+        if (SendHeavy(hash_writers2_, 1, hash, input))
+            return;
+        SendItem(hash_writers2_, 1, hash % context_.num_workers(), input);
+    }
+
+    //! send an item of the input with index input to a worker
+    template <typename ItemType>
+    void SendItem(data::MixStream::Writers& writers, size_t input,
+                  size_t target, const ItemType& item) {
+        writers[target].Put(item);
+        if (count_sent_)
+            ++num_sent_[2 * target + input];
+    }
+
+    //! send an item to the workers of its hash if the hash is heavy, returns
+    //! false if it is not.
+    template <typename ItemType>
+    bool SendHeavy(data::MixStream::Writers& writers, size_t input,
+                   size_t hash, const ItemType& item) {
+        if (!JoinConfig::use_heavy_keys_) return false;
+
+        core::JoinHeavyKeys::Heavy* heavy = heavy_keys_.Find(hash);
+        if (!heavy) return false;
+
+        heavy_keys_.Route(
+            *heavy, input,
+            [this, &writers, input, &item](size_t target) {
+                SendItem(writers, input, target, item);
+            });
+        return true;
+    }
+
+    /*!
+     * Build a bloom filter of the key hashes of the input with fewer items on
+     * all workers, by which the items of the other input are filtered before
+     * the shuffle. As each worker holds the whole filter, no filter is built
+     * if it would exceed bloom_filter_max_bytes.
+     */
+    void BuildBloomFilter() {
+        using Sizes = std::array<size_t, 2>;
+        Sizes sizes = context_.net.AllReduce(
+            Sizes { { pre_file1_.num_items(), pre_file2_.num_items() }
+            },
+            common::ComponentSum<Sizes>());
+
+        size_t filter_bytes = core::GolombBloomFilter::size_bytes(
+            std::min(sizes[0], sizes[1]));
+
+        if (filter_bytes > config_.bloom_filter_max_bytes()) {
+            this->logger_
+                << "class" << "JoinNode"
+                << "event" << "bloom_filter_skipped"
+                << "filter_bytes" << filter_bytes
+                << "items1" << sizes[0]
+                << "items2" << sizes[1];
+            return;
+        }
+
+        std::vector<size_t> hashes;
+        if (sizes[0] <= sizes[1]) {
+            hashes.reserve(pre_file1_.num_items());
+            auto reader = pre_file1_.GetKeepReader();
+            while (reader.HasNext()) {
+                InputTypeFirst in1 = reader.template Next<InputTypeFirst>();
+                hashes.push_back(hash_function_(key_extractor1_(in1)));
+            }
+            filter2_ = true;
         }
         else {
-            hash_writers2_[hash % context_.num_workers()].Put(input);
+            hashes.reserve(pre_file2_.num_items());
+            auto reader = pre_file2_.GetKeepReader();
+            while (reader.HasNext()) {
+                InputTypeSecond in2 = reader.template Next<InputTypeSecond>();
+                hashes.push_back(hash_function_(key_extractor2_(in2)));
+            }
+            filter1_ = true;
         }
+
+        bloom_filter_.Build(hashes, context_, Super::id());
+
+        this->logger_
+            << "class" << "JoinNode"
+            << "event" << "bloom_filter"
+            << "filter_first" << filter1_
+            << "filter_bytes" << filter_bytes
+            << "items1" << sizes[0]
+            << "items2" << sizes[1];
+    }
+
+    //! agree on the heavy keys from the sketch counters of all workers.
+    void SelectHeavyKeys() {
+        using Counters = std::vector<core::JoinHeavyKeys::Counter>;
+        using Sizes = std::array<size_t, 4>;
+
+        const std::array<size_t, 2>& num_sampled = heavy_keys_.num_sampled();
+        Sizes sizes = context_.net.AllReduce(
+            Sizes { { num_sampled[0], num_sampled[1],
+                      pre_file1_.num_items(), pre_file2_.num_items() }
+            },
+            common::ComponentSum<Sizes>());
+
+        Counters counters = context_.net.AllReduce(
+            heavy_keys_.counters(),
+            [this](const Counters& a, const Counters& b) {
+                return heavy_keys_.MergeCounters(a, b);
+            });
+
+        heavy_keys_.SetHeavyKeys(
+            counters, { { sizes[0], sizes[1] } }, { { sizes[2], sizes[3] } },
+            context_.num_workers(), context_.my_rank());
+
+        this->logger_
+            << "class" << "JoinNode"
+            << "event" << "heavy_keys"
+            << "num_heavy" << heavy_keys_.num_heavy();
+    }
+
+    /*!
+     * Select the broadcast join if the total size of the smaller input is at
+     * most broadcast_max_bytes_. The sizes of the buffered inputs are summed
+     * over all workers, hence all workers agree on the decision.
+     */
+    bool SelectBroadcast() {
+        using Sizes = std::array<size_t, 4>;
+        Sizes sizes = context_.net.AllReduce(
+            Sizes { { pre_file1_.size_bytes(), pre_file2_.size_bytes(),
+                      pre_file1_.num_items(), pre_file2_.num_items() }
+            },
+            common::ComponentSum<Sizes>());
+
+        build_first_ = (sizes[0] <= sizes[1]);
+        num_broadcast_ = build_first_ ? sizes[2] : sizes[3];
+
+        use_broadcast_join_ =
+            std::min(sizes[0], sizes[1]) <= config_.broadcast_max_bytes();
+
+        this->logger_
+            << "class" << "JoinNode"
+            << "event" << "select_broadcast"
+            << "broadcast_join" << use_broadcast_join_
+            << "build_first" << build_first_
+            << "bytes1" << sizes[0]
+            << "bytes2" << sizes[1];
+
+        return use_broadcast_join_;
+    }
+
+    /*!
+     * Replicate the smaller input to the first worker of each host, which
+     * builds a hash table that all workers of its host share read-only. The
+     * larger input stays in its pre file, and is streamed through the table by
+     * PushData().
+     */
+    void BroadcastMainOp() {
+        if (build_first_) {
+            shared_table1_ = BroadcastTable<InputTypeFirst, HashTable1>(
+                pre_file1_, hash_stream1_, hash_writers1_, key_extractor1_);
+        }
+        else {
+            shared_table2_ = BroadcastTable<InputTypeSecond, HashTable2>(
+                pre_file2_, hash_stream2_, hash_writers2_, key_extractor2_);
+        }
+
+        // nothing is sent on the stream of the larger input
+        hash_writers1_.Close();
+        hash_writers2_.Close();
+    }
+
+    //! Send all items of a pre file to the first worker of each host, build
+    //! the hash table there and share it with the host's other workers.
+    template <typename ItemType, typename HashTable, typename KeyExtractor>
+    std::shared_ptr<const HashTable> BroadcastTable(
+        data::File& file, data::MixStreamPtr& stream,
+        data::MixStream::Writers& writers, const KeyExtractor& key_extractor) {
+
+        size_t workers_per_host = context_.workers_per_host();
+
+        auto file_reader = file.GetConsumeReader();
+        while (file_reader.HasNext()) {
+            ItemType item = file_reader.template Next<ItemType>();
+            for (size_t h = 0; h < context_.num_hosts(); ++h)
+                writers[h * workers_per_host].Put(item);
+        }
+        writers.Close();
+
+        std::shared_ptr<HashTable> table;
+        data::MixStream::MixReader reader =
+            stream->GetMixReader(/* consume */ true);
+
+        if (context_.local_worker_id() == 0) {
+            table = std::make_shared<HashTable>(key_extractor, hash_function_);
+            table->Reserve(num_broadcast_);
+            while (reader.HasNext())
+                table->Insert(reader.template Next<ItemType>());
+            table->Build();
+        }
+        else {
+            // only the first worker of each host receives items
+            assert(!reader.HasNext());
+        }
+
+        return context_.net.LocalBroadcast(
+            std::shared_ptr<const HashTable>(std::move(table)));
+    }
+
+    /*!
+     * Select the hash join if it was requested, or if the hash table of the
+     * smaller input received by this worker fits into memory. The numbers of
+     * items each worker receives are summed over all workers' sent items, and
+     * the memory of the items is estimated from the bytes sent of each input,
+     * which include heap payloads such as strings.
+     */
+    void SelectJoinImpl() {
+        if (!count_sent_) return;
+
+        // append the bytes sent of both inputs to the items sent
+        num_sent_.push_back(hash_stream1_->tx_bytes());
+        num_sent_.push_back(hash_stream2_->tx_bytes());
+
+        std::vector<size_t> received = context_.net.AllReduce(
+            num_sent_,
+            [](const std::vector<size_t>& a, const std::vector<size_t>& b) {
+                std::vector<size_t> sum(a.size());
+                for (size_t i = 0; i < sum.size(); ++i)
+                    sum[i] = a[i] + b[i];
+                return sum;
+            });
+        std::vector<size_t>().swap(num_sent_);
+
+        num_received1_ = received[2 * context_.my_rank()];
+        num_received2_ = received[2 * context_.my_rank() + 1];
+
+        size_t total1 = 0, total2 = 0;
+        for (size_t w = 0; w < context_.num_workers(); ++w) {
+            total1 += received[2 * w];
+            total2 += received[2 * w + 1];
+        }
+        size_t tx_bytes1 = received[2 * context_.num_workers()];
+        size_t tx_bytes2 = received[2 * context_.num_workers() + 1];
+
+        size_t bytes1 = num_received1_ * HashTableItemBytes<HashTable1>(
+            sizeof(InputTypeFirst), tx_bytes1, total1);
+        size_t bytes2 = num_received2_ * HashTableItemBytes<HashTable2>(
+            sizeof(InputTypeSecond), tx_bytes2, total2);
+
+        build_first_ = (bytes1 <= bytes2);
+
+        use_hash_join_ =
+            JoinConfig::join_impl_ == JoinImpl::HASH ||
+            static_cast<double>(std::min(bytes1, bytes2)) <=
+            static_cast<double>(DIABase::mem_limit_)
+            * config_.hash_join_memory_rate();
+
+        this->logger_
+            << "class" << "JoinNode"
+            << "event" << "select_impl"
+            << "hash_join" << use_hash_join_
+            << "build_first" << build_first_
+            << "received1" << num_received1_
+            << "received2" << num_received2_
+            << "bytes1" << bytes1
+            << "bytes2" << bytes2;
+    }
+
+    //! Estimate the memory of an item in a hash table: the item and the
+    //! table's overhead, plus the part of the item's average serialized size
+    //! exceeding the item, which is held in the heap.
+    template <typename HashTable>
+    static size_t HashTableItemBytes(
+        size_t item_size, size_t tx_bytes, size_t tx_items) {
+        size_t serialized = tx_items ? tx_bytes / tx_items : 0;
+        return item_size + HashTable::item_overhead
+               + (serialized > item_size ? serialized - item_size : 0);
     }
 
     //! Receive elements from other workers, create pre-sorted files
     void MainOp() {
+        if (use_hash_join_)
+            return HashJoinMainOp();
+
         data::MixStream::MixReader reader1_ =
             hash_stream1_->GetMixReader(/* consume */ true);
 
@@ -357,6 +898,115 @@ private:
         ReceiveItems<InputTypeSecond>(capacity, reader2_, files2_, key_extractor2_);
     }
 
+    /*!
+     * Receive elements from other workers, insert the build input into the hash
+     * table and write the probe input unsorted into a File. If the hash table
+     * exceeds the memory limit while it is built, the join falls back to
+     * sort-merge: the table's items, the rest of the build input and the probe
+     * input are formed into sorted runs.
+     */
+    void HashJoinMainOp() {
+        data::MixStream::MixReader reader1 =
+            hash_stream1_->GetMixReader(/* consume */ true);
+
+        size_t capacity1 = DIABase::mem_limit_ / sizeof(InputTypeFirst) / 2;
+        size_t capacity2 = DIABase::mem_limit_ / sizeof(InputTypeSecond) / 2;
+
+        if (build_first_) {
+            if (!BuildHashTable<InputTypeFirst>(
+                    table1_, num_received1_, reader1)) {
+                use_hash_join_ = false;
+                ReceiveItems<InputTypeFirst>(
+                    capacity1, table1_.ReleaseItems(), reader1,
+                    files1_, key_extractor1_);
+                data::MixStream::MixReader reader2 =
+                    hash_stream2_->GetMixReader(/* consume */ true);
+                ReceiveItems<InputTypeSecond>(
+                    capacity2, reader2, files2_, key_extractor2_);
+                return;
+            }
+        }
+        else {
+            data::File::Writer writer = probe_file_.GetWriter();
+            while (reader1.HasNext())
+                writer.Put(reader1.template Next<InputTypeFirst>());
+        }
+
+        data::MixStream::MixReader reader2 =
+            hash_stream2_->GetMixReader(/* consume */ true);
+
+        if (!build_first_) {
+            if (!BuildHashTable<InputTypeSecond>(
+                    table2_, num_received2_, reader2)) {
+                use_hash_join_ = false;
+                // the probe File holds the first input unsorted.
+                data::File::ConsumeReader probe_reader =
+                    probe_file_.GetConsumeReader();
+                ReceiveItems<InputTypeFirst>(
+                    capacity1, probe_reader, files1_, key_extractor1_);
+                ReceiveItems<InputTypeSecond>(
+                    capacity2, table2_.ReleaseItems(), reader2,
+                    files2_, key_extractor2_);
+                return;
+            }
+        }
+        else {
+            data::File::Writer writer = probe_file_.GetWriter();
+            while (reader2.HasNext())
+                writer.Put(reader2.template Next<InputTypeSecond>());
+        }
+    }
+
+    /*!
+     * Insert the items of reader into the hash table and build it. Returns
+     * false, leaving the rest of the items in the reader, if the memory limit
+     * is exceeded or the table's items take more than the node's memory limit.
+     */
+    template <typename ItemType, typename HashTable, typename Reader>
+    bool BuildHashTable(HashTable& table, size_t num_items, Reader& reader) {
+        size_t max_items = DIABase::mem_limit_
+                           / (sizeof(ItemType) + HashTable::item_overhead);
+
+        table.Reserve(std::min(num_items, max_items));
+        while (reader.HasNext()) {
+            if (mem::memory_exceeded || table.size() >= max_items) {
+                LOG1 << "Thrill: Warning: InnerJoin hash table of "
+                     << table.size() << " items exceeds the memory limit, "
+                     << "falling back to sort-merge join.";
+                this->logger_
+                    << "class" << "JoinNode"
+                    << "event" << "hash_join_fallback"
+                    << "items" << table.size();
+                return false;
+            }
+            table.Insert(reader.template Next<ItemType>());
+        }
+        table.Build();
+        return true;
+    }
+
+    //! Stream the items of the probe File through the hash table and join them
+    //! with all items of equal key.
+    template <typename ProbeType, typename HashTable,
+              typename ProbeKeyExtractor, typename Join>
+    void HashJoin(const HashTable& table, data::File& probe_file,
+                  const ProbeKeyExtractor& key_extractor,
+                  const Join& join, bool consume) {
+        if (table.empty()) {
+            if (consume) probe_file.Clear();
+            return;
+        }
+
+        data::File::Reader reader = probe_file.GetReader(consume);
+        while (reader.HasNext()) {
+            ProbeType p = reader.template Next<ProbeType>();
+            table.Find(key_extractor(p),
+                       [this, &join, &p](const auto& b) {
+                           this->PushItem(join(b, p));
+                       });
+        }
+    }
+
     template <typename ItemType>
     size_t JoinCapacity() {
         return DIABase::mem_limit_ / sizeof(ItemType) / 4;
@@ -490,27 +1140,42 @@ private:
     }
 
     /*!
-     * Recieve all elements from a stream and write them to files sorted by key.
+     * Recieve all elements from a stream and write them to files sorted by key,
+     * using replacement selection with capacity items.
      */
-    template <typename ItemType, typename KeyExtractor>
+    template <typename ItemType, typename Reader, typename KeyExtractor>
     void ReceiveItems(
-        size_t capacity, data::MixStream::MixReader& reader,
+        size_t capacity, Reader& reader,
         std::deque<data::File>& files, const KeyExtractor& key_extractor) {
+        ReceiveItems<ItemType>(
+            capacity, std::vector<ItemType>(), reader, files, key_extractor);
+    }
 
-        std::vector<ItemType> vec;
-        vec.reserve(capacity);
+    //! Write the given items and all elements from a reader to files sorted by
+    //! key, using replacement selection with capacity items.
+    template <typename ItemType, typename Reader, typename KeyExtractor>
+    void ReceiveItems(
+        size_t capacity, std::vector<ItemType>&& items, Reader& reader,
+        std::deque<data::File>& files, const KeyExtractor& key_extractor) {
+
+        auto compare_function =
+            [&key_extractor](const ItemType& i1, const ItemType& i2) {
+                return key_extractor(i1) < key_extractor(i2);
+            };
+
+        core::RunGenerator<ItemType, decltype(compare_function)> run_generator(
+            context_.block_pool(), context_.local_worker_id(), this->id(),
+            files, capacity, compare_function);
+
+        for (ItemType& item : items)
+            run_generator.Insert(std::move(item));
+        std::vector<ItemType>().swap(items);
 
         while (reader.HasNext()) {
-            if (vec.size() < capacity) {
-                vec.push_back(reader.template Next<ItemType>());
-            }
-            else {
-                SortAndWriteToFile(vec, files, key_extractor);
-            }
+            run_generator.Insert(reader.template Next<ItemType>());
         }
 
-        if (vec.size())
-            SortAndWriteToFile(vec, files, key_extractor);
+        run_generator.Finish();
     }
 
     //! calculate maximum merging degree from available memory and the number of
@@ -662,32 +1327,6 @@ private:
             join_file2_->Clear();
         }
     }
-
-    /*!
-     * Sorts all elements in a vector and writes them to a file.
-     */
-    template <typename ItemType, typename KeyExtractor>
-    void SortAndWriteToFile(
-        std::vector<ItemType>& vec, std::deque<data::File>& files,
-        const KeyExtractor& key_extractor) {
-
-        // advise block pool to write out data if necessary
-        context_.block_pool().AdviseFree(vec.size() * sizeof(ValueType));
-
-        std::sort(vec.begin(), vec.end(),
-                  [&key_extractor](const ItemType& i1, const ItemType& i2) {
-                      return key_extractor(i1) < key_extractor(i2);
-                  });
-
-        files.emplace_back(context_.GetFile(this));
-        auto writer = files.back().GetWriter();
-        for (const ItemType& elem : vec) {
-            writer.Put(elem);
-        }
-        writer.Close();
-
-        vec.clear();
-    }
 };
 
 /*!
@@ -717,6 +1356,9 @@ private:
  *
  * \param hash_function If necessary a hash funtion for Key
  *
+ * \param join_config Selection of the local join algorithm, see
+ * DefaultJoinConfig.
+ *
  * \ingroup dia_dops
  */
 template <
@@ -727,13 +1369,15 @@ template <
     typename KeyExtractor2,
     typename JoinFunction,
     typename HashFunction =
-        std::hash<typename common::FunctionTraits<KeyExtractor1>::result_type> >
+        std::hash<typename common::FunctionTraits<KeyExtractor1>::result_type>,
+    typename JoinConfig = DefaultJoinConfig>
 auto InnerJoin(
     const LocationDetectionFlag<LocationDetectionValue>&,
     const FirstDIA& first_dia, const SecondDIA& second_dia,
     const KeyExtractor1& key_extractor1, const KeyExtractor2& key_extractor2,
     const JoinFunction& join_function,
-    const HashFunction& hash_function = HashFunction()) {
+    const HashFunction& hash_function = HashFunction(),
+    const JoinConfig& join_config = JoinConfig()) {
 
     assert(first_dia.IsValid());
     assert(second_dia.IsValid());
@@ -778,11 +1422,11 @@ auto InnerJoin(
 
     using JoinNode = api::JoinNode<
               JoinResult, FirstDIA, SecondDIA, KeyExtractor1, KeyExtractor2,
-              JoinFunction, HashFunction, LocationDetectionValue>;
+              JoinFunction, HashFunction, LocationDetectionValue, JoinConfig>;
 
     auto node = tlx::make_counting<JoinNode>(
         first_dia, second_dia, key_extractor1, key_extractor2, join_function,
-        hash_function);
+        hash_function, join_config);
 
     return DIA<JoinResult>(node);
 }
@@ -814,6 +1458,9 @@ auto InnerJoin(
  *
  * \param hash_function If necessary a hash funtion for Key
  *
+ * \param join_config Selection of the local join algorithm, see
+ * DefaultJoinConfig.
+ *
  * \ingroup dia_dops
  */
 template <
@@ -823,17 +1470,19 @@ template <
     typename KeyExtractor2,
     typename JoinFunction,
     typename HashFunction =
-        std::hash<typename common::FunctionTraits<KeyExtractor1>::result_type> >
+        std::hash<typename common::FunctionTraits<KeyExtractor1>::result_type>,
+    typename JoinConfig = DefaultJoinConfig>
 auto InnerJoin(
     const FirstDIA& first_dia, const SecondDIA& second_dia,
     const KeyExtractor1& key_extractor1, const KeyExtractor2& key_extractor2,
     const JoinFunction& join_function,
-    const HashFunction& hash_function = HashFunction()) {
+    const HashFunction& hash_function = HashFunction(),
+    const JoinConfig& join_config = JoinConfig()) {
     // forward to method _with_ location detection ON
     return InnerJoin(
         LocationDetectionTag,
         first_dia, second_dia, key_extractor1, key_extractor2,
-        join_function, hash_function);
+        join_function, hash_function, join_config);
 }
 
 //! \}
@@ -843,6 +1492,12 @@ auto InnerJoin(
 //! imported from api namespace
 using api::InnerJoin;
 
+//! imported from api namespace
+using api::DefaultJoinConfig;
+
+//! imported from api namespace
+using api::JoinImpl;
+
 } // namespace thrill
 
 #endif // !THRILL_API_INNER_JOIN_HEADER
@@ -0,0 +1,401 @@
+/*******************************************************************************
+ * thrill/api/keyed_state.hpp
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_API_KEYED_STATE_HEADER
+#define THRILL_API_KEYED_STATE_HEADER
+
+#include <thrill/api/cache.hpp>
+#include <thrill/api/concat_to_dia.hpp>
+#include <thrill/api/dia.hpp>
+#include <thrill/api/reduce_by_key.hpp>
+#include <thrill/api/source_node.hpp>
+#include <thrill/core/multiway_merge.hpp>
+#include <thrill/core/reduce_table.hpp>
+#include <thrill/core/run_generator.hpp>
+#include <thrill/data/file.hpp>
+#include <thrill/mem/malloc_tracker.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace thrill {
+namespace api {
+
+/*!
+ * Configuration class to define operational parameters of KeyedState. Members
+ * can be defined static constexpr or be mutable variables.
+ */
+class DefaultKeyedStateConfig
+{
+public:
+    //! hold the state in an in-memory hash map instead of a File. This is
+    //! faster for small states, but the map is not accounted in any memory
+    //! limit and never spills to external memory.
+    static constexpr bool in_memory_ = false;
+
+    //! fraction of the worker's memory limit used to form sorted runs of the
+    //! deltas of an update.
+    double run_memory_rate_ = 0.25;
+
+    //! Returns run_memory_rate_
+    double run_memory_rate() const { return run_memory_rate_; }
+};
+
+/*!
+ * A SourceNode which pushes the items of a File, used for the pairs returned
+ * by KeyedState.
+ *
+ * \ingroup api_layer
+ */
+template <typename ValueType>
+class KeyedStateNode final : public SourceNode<ValueType>
+{
+public:
+    using Super = SourceNode<ValueType>;
+
+    KeyedStateNode(Context& ctx, data::File&& file)
+        : Super(ctx, "KeyedState"), file_(std::move(file)) { }
+
+    void PushData(bool consume) final {
+        this->PushFile(file_, consume);
+    }
+
+    void Dispose() final {
+        file_.Clear();
+    }
+
+private:
+    //! items to push
+    data::File file_;
+};
+
+/*!
+ * \ingroup api_layer
+ *
+ * Keyed state of an iterative algorithm, which persists across iterations
+ * instead of being rebuilt from the full data set in each one. Each worker
+ * keeps the (key, value) pairs of the keys which the hash partitioning of
+ * ReducePair assigns to it in a local table, which lives as long as the
+ * KeyedState object.
+ *
+ * Update() takes a DIA of delta pairs: only these are reduced by key and
+ * shuffled by ReducePair, which delivers each key's delta to the worker
+ * holding its state. There, the update function merges the delta into the
+ * key's value, which starts as the initial value for new keys. Update() returns
+ * a DIA of only the pairs whose value changed according to ChangedFunction.
+ * All() returns a DIA of all pairs.
+ *
+ * The KeyedState must be constructed and updated on all workers alike, and
+ * with the same ReduceConfig and KeyHashFunction, such that keys always land on
+ * the same worker.
+ *
+ * By default, each worker's part of the state is a File of pairs ordered by
+ * key hash, which the block pool may swap out. An update forms sorted runs of
+ * the deltas within a fraction of the worker's memory limit, and merges them
+ * with the state File into a new one. Hence, the state may exceed main memory.
+ * Keys must be comparable with ==.
+ *
+ * With KeyedStateConfig::in_memory_, the state is a plain in-memory hash map
+ * instead, which is not accounted in any memory limit and never spills. Then
+ * the keys of each worker's part of the state must fit into its main memory,
+ * and a warning is logged if an update exceeds the memory limit.
+ */
+template <typename Key, typename Value, typename UpdateFunction,
+          typename ReduceConfig = core::DefaultReduceConfig,
+          typename KeyHashFunction = std::hash<Key>,
+          typename ChangedFunction = std::not_equal_to<Value>,
+          typename KeyedStateConfig = DefaultKeyedStateConfig>
+class KeyedState
+{
+    static constexpr bool debug = false;
+
+public:
+    using Pair = std::pair<Key, Value>;
+
+    KeyedState(Context& ctx, const Value& initial,
+               const UpdateFunction& update_function,
+               const ReduceConfig& reduce_config = ReduceConfig(),
+               const KeyHashFunction& key_hash_function = KeyHashFunction(),
+               const ChangedFunction& changed_function = ChangedFunction(),
+               const KeyedStateConfig& config = KeyedStateConfig())
+        : context_(ctx), initial_(initial),
+          update_function_(update_function), reduce_config_(reduce_config),
+          key_hash_function_(key_hash_function),
+          changed_function_(changed_function), config_(config),
+          state_(0, key_hash_function),
+          state_file_(context_.GetFile(nullptr)) { }
+
+    /*!
+     * Reduces the deltas by key with reduce_function, merges them into the
+     * state, and returns a DIA of the changed pairs. The update is executed
+     * immediately.
+     */
+    template <typename ReduceFunction, typename DeltaStack>
+    DIA<Pair> Update(const DIA<Pair, DeltaStack>& deltas,
+                     const ReduceFunction& reduce_function) {
+        return UpdateLocal(
+            deltas.ReducePair(
+                reduce_function, reduce_config_, key_hash_function_),
+            std::integral_constant<bool, KeyedStateConfig::in_memory_>());
+    }
+
+    //! Returns a DIA of all (key, value) pairs of the state.
+    DIA<Pair> All() const {
+        return AllLocal(
+            std::integral_constant<bool, KeyedStateConfig::in_memory_>());
+    }
+
+    //! Returns the number of keys held by this worker.
+    size_t local_size() const {
+        return KeyedStateConfig::in_memory_
+               ? state_.size() : state_file_.num_items();
+    }
+
+private:
+    //! Context
+    Context& context_;
+    //! value of new keys before their first update
+    Value initial_;
+    //! merges a reduced delta into a key's value
+    UpdateFunction update_function_;
+    //! config of the ReducePair shuffling the deltas
+    ReduceConfig reduce_config_;
+    //! hash function for the partitioning and the local table
+    KeyHashFunction key_hash_function_;
+    //! returns true if the value of a key changed by an update
+    ChangedFunction changed_function_;
+    //! config of the state storage
+    KeyedStateConfig config_;
+    //! local part of the state if held in memory
+    std::unordered_map<Key, Value, KeyHashFunction> state_;
+    //! local part of the state ordered by key hash, otherwise
+    data::File state_file_;
+
+    //! orders pairs by the hash of their key
+    class HashLess
+    {
+    public:
+        explicit HashLess(const KeyHashFunction& key_hash_function)
+            : key_hash_function_(key_hash_function) { }
+
+        bool operator () (const Pair& a, const Pair& b) const {
+            return key_hash_function_(a.first) < key_hash_function_(b.first);
+        }
+
+    private:
+        KeyHashFunction key_hash_function_;
+    };
+
+    //! Merge the reduced deltas into the in-memory hash map.
+    template <typename ReducedDIA>
+    DIA<Pair> UpdateLocal(const ReducedDIA& reduced, std::true_type /* in_memory */) {
+        size_t num_keys = state_.size();
+
+        DIA<Pair> changed =
+            reduced
+            .template FlatMap<Pair>(
+                [this](const Pair& delta, auto emit) {
+                    auto it = state_.find(delta.first);
+                    if (it == state_.end()) {
+                        it = state_.emplace(
+                            delta.first,
+                            update_function_(initial_, delta.second)).first;
+                        emit(*it);
+                        return;
+                    }
+                    Value v = update_function_(it->second, delta.second);
+                    if (changed_function_(it->second, v)) {
+                        it->second = std::move(v);
+                        emit(*it);
+                    }
+                })
+            .Cache();
+        changed.Execute();
+
+        sLOG << "KeyedState::Update() worker" << context_.my_rank()
+             << "new keys" << state_.size() - num_keys
+             << "total keys" << state_.size();
+
+        if (mem::memory_exceeded) {
+            LOG1 << "Thrill: Warning: KeyedState with " << state_.size()
+                 << " keys exceeds the memory limit, it cannot spill.";
+        }
+
+        return changed;
+    }
+
+    /*!
+     * Merge the reduced deltas into the state File: the deltas are formed into
+     * runs sorted by key hash, which are merged with the state File into a new
+     * state File and a File of the changed pairs.
+     */
+    template <typename ReducedDIA>
+    DIA<Pair> UpdateLocal(const ReducedDIA& reduced, std::false_type /* in_memory */) {
+        size_t num_keys = state_file_.num_items();
+
+        std::deque<data::File> runs;
+        core::RunGenerator<Pair, HashLess> run_generator(
+            context_.block_pool(), context_.local_worker_id(), /* dia_id */ 0,
+            runs, static_cast<size_t>(
+                static_cast<double>(context_.mem_limit())
+                * config_.run_memory_rate()) / sizeof(Pair),
+            HashLess(key_hash_function_));
+
+        // the FlatMap only collects the deltas, hence the Cache stays empty.
+        reduced
+        .template FlatMap<Pair>(
+            [&run_generator](const Pair& delta, auto /* emit */) {
+                run_generator.UpdateMemoryPressure(mem::memory_exceeded);
+                run_generator.Insert(delta);
+            })
+        .Cache().Execute();
+        run_generator.Finish();
+
+        data::File changed = context_.GetFile(nullptr);
+        if (!runs.empty()) {
+            std::vector<data::File::ConsumeReader> seq;
+            seq.reserve(runs.size());
+            for (data::File& run : runs)
+                seq.emplace_back(run.GetConsumeReader());
+
+            auto puller = core::make_multiway_merge_tree<Pair>(
+                seq.begin(), seq.end(), HashLess(key_hash_function_));
+            state_file_ = MergeDeltas(puller, changed);
+        }
+
+        sLOG << "KeyedState::Update() worker" << context_.my_rank()
+             << "runs" << runs.size()
+             << "new keys" << state_file_.num_items() - num_keys
+             << "total keys" << state_file_.num_items();
+
+        return DIA<Pair>(tlx::make_counting<KeyedStateNode<Pair> >(
+                             context_, std::move(changed)));
+    }
+
+    /*!
+     * Merge the deltas delivered by puller, which are ordered by key hash and
+     * have distinct keys, with the state File into a new state File, which is
+     * returned, and write changed pairs into changed. Pairs with equal key hash
+     * are collected in a group and matched by key.
+     */
+    template <typename Puller>
+    data::File MergeDeltas(Puller& puller, data::File& changed) {
+        data::File new_state = context_.GetFile(nullptr);
+        data::File::Writer state_writer = new_state.GetWriter();
+        data::File::Writer changed_writer = changed.GetWriter();
+
+        data::File::ConsumeReader state_reader = state_file_.GetConsumeReader();
+        bool has_state = state_reader.HasNext();
+        Pair state = has_state ? state_reader.Next<Pair>() : Pair();
+        size_t state_hash = has_state ? key_hash_function_(state.first) : 0;
+
+        auto next_state = [&]() {
+                              has_state = state_reader.HasNext();
+                              if (!has_state) return;
+                              state = state_reader.Next<Pair>();
+                              state_hash = key_hash_function_(state.first);
+                          };
+
+        // pairs of the state and new keys with key hash group_hash
+        std::vector<Pair> group;
+        size_t group_hash = 0;
+
+        while (puller.HasNext()) {
+            Pair delta = puller.Next();
+            size_t hash = key_hash_function_(delta.first);
+
+            if (group.empty() || hash != group_hash) {
+                for (const Pair& p : group)
+                    state_writer.Put(p);
+                group.clear();
+                group_hash = hash;
+
+                while (has_state && state_hash < hash) {
+                    state_writer.Put(state);
+                    next_state();
+                }
+                while (has_state && state_hash == hash) {
+                    group.emplace_back(std::move(state));
+                    next_state();
+                }
+            }
+
+            auto it = std::find_if(
+                group.begin(), group.end(),
+                [&delta](const Pair& p) { return p.first == delta.first; });
+
+            if (it == group.end()) {
+                group.emplace_back(
+                    delta.first, update_function_(initial_, delta.second));
+                changed_writer.Put(group.back());
+                continue;
+            }
+            Value v = update_function_(it->second, delta.second);
+            if (changed_function_(it->second, v)) {
+                it->second = std::move(v);
+                changed_writer.Put(*it);
+            }
+        }
+
+        for (const Pair& p : group)
+            state_writer.Put(p);
+        while (has_state) {
+            state_writer.Put(state);
+            next_state();
+        }
+
+        state_writer.Close();
+        changed_writer.Close();
+        return new_state;
+    }
+
+    DIA<Pair> AllLocal(std::true_type /* in_memory */) const {
+        return ConcatToDIA(
+            context_, std::vector<Pair>(state_.begin(), state_.end()));
+    }
+
+    DIA<Pair> AllLocal(std::false_type /* in_memory */) const {
+        return DIA<Pair>(tlx::make_counting<KeyedStateNode<Pair> >(
+                             context_, state_file_.Copy()));
+    }
+};
+
+//! Construct a KeyedState with template parameters deduced from the arguments.
+template <typename Key, typename Value, typename UpdateFunction,
+          typename ReduceConfig = core::DefaultReduceConfig,
+          typename KeyedStateConfig = DefaultKeyedStateConfig>
+auto MakeKeyedState(Context& ctx, const Value& initial,
+                    const UpdateFunction& update_function,
+                    const ReduceConfig& reduce_config = ReduceConfig(),
+                    const KeyedStateConfig& config = KeyedStateConfig()) {
+    return KeyedState<Key, Value, UpdateFunction, ReduceConfig,
+                      std::hash<Key>, std::not_equal_to<Value>,
+                      KeyedStateConfig>(
+        ctx, initial, update_function, reduce_config,
+        std::hash<Key>(), std::not_equal_to<Value>(), config);
+}
+
+} // namespace api
+
+//! imported from api namespace
+using api::KeyedState;
+
+//! imported from api namespace
+using api::MakeKeyedState;
+
+} // namespace thrill
+
+#endif // !THRILL_API_KEYED_STATE_HEADER
+
+/******************************************************************************/
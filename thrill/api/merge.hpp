@@ -109,6 +109,10 @@ public:
 
         tlx::call_foreach_with_index(
             RegisterParent(this), parent0, parents...);
+
+        DIAProperties properties;
+        properties.sorted_by = DIAProperties::Stateless<Comparator>();
+        this->set_properties(properties);
     }
 
     //! Register Parent PreOp Hooks, instantiated and called for each Merge
@@ -22,6 +22,7 @@
 #include <thrill/common/logger.hpp>
 #include <thrill/common/porting.hpp>
 #include <thrill/core/reduce_by_hash_post_phase.hpp>
+#include <thrill/core/reduce_hot_keys.hpp>
 #include <thrill/core/reduce_pre_phase.hpp>
 #include <tlx/meta/is_std_pair.hpp>
 
@@ -77,16 +78,30 @@ private:
 
     using HashIndexFunction = core::ReduceByHash<Key, KeyHashFunction>;
 
+    using HotKeys = core::ReduceHotKeys<
+              ValueType, Key, KeyExtractor, ReduceFunction,
+              KeyHashFunction, KeyEqualFunction>;
+
     static constexpr bool use_mix_stream_ = ReduceConfig::use_mix_stream_;
     static constexpr bool use_post_thread_ = ReduceConfig::use_post_thread_;
 
+    //! whether the pre and post phase tables share a memory budget, which
+    //! only the growing ProbingHashTable supports.
+    static constexpr bool use_memory_budget_ =
+        use_post_thread_ && ReduceConfig::use_shared_memory_budget_ &&
+        ReduceConfig::table_impl_ == core::ReduceTableImpl::PROBING;
+
     //! Emitter for PostPhase to push elements to next DIA object.
     class Emitter
     {
     public:
         explicit Emitter(ReduceNode* node) : node_(node) { }
-        void operator () (const ValueType& item) const
-        { return node_->PushItem(item); }
+        void operator () (const ValueType& item) const {
+            // partial results of hot keys are combined over all workers.
+            if (ReduceConfig::use_hot_keys_ && node_->hot_keys_.Absorb(item))
+                return;
+            return node_->PushItem(item);
+        }
 
     private:
         ReduceNode* node_;
@@ -112,26 +127,66 @@ public:
                       nullptr : parent.ctx().GetNewCatStream(this)),
           emitters_(use_mix_stream_ ?
                     mix_stream_->GetWriters() : cat_stream_->GetWriters()),
+          host_combine_(ReduceConfig::use_host_combine_ &&
+                        !UseDuplicateDetection &&
+                        parent.ctx().num_hosts() > 1 &&
+                        parent.ctx().workers_per_host() > 1),
+          combine_stream_(host_combine_ ?
+                          parent.ctx().GetNewCatStream(this) : nullptr),
+          combine_emitters_(host_combine_ ?
+                            combine_stream_->GetWriters() :
+                            data::Stream::Writers()),
+          memory_budget_(/* num_accounts */ 2, config.memory_reserve_rate()),
           pre_phase_(
               context_, Super::id(), parent.ctx().num_workers(),
-              key_extractor, reduce_function, emitters_, config,
+              key_extractor, reduce_function,
+              host_combine_ ? combine_emitters_ : emitters_, config,
               HashIndexFunction(key_hash_function), key_equal_function,
               key_hash_function),
           post_phase_(
               context_, Super::id(), key_extractor, reduce_function,
               Emitter(this), config,
-              HashIndexFunction(key_hash_function), key_equal_function)
+              HashIndexFunction(key_hash_function), key_equal_function),
+          combine_phase_(
+              context_, Super::id(), parent.ctx().num_workers(),
+              key_extractor, reduce_function, emitters_, config,
+              HashIndexFunction(key_hash_function), key_equal_function,
+              key_hash_function),
+          hot_keys_(key_extractor, reduce_function,
+                    ReduceConfig::hot_key_capacity_,
+                    ReduceConfig::hot_key_sample_size_, config.hot_key_rate(),
+                    key_hash_function, key_equal_function)
     {
         // Hook PreOp: Locally hash elements of the current DIA onto buckets and
         // reduce each bucket to a single value, afterwards send data to another
-        // worker given by the shuffle algorithm.
+        // worker given by the shuffle algorithm. If the local reduction does
+        // not pay off, items are sent directly. Items of hot keys are
+        // aggregated locally.
         auto pre_op_fn = [this](const ValueType& input) {
-                             return pre_phase_.Insert(input);
+                             if (ReduceConfig::use_hot_keys_ &&
+                                 hot_keys_.Insert(input)) return;
+                             pre_phase_.InsertAdaptive(input);
                          };
         // close the function stack with our pre op and register it at
         // parent node for output
         auto lop_chain = parent.stack().push(pre_op_fn).fold();
         parent.node()->AddChild(this, lop_chain);
+
+        if (host_combine_) {
+            // send the partition of each worker to the local worker with the
+            // same local id, which combines it for all workers of this host.
+            std::vector<size_t> writer_map(context_.num_workers());
+            for (size_t w = 0; w < writer_map.size(); ++w) {
+                writer_map[w] = context_.host_rank() * context_.workers_per_host()
+                                + w % context_.workers_per_host();
+            }
+            pre_phase_.SetWriterMap(std::move(writer_map));
+        }
+
+        // each key is reduced to a single item on one worker
+        DIAProperties properties;
+        properties.partitioned_by = DIAProperties::Stateless<KeyExtractor>();
+        this->set_properties(properties);
     }
 
     DIAMemUse PreOpMemUse() final {
@@ -147,8 +202,20 @@ public:
             pre_phase_.Initialize(DIABase::mem_limit_);
         }
         else {
-            pre_phase_.Initialize(DIABase::mem_limit_ / 2);
-            post_phase_.Initialize(DIABase::mem_limit_ / 2);
+            if (use_memory_budget_) {
+                // both tables may grow up to the memory not reserved for the
+                // other one. They allocate their partitions as granted by the
+                // budget, which limits their sum to mem_limit_.
+                memory_budget_.Initialize(DIABase::mem_limit_);
+                pre_phase_.SetMemoryBudget(&memory_budget_, 0);
+                post_phase_.SetMemoryBudget(&memory_budget_, 1);
+                pre_phase_.Initialize(memory_budget_.max_account_bytes());
+                post_phase_.Initialize(memory_budget_.max_account_bytes());
+            }
+            else {
+                pre_phase_.Initialize(DIABase::mem_limit_ / 2);
+                post_phase_.Initialize(DIABase::mem_limit_ / 2);
+            }
 
             // start additional thread to receive from the channel
             thread_ = common::CreateThread([this] { ProcessChannel(); });
@@ -157,12 +224,24 @@ public:
 
     void StopPreOp(size_t /* id */) final {
         LOG << *this << " running StopPreOp";
+        if (ReduceConfig::use_hot_keys_)
+            SelectHotKeys();
         // Flush hash table before the postOp
         pre_phase_.FlushAll();
         pre_phase_.CloseAll();
+        if (host_combine_)
+            CombineHost();
         if (use_post_thread_) {
             // waiting for the additional thread to finish the reduce
             thread_.join();
+            if (use_memory_budget_) {
+                this->logger_
+                    << "class" << "ReduceNode"
+                    << "event" << "memory_budget"
+                    << "limit" << memory_budget_.limit_bytes()
+                    << "pre_denied" << memory_budget_.num_denied(0)
+                    << "post_denied" << memory_budget_.num_denied(1);
+            }
             // deallocate stream if already processed
             use_mix_stream_ ? mix_stream_.reset() : cat_stream_.reset();
         }
@@ -187,6 +266,82 @@ public:
             reduced_ = true;
         }
         post_phase_.PushData(consume);
+
+        if (ReduceConfig::use_hot_keys_)
+            PushHotKeys(consume);
+    }
+
+    //! reduce the partitions sent by all workers of this host, and send them
+    //! to their workers.
+    void CombineHost() {
+        // the combine phase reuses the memory of the pre phase's table
+        if (!use_post_thread_)
+            combine_phase_.Initialize(DIABase::mem_limit_);
+        else if (use_memory_budget_) {
+            // take over the account of the disposed pre phase table
+            combine_phase_.SetMemoryBudget(&memory_budget_, 0);
+            combine_phase_.Initialize(memory_budget_.max_account_bytes());
+        }
+        else
+            combine_phase_.Initialize(DIABase::mem_limit_ / 2);
+
+        auto reader = combine_stream_->GetCatReader(/* consume */ true);
+        while (reader.HasNext()) {
+            combine_phase_.InsertTableItem(reader.template Next<TableItem>());
+        }
+        combine_stream_.reset();
+
+        combine_phase_.FlushAll();
+        combine_phase_.CloseAll();
+    }
+
+    //! agree on the globally hot keys, and reduce all other locally
+    //! aggregated keys as usual.
+    void SelectHotKeys() {
+        using Candidates = std::vector<typename HotKeys::Candidate>;
+
+        size_t total_items = context_.net.AllReduce(hot_keys_.num_items());
+
+        Candidates candidates = context_.net.AllReduce(
+            hot_keys_.candidates(),
+            [this](const Candidates& a, const Candidates& b) {
+                return hot_keys_.MergeCandidates(a, b);
+            });
+
+        hot_keys_.SetHotKeys(
+            candidates, total_items,
+            [this](const ValueType& v) { pre_phase_.Insert(v); });
+
+        // the result of a hot key is emitted by the worker owning the key,
+        // hence the output remains partitioned by key.
+        for (const ValueType& v : hot_keys_.hot_items())
+            hot_home_.push_back(pre_phase_.partition_id(v));
+    }
+
+    //! combine the partial results of hot keys with a tree reduction and push
+    //! those owned by this worker.
+    void PushHotKeys(bool consume) {
+        using Partials = std::vector<typename HotKeys::Partial>;
+
+        if (!hot_reduced_) {
+            Partials partials = context_.net.AllReduce(
+                hot_keys_.TakePartials(),
+                [this](const Partials& a, const Partials& b) {
+                    return hot_keys_.MergePartials(a, b);
+                });
+
+            for (const typename HotKeys::Partial& p : partials) {
+                if (hot_home_[p.first] == context_.my_rank())
+                    hot_results_.push_back(p.second);
+            }
+            hot_reduced_ = true;
+        }
+
+        for (const ValueType& v : hot_results_)
+            this->PushItem(v);
+
+        if (consume)
+            std::vector<ValueType>().swap(hot_results_);
     }
 
     //! process the inbound data in the post reduce phase
@@ -197,7 +352,7 @@ public:
             sLOG << "reading data from" << mix_stream_->id()
                  << "to push into post phase which flushes to" << this->id();
             while (reader.HasNext()) {
-                post_phase_.Insert(reader.template Next<TableItem>());
+                post_phase_.InsertBatched(reader.template Next<TableItem>());
             }
         }
         else
@@ -206,7 +361,7 @@ public:
             sLOG << "reading data from" << cat_stream_->id()
                  << "to push into post phase which flushes to" << this->id();
             while (reader.HasNext()) {
-                post_phase_.Insert(reader.template Next<TableItem>());
+                post_phase_.InsertBatched(reader.template Next<TableItem>());
             }
         }
     }
@@ -222,9 +377,20 @@ private:
     data::CatStreamPtr cat_stream_;
 
     data::Stream::Writers emitters_;
+
+    //! whether the pre phase output is combined per host
+    bool host_combine_;
+    //! stream to the local workers combining the pre phase output
+    data::CatStreamPtr combine_stream_;
+    //! writers of combine_stream_
+    data::Stream::Writers combine_emitters_;
+
     //! handle to additional thread for post phase
     std::thread thread_;
 
+    //! memory shared by the pre and post phase tables, if use_memory_budget_
+    core::ReduceMemoryBudget memory_budget_;
+
     core::ReducePrePhase<
         TableItem, Key, ValueType, KeyExtractor,
         ReduceFunction, VolatileKey, data::Stream::Writer, ReduceConfig,
@@ -236,7 +402,30 @@ private:
         VolatileKey, ReduceConfig,
         HashIndexFunction, KeyEqualFunction> post_phase_;
 
+    //! reduces the pre phase output of all workers of this host
+    core::ReducePrePhase<
+        TableItem, Key, ValueType, KeyExtractor,
+        ReduceFunction, VolatileKey, data::Stream::Writer, ReduceConfig,
+        HashIndexFunction, KeyEqualFunction, KeyHashFunction> combine_phase_;
+
     bool reduced_ = false;
+
+    //! \name Hot Keys
+    //! \{
+
+    //! detection and partial results of hot keys
+    HotKeys hot_keys_;
+
+    //! worker owning each hot key
+    std::vector<size_t> hot_home_;
+
+    //! results of hot keys owned by this worker
+    std::vector<ValueType> hot_results_;
+
+    //! whether the partial results of hot keys were combined
+    bool hot_reduced_ = false;
+
+    //! \}
 };
 
 template <typename ValueType, typename Stack>
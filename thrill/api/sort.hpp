@@ -21,24 +21,341 @@
 #include <thrill/common/math.hpp>
 #include <thrill/common/porting.hpp>
 #include <thrill/common/qsort.hpp>
+#include <thrill/common/radix_sort.hpp>
 #include <thrill/common/reservoir_sampling.hpp>
+#include <thrill/common/string_sort.hpp>
+#include <thrill/core/lcp_multiway_merge.hpp>
 #include <thrill/core/multiway_merge.hpp>
+#include <thrill/core/run_generator.hpp>
 #include <thrill/data/file.hpp>
 #include <thrill/net/group.hpp>
+#include <tlx/define/likely.hpp>
 #include <tlx/math/integer_log2.hpp>
 
 #include <algorithm>
+#include <cmath>
+#include <condition_variable>
 #include <cstdlib>
 #include <deque>
 #include <functional>
+#include <mutex>
 #include <numeric>
 #include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace thrill {
 namespace api {
 
+/*!
+ * Configuration class to define operational parameters of the SortNode. Most
+ * members can be defined static constexpr or be mutable variables.
+ */
+class DefaultSortConfig
+{
+public:
+    //! minimum number of workers for which the multi-level (AMS-style) splitter
+    //! selection is used instead of sending all samples to worker 0.
+    size_t multi_level_min_workers_ = 256;
+
+    //! maximum number of subgroups each worker group is split into per level
+    //! of the multi-level sample sort.
+    size_t multi_level_fanout_ = 16;
+
+    //! receive items in a separate thread while classifying and transmitting
+    //! the local items.
+    bool use_background_thread_ = false;
+
+    //! sort and write runs in a helper thread while the next run is received.
+    bool pipelined_run_formation_ = false;
+
+    //! form runs using replacement selection, which yields runs of about twice
+    //! the memory size and fewer merge passes for data much larger than RAM.
+    //! Takes precedence over pipelined_run_formation_.
+    bool replacement_selection_ = false;
+};
+
+/*!
+ * Comparator used by Sort() with a normalized key extractor. The KeyExtractor
+ * maps each item to an unsigned integer key, which must be a prefix of the
+ * order defined by CompareFunction: key(a) < key(b) implies compare(a,b). Items
+ * are compared by their keys, the CompareFunction is called only on key ties.
+ */
+template <typename ValueType, typename KeyExtractor, typename CompareFunction>
+class NormalizedKeyCompare
+{
+public:
+    using KeyRet = decltype(
+              std::declval<KeyExtractor>()(std::declval<const ValueType&>()));
+    using Key = typename std::remove_cv<
+              typename std::remove_reference<KeyRet>::type>::type;
+
+    static_assert(std::is_unsigned<Key>::value,
+                  "KeyExtractor must return an unsigned integer key");
+
+    NormalizedKeyCompare(const KeyExtractor& key_extractor,
+                         const CompareFunction& compare_function)
+        : key_extractor_(key_extractor),
+          compare_function_(compare_function) { }
+
+    //! extract the normalized key of an item
+    Key key(const ValueType& v) const { return key_extractor_(v); }
+
+    //! compare by normalized key, fall back to comparator on ties
+    bool operator () (const ValueType& a, const ValueType& b) const {
+        Key ka = key_extractor_(a), kb = key_extractor_(b);
+        if (ka != kb) return ka < kb;
+        return compare_function_(a, b);
+    }
+
+    //! compare two items with equal keys using the comparator
+    bool tie_less(const ValueType& a, const ValueType& b) const {
+        return compare_function_(a, b);
+    }
+
+    const KeyExtractor& key_extractor() const { return key_extractor_; }
+
+private:
+    KeyExtractor key_extractor_;
+    CompareFunction compare_function_;
+};
+
+/*!
+ * SortAlgorithm class for Sort() with a normalized key extractor, which forms
+ * runs using MSD radix sort on the keys.
+ */
+class NormalizedKeySortAlgorithm
+{
+public:
+    template <typename Iterator, typename CompareFunction>
+    void operator () (Iterator begin, Iterator end,
+                      const CompareFunction& cmp) const {
+        common::radix_sort_key_CI(begin, end, cmp.key_extractor(), cmp);
+    }
+};
+
+/*!
+ * SortAlgorithm class for Sort() of std::string with std::less: forms runs using
+ * multikey quicksort, stores them front-coded, and merges them with an
+ * LCP-aware loser tree, see SortRunFormat.
+ */
+class StringSortAlgorithm
+{
+public:
+    template <typename Iterator, typename CompareFunction>
+    void operator () (Iterator begin, Iterator end,
+                      const CompareFunction& /* cmp */) const {
+        static_assert(
+            std::is_same<CompareFunction, std::less<std::string> >::value,
+            "StringSortAlgorithm requires std::less<std::string>");
+        common::multikey_quicksort(begin, end);
+    }
+};
+
+/*!
+ * Defines how SortNode stores sorted runs in Files and merges them. By default,
+ * items are stored as they are and merged using core::MultiwayMergeTree.
+ */
+template <typename ValueType, typename SortAlgorithm>
+class SortRunFormat
+{
+public:
+    //! whether runs contain plain items, which can be pushed as a File.
+    static constexpr bool plain = true;
+
+    template <typename Writer>
+    using RunWriter = Writer;
+
+    template <typename Reader>
+    using RunReader = Reader;
+
+    template <typename ReaderIterator, typename CompareFunction>
+    static auto MakeMergeTree(ReaderIterator begin, ReaderIterator end,
+                              const CompareFunction& compare_function) {
+        return core::make_multiway_merge_tree<ValueType>(
+            begin, end, compare_function);
+    }
+};
+
+/*!
+ * Runs of StringSortAlgorithm are front-coded, which shrinks spilled data, and
+ * the stored LCPs are used for LCP-aware merging.
+ */
+template <>
+class SortRunFormat<std::string, StringSortAlgorithm>
+{
+public:
+    static constexpr bool plain = false;
+
+    template <typename Writer>
+    using RunWriter = core::FrontCodedStringWriter<Writer>;
+
+    template <typename Reader>
+    using RunReader = core::FrontCodedStringReader<Reader>;
+
+    template <typename ReaderIterator, typename CompareFunction>
+    static auto MakeMergeTree(ReaderIterator begin, ReaderIterator end,
+                              const CompareFunction& /* compare_function */) {
+        return core::make_lcp_multiway_merge_tree(begin, end);
+    }
+};
+
+/*!
+ * Classifies items by descending the binary splitter tree in
+ * SortNode::TransmitItems() using the generic comparator. Besides the bucket,
+ * FindBlock() returns whether an item is equal to the splitter left of its
+ * bucket, such that items equal to splitters land in explicit equality
+ * buckets.
+ */
+template <typename ValueType, typename CompareFunction>
+class SortSplitterClassifier
+{
+public:
+    using SampleIndexPair = std::pair<ValueType, size_t>;
+
+    SortSplitterClassifier(const ValueType* tree, size_t k, size_t log_k,
+                           const SampleIndexPair* sorted_splitters,
+                           const CompareFunction& compare_function)
+        : tree_(tree), k_(k), log_k_(log_k),
+          sorted_splitters_(sorted_splitters),
+          compare_function_(compare_function) { }
+
+    //! return bucket index in [0,k) of item
+    size_t Find(const ValueType& el) const {
+        size_t j = 1;
+        for (size_t l = 0; l < log_k_; l++)
+            j = 2 * j + (compare_function_(el, tree_[j]) ? 0 : 1);
+        return j - k_;
+    }
+
+    /*!
+     * Classify a block of n items into bucket[], and set equal[] if the item is
+     * equal to the splitter left of its bucket. The tree descents are
+     * interleaved level by level and contain no branches, hence the
+     * independent comparisons of the items can overlap in the pipeline.
+     */
+    void FindBlock(const ValueType* el, size_t n,
+                   size_t* bucket, unsigned char* equal) {
+        for (size_t i = 0; i < n; ++i)
+            bucket[i] = 1;
+        for (size_t l = 0; l < log_k_; l++) {
+            for (size_t i = 0; i < n; ++i) {
+                bucket[i] = 2 * bucket[i]
+                            + (compare_function_(el[i], tree_[bucket[i]]) ? 0 : 1);
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size_t b = bucket[i] - k_;
+            // items are not less than the splitter left of their bucket.
+            const ValueType& left = sorted_splitters_[b - (b != 0)].first;
+            equal[i] = (b != 0) & !compare_function_(left, el[i]);
+            bucket[i] = b;
+        }
+    }
+
+private:
+    const ValueType* tree_;
+    size_t k_, log_k_;
+    const SampleIndexPair* sorted_splitters_;
+    const CompareFunction& compare_function_;
+};
+
+/*!
+ * Classifier specialization for normalized keys: the keys of the splitters are
+ * extracted once, each item's key once, and the tree is descended using
+ * integer comparisons. Only key ties with a splitter call the comparator.
+ */
+template <typename ValueType, typename KeyExtractor, typename CompareFunction>
+class SortSplitterClassifier<
+        ValueType,
+        NormalizedKeyCompare<ValueType, KeyExtractor, CompareFunction> >
+{
+public:
+    using Compare = NormalizedKeyCompare<
+              ValueType, KeyExtractor, CompareFunction>;
+    using Key = typename Compare::Key;
+    using SampleIndexPair = std::pair<ValueType, size_t>;
+
+    SortSplitterClassifier(const ValueType* tree, size_t k, size_t log_k,
+                           const SampleIndexPair* sorted_splitters,
+                           const Compare& compare_function)
+        : tree_(tree), tree_key_(k), splitter_key_(k), k_(k), log_k_(log_k),
+          sorted_splitters_(sorted_splitters),
+          compare_function_(compare_function) {
+        for (size_t j = 1; j < k; ++j) {
+            tree_key_[j] = compare_function_.key(tree_[j]);
+            splitter_key_[j - 1] = compare_function_.key(sorted_splitters[j - 1].first);
+        }
+    }
+
+    //! return bucket index in [0,k) of item
+    size_t Find(const ValueType& el) const {
+        const Key key = compare_function_.key(el);
+        size_t j = 1;
+        for (size_t l = 0; l < log_k_; l++) {
+            const Key& tk = tree_key_[j];
+            size_t greater = (key < tk) ? 0 : 1;
+            if (TLX_UNLIKELY(key == tk))
+                greater = compare_function_.tie_less(el, tree_[j]) ? 0 : 1;
+            j = 2 * j + greater;
+        }
+        return j - k_;
+    }
+
+    /*!
+     * Classify a block of n items into bucket[], and set equal[] if the item is
+     * equal to the splitter left of its bucket. The keys of the block are
+     * extracted first and descended level by level using branchless integer
+     * comparisons. Items which hit a key tie on the way are reclassified using
+     * Find(), and only items whose key equals that of the splitter left of
+     * their bucket are compared with it.
+     */
+    void FindBlock(const ValueType* el, size_t n,
+                   size_t* bucket, unsigned char* equal) {
+        if (keys_.size() < n) {
+            keys_.resize(n);
+            ties_.resize(n);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            keys_[i] = compare_function_.key(el[i]);
+            ties_[i] = 0;
+            bucket[i] = 1;
+        }
+        for (size_t l = 0; l < log_k_; l++) {
+            for (size_t i = 0; i < n; ++i) {
+                const Key& tk = tree_key_[bucket[i]];
+                ties_[i] |= (keys_[i] == tk);
+                bucket[i] = 2 * bucket[i] + (keys_[i] < tk ? 0 : 1);
+            }
+        }
+        for (size_t i = 0; i < n; ++i) {
+            size_t b = TLX_UNLIKELY(ties_[i]) ? Find(el[i]) : bucket[i] - k_;
+            size_t left = b - (b != 0);
+            equal[i] = (b != 0) & (keys_[i] == splitter_key_[left]);
+            if (TLX_UNLIKELY(equal[i])) {
+                equal[i] = !compare_function_.tie_less(
+                    sorted_splitters_[left].first, el[i]);
+            }
+            bucket[i] = b;
+        }
+    }
+
+private:
+    const ValueType* tree_;
+    std::vector<Key> tree_key_;
+    //! keys of the sorted splitters
+    std::vector<Key> splitter_key_;
+    size_t k_, log_k_;
+    const SampleIndexPair* sorted_splitters_;
+    const Compare& compare_function_;
+    //! key and tie flag buffers for FindBlock()
+    std::vector<Key> keys_;
+    std::vector<unsigned char> ties_;
+};
+
 /*!
  * A DIANode which performs a Sort operation. Sort sorts a DIA according to a
  * given compare function
@@ -52,7 +369,8 @@ namespace api {
  *
  * \ingroup api_layer
  */
-template <typename ValueType, typename CompareFunction, typename SortAlgorithm>
+template <typename ValueType, typename CompareFunction, typename SortAlgorithm,
+          typename SortConfig = DefaultSortConfig>
 class SortNode final : public DOpNode<ValueType>
 {
     static constexpr bool debug = false;
@@ -70,7 +388,13 @@ class SortNode final : public DOpNode<ValueType>
 
     using SampleIndexPair = std::pair<ValueType, size_t>;
 
-    static const bool use_background_thread_ = false;
+    using RunFormat = SortRunFormat<ValueType, SortAlgorithm>;
+
+    template <typename Writer>
+    using RunWriter = typename RunFormat::template RunWriter<Writer>;
+
+    template <typename Reader>
+    using RunReader = typename RunFormat::template RunReader<Reader>;
 
 public:
     /*!
@@ -79,11 +403,14 @@ public:
     template <typename ParentDIA>
     SortNode(const ParentDIA& parent,
              const CompareFunction& compare_function,
-             const SortAlgorithm& sort_algorithm = SortAlgorithm())
+             const SortAlgorithm& sort_algorithm = SortAlgorithm(),
+             const SortConfig& config = SortConfig())
         : Super(parent.ctx(), "Sort", { parent.id() }, { parent.node() }),
           compare_function_(compare_function),
           sort_algorithm_(sort_algorithm),
-          parent_stack_empty_(ParentDIA::stack_empty)
+          config_(config),
+          parent_stack_empty_(ParentDIA::stack_empty),
+          presorted_(parent.properties().template IsSortedBy<CompareFunction>())
     {
         // Hook PreOp(s)
         auto pre_op_fn = [this](const ValueType& input) {
@@ -92,6 +419,10 @@ public:
 
         auto lop_chain = parent.stack().push(pre_op_fn).fold();
         parent.node()->AddChild(this, lop_chain);
+
+        DIAProperties properties;
+        properties.sorted_by = DIAProperties::Stateless<CompareFunction>();
+        this->set_properties(properties);
     }
 
     void StartPreOp(size_t /* id */) final {
@@ -101,7 +432,8 @@ public:
 
     void PreOp(const ValueType& input) {
         unsorted_writer_.Put(input);
-        res_sampler_.add(SampleIndexPair(input, local_items_));
+        if (!presorted_)
+            res_sampler_.add(SampleIndexPair(input, local_items_));
         local_items_++;
     }
 
@@ -118,7 +450,8 @@ public:
         unsorted_file_ = file.Copy();
         local_items_ = unsorted_file_.num_items();
 
-        size_t pick_items = std::min(local_items_, wanted_sample_size());
+        size_t pick_items =
+            presorted_ ? 0 : std::min(local_items_, wanted_sample_size());
 
         sLOG << "Pick" << pick_items << "samples by random access"
              << " from File containing " << local_items_ << " items.";
@@ -153,7 +486,10 @@ public:
 
     //! Executes the sum operation.
     void Execute() final {
-        MainOp();
+        if (presorted_)
+            KeepPresortedItems();
+        else
+            MainOp();
         if (stats_enabled) {
             context_.PrintCollectiveMeanStdev(
                 "Sort() timer_execute", timer_execute_.SecondsDouble());
@@ -199,7 +535,15 @@ public:
         }
         else if (files_.size() == 1) {
             local_size = files_[0].num_items();
-            this->PushFile(files_[0], consume);
+            if (RunFormat::plain) {
+                this->PushFile(files_[0], consume);
+            }
+            else {
+                RunReader<data::File::Reader> reader(
+                    files_[0].GetReader(consume));
+                while (reader.HasNext())
+                    this->PushItem(reader.template Next<ValueType>());
+            }
         }
         else {
             size_t merge_degree, prefetch;
@@ -213,7 +557,7 @@ public:
                       << merge_degree << "files with prefetch" << prefetch;
 
                 // create merger for first merge_degree_ Files
-                std::vector<data::File::ConsumeReader> seq;
+                std::vector<RunReader<data::File::ConsumeReader> > seq;
                 seq.reserve(merge_degree);
 
                 for (size_t t = 0; t < merge_degree; ++t)
@@ -221,12 +565,12 @@ public:
 
                 StartPrefetch(seq, prefetch);
 
-                auto puller = core::make_multiway_merge_tree<ValueType>(
+                auto puller = RunFormat::MakeMergeTree(
                     seq.begin(), seq.end(), compare_function_);
 
                 // create new File for merged items
                 files_.emplace_back(context_.GetFile(this));
-                auto writer = files_.back().GetWriter();
+                RunWriter<data::File::Writer> writer(files_.back().GetWriter());
 
                 while (puller.HasNext()) {
                     writer.Put(puller.Next());
@@ -246,7 +590,7 @@ public:
                   << "with prefetch" << prefetch;
 
             // construct output merger of remaining Files
-            std::vector<data::File::Reader> seq;
+            std::vector<RunReader<data::File::Reader> > seq;
             seq.reserve(files_.size());
 
             for (size_t t = 0; t < files_.size(); ++t)
@@ -254,7 +598,7 @@ public:
 
             StartPrefetch(seq, prefetch);
 
-            auto puller = core::make_multiway_merge_tree<ValueType>(
+            auto puller = RunFormat::MakeMergeTree(
                 seq.begin(), seq.end(), compare_function_);
 
             while (puller.HasNext()) {
@@ -284,9 +628,16 @@ private:
     //! Sort function class
     SortAlgorithm sort_algorithm_;
 
+    //! Sort configuration
+    SortConfig config_;
+
     //! Whether the parent stack is empty
     const bool parent_stack_empty_;
 
+    //! Whether the parent's items are already globally sorted by a comparator
+    //! of type CompareFunction
+    const bool presorted_;
+
     //! \name PreOp Phase
     //! \{
 
@@ -300,12 +651,17 @@ private:
     //! epsilon
     static constexpr double desired_imbalance_ = 0.1;
 
+    //! number of items classified together in TransmitItems()
+    static constexpr size_t classify_block_size_ = 32;
+
     //! Sample vector: pairs of (sample,local index)
     std::vector<SampleIndexPair> samples_;
     //! Reservoir sampler
     common::ReservoirSamplingGrow<SampleIndexPair> res_sampler_ {
         samples_, context_.rng_, desired_imbalance_
     };
+    //! number of local samples sent for splitter selection, on all levels
+    size_t sample_size_ = 0;
     //! calculate currently desired number of samples
     size_t wanted_sample_size() const {
         return res_sampler_.calc_sample_size(local_items_);
@@ -424,15 +780,48 @@ private:
             !compare_function_(b.first, a.first) && a.second < b.second);
     }
 
-    bool EqualSampleGreaterIndex(const SampleIndexPair& a, const SampleIndexPair& b) {
-        return !compare_function_(a.first, b.first) && a.second >= b.second;
-    }
+    /*!
+     * Explicit equality buckets of the splitters: items equal to a run of
+     * equal splitters are distributed over the run's buckets by their global
+     * index, such that equal keys are split as the sample determined. For each
+     * splitter, the first splitter of its run is precomputed, hence an item
+     * equal to a single splitter is placed with one index comparison, and
+     * only runs of equal splitters need a binary search.
+     */
+    class EqualSplitterBuckets
+    {
+    public:
+        EqualSplitterBuckets(const SampleIndexPair* sorted_splitters,
+                             size_t num_splitters,
+                             const CompareFunction& compare_function)
+            : sorted_splitters_(sorted_splitters),
+              run_begin_(num_splitters) {
+            for (size_t j = 0; j < num_splitters; ++j) {
+                run_begin_[j] =
+                    (j != 0 && !compare_function(sorted_splitters[j - 1].first,
+                                                 sorted_splitters[j].first))
+                    ? run_begin_[j - 1] : j;
+            }
+        }
 
-    //! round n down by k where k is a power of two.
-    template <typename Integral>
-    static inline size_t RoundDown(Integral n, Integral k) {
-        return (n & ~(k - 1));
-    }
+        //! Returns the bucket of an item with global index, which is in bucket
+        //! b > 0 and equal to the splitter b - 1.
+        size_t Find(size_t b, size_t index) const {
+            size_t s = b - 1, lo = run_begin_[s];
+            if (TLX_LIKELY(lo == s))
+                return b - (sorted_splitters_[s].second >= index);
+            return std::lower_bound(
+                sorted_splitters_ + lo, sorted_splitters_ + b, index,
+                [](const SampleIndexPair& a, const size_t& i) {
+                    return a.second < i;
+                }) - sorted_splitters_;
+        }
+
+    private:
+        const SampleIndexPair* sorted_splitters_;
+        //! first splitter of the run of equal splitters of each splitter
+        std::vector<size_t> run_begin_;
+    };
 
     void TransmitItems(
         // Tree of splitters, sizeof |splitter|
@@ -463,78 +852,76 @@ private:
 
         std::swap(data_writers[actual_k - 1], data_writers[k - 1]);
 
-        // classify all items (take two at once) and immediately transmit them.
+        SortSplitterClassifier<ValueType, CompareFunction> classifier(
+            tree, k, log_k, sorted_splitters, compare_function_);
 
-        const size_t stepsize = 2;
+        EqualSplitterBuckets equal_buckets(
+            sorted_splitters, k - 1, compare_function_);
 
-        size_t i = prefix_items;
-        for ( ; i < prefix_items + RoundDown(local_items_, stepsize); i += stepsize)
-        {
-            // take two items
-            size_t j0 = 1;
-            ValueType el0 = unsorted_reader.Next<ValueType>();
+        // classify items in blocks: read a block into reused slots, run all of
+        // its items down the tree together, then move items equal to a
+        // splitter to their equality bucket and transmit them. The writers
+        // buffer items per destination.
 
-            size_t j1 = 1;
-            ValueType el1 = unsorted_reader.Next<ValueType>();
+        const size_t block_size = classify_block_size_;
+        std::vector<ValueType> block;
+        block.reserve(block_size);
+        size_t bucket[classify_block_size_];
+        unsigned char equal[classify_block_size_];
 
-            // run items down the tree
-            for (size_t l = 0; l < log_k; l++)
-            {
-                j0 = 2 * j0 + (compare_function_(el0, tree[j0]) ? 0 : 1);
-                j1 = 2 * j1 + (compare_function_(el1, tree[j1]) ? 0 : 1);
+        const size_t end = prefix_items + local_items_;
+        for (size_t i = prefix_items; i < end; i += block_size)
+        {
+            size_t n = std::min(block_size, end - i);
+            for (size_t j = 0; j < n; ++j) {
+                if (j < block.size())
+                    block[j] = unsorted_reader.Next<ValueType>();
+                else
+                    block.emplace_back(unsorted_reader.Next<ValueType>());
             }
 
-            size_t b0 = j0 - k;
-            size_t b1 = j1 - k;
+            classifier.FindBlock(block.data(), n, bucket, equal);
 
-            while (b0 && EqualSampleGreaterIndex(
-                       sorted_splitters[b0 - 1], SampleIndexPair(el0, i + 0))) {
-                b0--;
+            for (size_t j = 0; j < n; ++j) {
+                size_t b = bucket[j];
+                if (equal[j])
+                    b = equal_buckets.Find(b, i + j);
 
-                // LOG0 << "el0 equal match b0 " << b0
-                //      << " prefix_items " << prefix_items
-                //      << " lhs.first = " << sorted_splitters[b0 - 1].first
-                //      << " lhs.second = " << sorted_splitters[b0 - 1].second
-                //      << " rhs.first = " << el0
-                //      << " rhs.second = " << i;
+                assert(data_writers[b].IsValid());
+                data_writers[b].Put(block[j]);
             }
-
-            while (b1 && EqualSampleGreaterIndex(
-                       sorted_splitters[b1 - 1], SampleIndexPair(el1, i + 1))) {
-                b1--;
-            }
-
-            assert(data_writers[b0].IsValid());
-            assert(data_writers[b1].IsValid());
-
-            data_writers[b0].Put(el0);
-            data_writers[b1].Put(el1);
         }
 
-        // last iteration of loop if we have an odd number of items.
-        for ( ; i < prefix_items + local_items_; i++)
-        {
-            size_t j0 = 1;
-            ValueType el0 = unsorted_reader.Next<ValueType>();
-
-            // run item down the tree
-            for (size_t l = 0; l < log_k; l++)
-            {
-                j0 = 2 * j0 + (compare_function_(el0, tree[j0]) ? 0 : 1);
-            }
+        // implicitly close writers and flush data
+    }
 
-            size_t b0 = j0 - k;
+    //! Output the already globally sorted local items without exchange.
+    void KeepPresortedItems() {
+        RunTimer timer(timer_execute_);
 
-            while (b0 && EqualSampleGreaterIndex(
-                       sorted_splitters[b0 - 1], SampleIndexPair(el0, i))) {
-                b0--;
-            }
+        sLOG << "worker" << context_.my_rank()
+             << "keeps" << local_items_ << "presorted items";
 
-            assert(data_writers[b0].IsValid());
-            data_writers[b0].Put(el0);
+        local_out_size_ = local_items_;
+        if (local_items_ == 0) {
+            unsorted_file_.Clear();
+        }
+        else if (RunFormat::plain) {
+            files_.emplace_back(std::move(unsorted_file_));
+        }
+        else {
+            files_.emplace_back(context_.GetFile(this));
+            RunWriter<data::File::Writer> writer(files_.back().GetWriter());
+            auto reader = unsorted_file_.GetConsumeReader();
+            while (reader.HasNext())
+                writer.Put(reader.template Next<ValueType>());
+            writer.Close();
         }
 
-        // implicitly close writers and flush data
+        Super::logger_
+            << "class" << "SortNode"
+            << "event" << "presorted"
+            << "local_out_size" << local_out_size_;
     }
 
     void MainOp() {
@@ -558,10 +945,44 @@ private:
                 << "workers" << num_total_workers
                 << "local_out_size" << local_out_size_
                 << "balance" << 0
-                << "sample_size" << samples_.size();
+                << "sample_size" << sample_size_;
             return;
         }
 
+        if (num_total_workers > 2 &&
+            num_total_workers >= config_.multi_level_min_workers_ &&
+            config_.multi_level_fanout_ >= 2) {
+            MultiLevelExchange();
+        }
+        else {
+            SingleLevelExchange(prefix_items);
+        }
+
+        double balance = 0;
+        if (local_out_size_ > 0) {
+            balance = static_cast<double>(local_out_size_)
+                      * static_cast<double>(num_total_workers)
+                      / static_cast<double>(total_items);
+        }
+
+        if (balance > 1) {
+            balance = 1 / balance;
+        }
+
+        Super::logger_
+            << "class" << "SortNode"
+            << "event" << "done"
+            << "workers" << num_total_workers
+            << "local_out_size" << local_out_size_
+            << "balance" << balance
+            << "sample_size" << sample_size_;
+    }
+
+    //! Send all samples to worker 0, which selects and broadcasts p-1
+    //! splitters, then classify and transmit all items in one step.
+    void SingleLevelExchange(size_t prefix_items) {
+        size_t num_total_workers = context_.num_workers();
+
         // stream to send samples to process 0 and receive them back
         data::MixStreamPtr sample_stream = context_.GetNewMixStream(this);
 
@@ -574,6 +995,7 @@ private:
                 SampleIndexPair(sample.first, prefix_items + sample.second));
         }
         sample_writers[0].Close();
+        sample_size_ += samples_.size();
         std::vector<SampleIndexPair>().swap(samples_);
 
         // Get the ceiling of log(num_total_workers), as SSSS needs 2^n buckets.
@@ -585,7 +1007,7 @@ private:
         splitters.reserve(workers_algo);
 
         if (context_.my_rank() == 0) {
-            FindAndSendSplitters(splitters, samples_.size(),
+            FindAndSendSplitters(splitters, sample_size_,
                                  sample_stream, sample_writers);
         }
         else {
@@ -618,7 +1040,7 @@ private:
         data::MixStreamPtr data_stream = context_.GetNewMixStream(this);
 
         std::thread thread;
-        if (use_background_thread_) {
+        if (config_.use_background_thread_) {
             // launch receiver thread.
             thread = common::CreateThread(
                 [this, &data_stream]() {
@@ -638,60 +1060,389 @@ private:
 
         std::vector<ValueType>().swap(splitter_tree);
 
-        if (use_background_thread_)
+        if (config_.use_background_thread_)
             thread.join();
         else
             ReceiveItems(data_stream);
 
         data_stream.reset();
+    }
 
-        double balance = 0;
-        if (local_out_size_ > 0) {
-            balance = static_cast<double>(local_out_size_)
-                      * static_cast<double>(num_total_workers)
-                      / static_cast<double>(total_items);
+    //! \name Multi-Level Sample Sort
+    //! \{
+
+    //! Returns the range of the subgroup j when splitting the worker range
+    //! [begin,end) into fanout nearly equal parts.
+    static std::pair<size_t, size_t> SubGroupRange(
+        size_t begin, size_t end, size_t fanout, size_t j) {
+        size_t size = end - begin;
+        return std::make_pair(begin + j * size / fanout,
+                              begin + (j + 1) * size / fanout);
+    }
+
+    /*!
+     * Multi-level (AMS-style) sample sort: the workers are recursively
+     * partitioned into groups. In each level, the samples of a group are sent
+     * to the first worker of the group, which selects fanout-1 splitters and
+     * sends them back only to its group members. The items are then
+     * redistributed among the subgroups. After ceil(log_r(p)) levels each
+     * group consists of a single worker, which forms the sorted runs.
+     */
+    void MultiLevelExchange() {
+        size_t num_total_workers = context_.num_workers();
+        size_t my_rank = context_.my_rank();
+
+        // calculate number of levels: ceil(log_r(p))
+        size_t num_levels = 0;
+        for (size_t x = 1; x < num_total_workers;
+             x *= config_.multi_level_fanout_) ++num_levels;
+
+        // current worker group [group_begin, group_end)
+        size_t group_begin = 0, group_end = num_total_workers;
+
+        for (size_t level = 0; level < num_levels; ++level)
+        {
+            size_t group_size = group_end - group_begin;
+            size_t remaining_levels = num_levels - level;
+
+            // select fanout such that the remaining levels divide the group
+            // into equally sized parts, the last level splits it completely.
+            size_t fanout = group_size;
+            if (remaining_levels > 1) {
+                double root = std::pow(
+                    static_cast<double>(group_size),
+                    1.0 / static_cast<double>(remaining_levels));
+                fanout = static_cast<size_t>(std::ceil(root));
+                fanout = std::max<size_t>(
+                    1, std::min(fanout, config_.multi_level_fanout_));
+                fanout = std::min(fanout, group_size);
+            }
+
+            // global ranks of items on this level, used to break ties
+            size_t prefix_items = context_.net.ExPrefixSum(local_items_);
+
+            std::vector<SampleIndexPair> splitters =
+                MultiLevelSplitters(level, group_begin, group_end, fanout,
+                                    prefix_items);
+
+            sLOG << "MultiLevelExchange() level" << level
+                 << "group" << group_begin << group_end
+                 << "fanout" << fanout << "splitters" << splitters.size();
+
+            data::MixStreamPtr data_stream = context_.GetNewMixStream(this);
+
+            MultiLevelTransmitItems(
+                splitters, group_begin, group_end, fanout, prefix_items,
+                data_stream);
+
+            if (level + 1 == num_levels) {
+                ReceiveItems(data_stream);
+            }
+            else {
+                // collect received items as the unsorted input of next level
+                unsorted_file_ = context_.GetFile(this);
+                local_items_ = 0;
+
+                auto writer = unsorted_file_.GetWriter();
+                auto reader = data_stream->GetMixReader(/* consume */ true);
+                while (reader.HasNext()) {
+                    writer.Put(reader.template Next<ValueType>());
+                    ++local_items_;
+                }
+                writer.Close();
+            }
+            data_stream.reset();
+
+            // descend into subgroup containing this worker
+            for (size_t j = 0; j < fanout; ++j) {
+                std::pair<size_t, size_t> sub =
+                    SubGroupRange(group_begin, group_end, fanout, j);
+                if (sub.first <= my_rank && my_rank < sub.second) {
+                    group_begin = sub.first, group_end = sub.second;
+                    break;
+                }
+            }
         }
+    }
 
-        if (balance > 1) {
-            balance = 1 / balance;
+    //! Select fanout-1 splitters within a worker group: all group members send
+    //! their samples to the group's first worker, which sorts them and sends
+    //! the splitters back to the group members.
+    std::vector<SampleIndexPair> MultiLevelSplitters(
+        size_t level, size_t group_begin, size_t group_end, size_t fanout,
+        size_t prefix_items) {
+
+        size_t num_total_workers = context_.num_workers();
+        size_t my_rank = context_.my_rank();
+
+        // draw samples: on the first level use the reservoir, afterwards pick
+        // samples by random access from the redistributed items.
+        std::vector<SampleIndexPair> samples;
+        if (level == 0) {
+            samples.swap(samples_);
+        }
+        else if (fanout > 1) {
+            size_t pick_items = std::min(
+                local_items_, res_sampler_.calc_sample_size(local_items_));
+            samples.reserve(pick_items);
+            for (size_t i = 0; i < pick_items; ++i) {
+                size_t index = context_.rng_() % local_items_;
+                samples.emplace_back(
+                    unsorted_file_.GetItemAt<ValueType>(index), index);
+            }
         }
 
-        Super::logger_
-            << "class" << "SortNode"
-            << "event" << "done"
-            << "workers" << num_total_workers
-            << "local_out_size" << local_out_size_
-            << "balance" << balance
-            << "sample_size" << samples_.size();
+        data::MixStreamPtr sample_stream = context_.GetNewMixStream(this);
+        data::MixStream::Writers sample_writers = sample_stream->GetWriters();
+
+        std::vector<SampleIndexPair> splitters;
+
+        if (fanout > 1) {
+            // send samples to group leader, adding the prefix to the indexes
+            for (const SampleIndexPair& sample : samples) {
+                sample_writers[group_begin].Put(
+                    SampleIndexPair(sample.first,
+                                    prefix_items + sample.second));
+            }
+            sample_size_ += samples.size();
+        }
+        sample_writers[group_begin].Close();
+        std::vector<SampleIndexPair>().swap(samples);
+
+        if (my_rank == group_begin) {
+            // close all writers, except those to our group members
+            for (size_t j = 0; j < num_total_workers; ++j) {
+                if (j != group_begin && (j < group_begin || j >= group_end))
+                    sample_writers[j].Close();
+            }
+
+            auto reader = sample_stream->GetMixReader(/* consume */ true);
+            while (reader.HasNext())
+                samples.push_back(reader.template Next<SampleIndexPair>());
+
+            std::sort(samples.begin(), samples.end(),
+                      [this](const SampleIndexPair& a,
+                             const SampleIndexPair& b) {
+                          return LessSampleIndex(a, b);
+                      });
+
+            if (samples.size()) {
+                double splitting_size = static_cast<double>(samples.size())
+                                        / static_cast<double>(fanout);
+                for (size_t i = 1; i < fanout; ++i) {
+                    splitters.push_back(
+                        samples[static_cast<size_t>(i * splitting_size)]);
+                }
+            }
+
+            for (size_t j = group_begin + 1; j < group_end; ++j) {
+                for (const SampleIndexPair& s : splitters)
+                    sample_writers[j].Put(s);
+                sample_writers[j].Close();
+            }
+        }
+        else {
+            // close unused writers
+            for (size_t j = 0; j < num_total_workers; ++j) {
+                if (j != group_begin) sample_writers[j].Close();
+            }
+
+            auto reader = sample_stream->GetMixReader(/* consume */ true);
+            while (reader.HasNext())
+                splitters.push_back(reader.template Next<SampleIndexPair>());
+        }
+
+        return splitters;
+    }
+
+    //! Classify items using the group's splitters and send the items of
+    //! subgroup j to one of the workers of subgroup j.
+    void MultiLevelTransmitItems(
+        const std::vector<SampleIndexPair>& splitters,
+        size_t group_begin, size_t group_end, size_t fanout,
+        size_t prefix_items, data::MixStreamPtr& data_stream) {
+
+        size_t my_rank = context_.my_rank();
+
+        data::File::ConsumeReader unsorted_reader =
+            unsorted_file_.GetConsumeReader();
+
+        data::MixStream::Writers data_writers = data_stream->GetWriters();
+
+        // pick target worker of each subgroup, spread by our group position
+        std::vector<size_t> targets(fanout);
+        for (size_t j = 0; j < fanout; ++j) {
+            std::pair<size_t, size_t> sub =
+                SubGroupRange(group_begin, group_end, fanout, j);
+            targets[j] = sub.first
+                         + (my_rank - group_begin) % (sub.second - sub.first);
+        }
+
+        for (size_t i = 0; i < local_items_; ++i) {
+            SampleIndexPair el(
+                unsorted_reader.Next<ValueType>(), prefix_items + i);
+
+            size_t b = std::upper_bound(
+                splitters.begin(), splitters.end(), el,
+                [this](const SampleIndexPair& x, const SampleIndexPair& y) {
+                    return LessSampleIndex(x, y);
+                }) - splitters.begin();
+
+            data_writers[targets[b]].Put(el.first);
+        }
+
+        // implicitly close writers and flush data
     }
 
+    //! \}
+
     void ReceiveItems(data::MixStreamPtr& data_stream) {
 
         auto reader = data_stream->GetMixReader(/* consume */ true);
 
         LOG0 << "Writing files";
 
-        // M/2 such that the other half is used to prepare the next bulk
-        size_t capacity = DIABase::mem_limit_ / sizeof(ValueType) / 2;
-        std::vector<ValueType> vec;
-        vec.reserve(capacity);
+        if (config_.replacement_selection_ && RunFormat::plain) {
+            ReceiveItemsReplacementSelection(reader);
+        }
+        else if (config_.pipelined_run_formation_) {
+            ReceiveItemsPipelined(reader);
+        }
+        else {
+            // M/2 such that the other half is used to prepare the next bulk
+            size_t capacity = DIABase::mem_limit_ / sizeof(ValueType) / 2;
+            std::vector<ValueType> vec;
+            vec.reserve(capacity);
 
-        while (reader.HasNext()) {
-            if (!mem::memory_exceeded && vec.size() < capacity) {
-                vec.push_back(reader.template Next<ValueType>());
+            while (reader.HasNext()) {
+                if (!mem::memory_exceeded && vec.size() < capacity) {
+                    vec.push_back(reader.template Next<ValueType>());
+                }
+                else {
+                    SortAndWriteToFile(vec);
+                }
             }
-            else {
+
+            if (vec.size())
                 SortAndWriteToFile(vec);
+        }
+
+        if (stats_enabled) {
+            context_.PrintCollectiveMeanStdev(
+                "Sort() timer_sort_", timer_sort_.SecondsDouble());
+        }
+    }
+
+    /*!
+     * Receive items into one buffer while a helper thread sorts and writes the
+     * previous run. Full buffers are handed to the helper at a run size between
+     * M/2 and 7M/8: if the helper is still busy when the next run is complete,
+     * items arrive faster than runs are formed and the run size shrinks,
+     * otherwise it grows. The receive buffer is reserved to at most the memory
+     * not held by the helper, hence it never reallocates.
+     */
+    template <typename Reader>
+    void ReceiveItemsPipelined(Reader& reader) {
+        const size_t capacity = DIABase::mem_limit_ / sizeof(ValueType);
+        // run size in eighths of capacity
+        size_t run_eighths = 4;
+        // number of items at which the receive buffer is handed off
+        size_t run_size = std::max<size_t>(capacity / 2, 1);
+
+        std::vector<ValueType> vec, sort_vec;
+        vec.reserve(run_size);
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        // whether sort_vec holds a run for the helper, and whether the helper
+        // should terminate.
+        bool has_run = false, done = false;
+        bool waited = false;
+
+        // one helper thread sorts and writes all runs
+        std::thread helper = common::CreateThread(
+            [&]() {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true) {
+                    cv.wait(lock, [&]() { return has_run || done; });
+                    if (!has_run) break;
+                    lock.unlock();
+                    SortAndWriteToFile(sort_vec);
+                    std::vector<ValueType>().swap(sort_vec);
+                    lock.lock();
+                    has_run = false;
+                    cv.notify_all();
+                }
+            });
+
+        auto wait_helper = [&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            waited = waited || has_run;
+            cv.wait(lock, [&]() { return !has_run; });
+        };
+
+        auto hand_off = [&]() {
+            wait_helper();
+            run_eighths = waited ? std::max<size_t>(run_eighths - 1, 4)
+                          : std::min<size_t>(run_eighths + 1, 7);
+            waited = false;
+
+            std::swap(vec, sort_vec);
+            size_t helper_items = sort_vec.size();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_run = true;
+            }
+            cv.notify_all();
+
+            // the next run must fit beside the helper's run
+            run_size = std::max<size_t>(
+                std::min(capacity * run_eighths / 8,
+                         capacity - std::min(capacity, helper_items)), 1);
+            std::vector<ValueType>().swap(vec);
+            vec.reserve(run_size);
+        };
+
+        while (reader.HasNext()) {
+            if (!vec.empty() &&
+                (vec.size() >= run_size || mem::memory_exceeded)) {
+                hand_off();
+                continue;
             }
+            vec.push_back(reader.template Next<ValueType>());
+        }
+
+        wait_helper();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done = true;
         }
+        cv.notify_all();
+        helper.join();
 
         if (vec.size())
             SortAndWriteToFile(vec);
+    }
 
-        if (stats_enabled) {
-            context_.PrintCollectiveMeanStdev(
-                "Sort() timer_sort_", timer_sort_.SecondsDouble());
+    //! Receive items and form runs with core::RunGenerator. Input which fits
+    //! into memory is sorted with the SortAlgorithm.
+    template <typename Reader>
+    void ReceiveItemsReplacementSelection(Reader& reader) {
+        core::RunGenerator<ValueType, CompareFunction> run_generator(
+            context_.block_pool(), context_.local_worker_id(), this->id(),
+            files_, DIABase::mem_limit_ / sizeof(ValueType),
+            compare_function_);
+
+        while (reader.HasNext()) {
+            run_generator.UpdateMemoryPressure(mem::memory_exceeded);
+            run_generator.Insert(reader.template Next<ValueType>());
         }
+
+        timer_sort_.Start();
+        run_generator.Finish(sort_algorithm_);
+        timer_sort_.Stop();
+
+        local_out_size_ += run_generator.total_items();
     }
 
     void SortAndWriteToFile(std::vector<ValueType>& vec) {
@@ -717,7 +1468,7 @@ private:
         write_time.Start();
 
         files_.emplace_back(context_.GetFile(this));
-        auto writer = files_.back().GetWriter();
+        RunWriter<data::File::Writer> writer(files_.back().GetWriter());
         for (const ValueType& elem : vec) {
             writer.Put(elem);
         }
@@ -814,6 +1565,83 @@ auto DIA<ValueType, Stack>::Sort(const CompareFunction& compare_function,
     return DIA<ValueType>(node);
 }
 
+template <typename ValueType, typename Stack>
+template <typename CompareFunction, typename SortAlgorithm, typename SortConfig>
+auto DIA<ValueType, Stack>::Sort(const CompareFunction& compare_function,
+                                 const SortAlgorithm& sort_algorithm,
+                                 const SortConfig& sort_config) const {
+    assert(IsValid());
+
+    using SortNode = api::SortNode<
+              ValueType, CompareFunction, SortAlgorithm, SortConfig>;
+
+    static_assert(
+        std::is_convertible<
+            ValueType,
+            typename FunctionTraits<CompareFunction>::template arg<0> >::value,
+        "CompareFunction has the wrong input type");
+
+    static_assert(
+        std::is_convertible<
+            ValueType,
+            typename FunctionTraits<CompareFunction>::template arg<1> >::value,
+        "CompareFunction has the wrong input type");
+
+    static_assert(
+        std::is_convertible<
+            typename FunctionTraits<CompareFunction>::result_type,
+            bool>::value,
+        "CompareFunction has the wrong output type (should be bool)");
+
+    auto node = tlx::make_counting<SortNode>(
+        *this, compare_function, sort_algorithm, sort_config);
+
+    return DIA<ValueType>(node);
+}
+
+template <typename ValueType, typename Stack>
+template <typename KeyExtractor, typename CompareFunction>
+auto DIA<ValueType, Stack>::Sort(struct NormalizedKeyTag const&,
+                                 const KeyExtractor& key_extractor,
+                                 const CompareFunction& compare_function) const {
+    assert(IsValid());
+
+    using Compare = api::NormalizedKeyCompare<
+              ValueType, KeyExtractor, CompareFunction>;
+
+    using SortNode = api::SortNode<
+              ValueType, Compare, NormalizedKeySortAlgorithm>;
+
+    static_assert(
+        std::is_convertible<
+            ValueType,
+            typename FunctionTraits<KeyExtractor>::template arg<0> >::value,
+        "KeyExtractor has the wrong input type");
+
+    static_assert(
+        std::is_convertible<
+            ValueType,
+            typename FunctionTraits<CompareFunction>::template arg<0> >::value,
+        "CompareFunction has the wrong input type");
+
+    static_assert(
+        std::is_convertible<
+            ValueType,
+            typename FunctionTraits<CompareFunction>::template arg<1> >::value,
+        "CompareFunction has the wrong input type");
+
+    static_assert(
+        std::is_convertible<
+            typename FunctionTraits<CompareFunction>::result_type,
+            bool>::value,
+        "CompareFunction has the wrong output type (should be bool)");
+
+    auto node = tlx::make_counting<SortNode>(
+        *this, Compare(key_extractor, compare_function));
+
+    return DIA<ValueType>(node);
+}
+
 } // namespace api
 } // namespace thrill
 
@@ -0,0 +1,167 @@
+/*******************************************************************************
+ * thrill/api/top_k.hpp
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_API_TOP_K_HEADER
+#define THRILL_API_TOP_K_HEADER
+
+#include <thrill/api/action_node.hpp>
+#include <thrill/api/dia.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace thrill {
+namespace api {
+
+/*!
+ * \ingroup api_layer
+ *
+ * ActionNode which selects the k smallest items of a DIA. Each worker keeps a
+ * bounded max-heap of its k smallest items. Every worker holding k items knows
+ * a bound on the global k-th item: the minimum of these local k-th items is
+ * exchanged and all larger local items are pruned. The survivors are then
+ * merged in an AllReduce, which keeps only the k smallest at each step.
+ */
+template <typename ValueType, typename CompareFunction>
+class TopKNode final : public ActionResultNode<std::vector<ValueType> >
+{
+    static constexpr bool debug = false;
+
+    using Super = ActionResultNode<std::vector<ValueType> >;
+    using Super::context_;
+
+public:
+    template <typename ParentDIA>
+    TopKNode(const ParentDIA& parent, const char* label, size_t k,
+             const CompareFunction& compare_function)
+        : Super(parent.ctx(), label, { parent.id() }, { parent.node() }),
+          k_(k), compare_function_(compare_function)
+    {
+        // Hook PreOp(s)
+        auto pre_op_fn = [this](const ValueType& input) {
+                             PreOp(input);
+                         };
+
+        auto lop_chain = parent.stack().push(pre_op_fn).fold();
+        parent.node()->AddChild(this, lop_chain);
+    }
+
+    void PreOp(const ValueType& input) {
+        if (heap_.size() < k_) {
+            heap_.push_back(input);
+            std::push_heap(heap_.begin(), heap_.end(), compare_function_);
+        }
+        else if (k_ != 0 && compare_function_(input, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), compare_function_);
+            heap_.back() = input;
+            std::push_heap(heap_.begin(), heap_.end(), compare_function_);
+        }
+    }
+
+    //! Executes the top-k selection.
+    void Execute() final {
+        std::sort_heap(heap_.begin(), heap_.end(), compare_function_);
+
+        // exchange the smallest local k-th item as global threshold. The
+        // threshold is a vector of zero or one items, such that ValueType need
+        // not be default constructible.
+        using Threshold = std::vector<ValueType>;
+
+        Threshold local_threshold;
+        if (k_ != 0 && heap_.size() == k_)
+            local_threshold.push_back(heap_.back());
+
+        Threshold threshold = context_.net.AllReduce(
+            local_threshold,
+            [this](const Threshold& a, const Threshold& b) {
+                if (a.empty()) return b;
+                if (b.empty()) return a;
+                return compare_function_(b.front(), a.front()) ? b : a;
+            });
+
+        // prune all items larger than the threshold.
+        if (!threshold.empty()) {
+            heap_.erase(
+                std::upper_bound(heap_.begin(), heap_.end(), threshold.front(),
+                                 compare_function_),
+                heap_.end());
+        }
+
+        sLOG << "TopK() worker" << context_.my_rank()
+             << "survivors" << heap_.size() << "of k" << k_;
+
+        // merge sorted survivors, keeping only the k smallest.
+        result_ = context_.net.AllReduce(
+            heap_,
+            [this](const std::vector<ValueType>& a,
+                   const std::vector<ValueType>& b) {
+                std::vector<ValueType> out;
+                out.reserve(std::min(a.size() + b.size(), k_));
+                auto ia = a.begin(), ib = b.begin();
+                while (out.size() < k_ && (ia != a.end() || ib != b.end())) {
+                    if (ib == b.end() ||
+                        (ia != a.end() && !compare_function_(*ib, *ia)))
+                        out.push_back(*ia++);
+                    else
+                        out.push_back(*ib++);
+                }
+                return out;
+            });
+
+        std::vector<ValueType>().swap(heap_);
+    }
+
+    //! Returns the k smallest items in sorted order.
+    const std::vector<ValueType>& result() const final {
+        return result_;
+    }
+
+private:
+    //! number of items to select
+    size_t k_;
+    //! item comparator
+    CompareFunction compare_function_;
+    //! max-heap of the k smallest local items
+    std::vector<ValueType> heap_;
+    //! global result
+    std::vector<ValueType> result_;
+};
+
+template <typename ValueType, typename Stack>
+template <typename CompareFunction>
+std::vector<ValueType> DIA<ValueType, Stack>::TopK(
+    size_t k, const CompareFunction& compare_function) const {
+    assert(IsValid());
+
+    using TopKNode = api::TopKNode<ValueType, CompareFunction>;
+    auto node = tlx::make_counting<TopKNode>(
+        *this, "TopK", k, compare_function);
+    node->RunScope();
+    return node->result();
+}
+
+template <typename ValueType, typename Stack>
+template <typename CompareFunction>
+Future<std::vector<ValueType> > DIA<ValueType, Stack>::TopKFuture(
+    size_t k, const CompareFunction& compare_function) const {
+    assert(IsValid());
+
+    using TopKNode = api::TopKNode<ValueType, CompareFunction>;
+    auto node = tlx::make_counting<TopKNode>(
+        *this, "TopK", k, compare_function);
+    return Future<std::vector<ValueType> >(node);
+}
+
+} // namespace api
+} // namespace thrill
+
+#endif // !THRILL_API_TOP_K_HEADER
+
+/******************************************************************************/
@@ -54,6 +54,19 @@ template <typename T>
 using is_trivially_copyable = std::is_trivially_copyable<T>;
 #endif
 
+/******************************************************************************/
+// software prefetching
+
+//! hint the processor to load the cache line containing addr, e.g. a hash
+//! table slot which is accessed shortly.
+static inline void prefetch(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(addr);
+#else
+    (void)addr;
+#endif
+}
+
 } // namespace common
 } // namespace thrill
 
@@ -138,6 +138,102 @@ void radix_sort_CI(Iterator begin, Iterator end, size_t K,
     delete[] char_cache;
 }
 
+/*!
+ * Internal helper method, use radix_sort_key_CI below.
+ */
+template <typename Iterator, typename Key, typename Comparator>
+static inline
+void radix_sort_key_CI(Iterator begin, Iterator end,
+                       const Comparator& cmp, size_t depth, Key* key_cache) {
+
+    static_assert(std::is_unsigned<Key>::value,
+                  "Normalized keys must be unsigned integers");
+
+    const size_t size = end - begin;
+    if (size < 32)
+        return std::sort(begin, end, cmp);
+
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+    // shift for extracting the 8-bit digit at depth, starting with the MSB
+    const size_t shift = 8 * (sizeof(Key) - 1 - depth);
+
+    // count digit occurrences
+    size_t bkt_size[256];
+    std::fill(bkt_size, bkt_size + 256, 0);
+    for (const Key* kc = key_cache; kc != key_cache + size; ++kc)
+        ++bkt_size[(*kc >> shift) & 0xFF];
+
+    // inclusive prefix sum
+    size_t bkt_index[256];
+    bkt_index[0] = bkt_size[0];
+    size_t last_bkt_size = bkt_size[0];
+    for (size_t i = 1; i < 256; ++i) {
+        bkt_index[i] = bkt_index[i - 1] + bkt_size[i];
+        if (bkt_size[i]) last_bkt_size = bkt_size[i];
+    }
+
+    // permute items and cached keys in-place
+    for (size_t i = 0, j; i < size - last_bkt_size; )
+    {
+        value_type v = std::move(begin[i]);
+        Key vk = key_cache[i];
+        while ((j = --bkt_index[(vk >> shift) & 0xFF]) > i)
+        {
+            using std::swap;
+            swap(v, begin[j]);
+            swap(vk, key_cache[j]);
+        }
+        begin[i] = std::move(v);
+        key_cache[i] = vk;
+        i += bkt_size[(vk >> shift) & 0xFF];
+    }
+
+    size_t bsum = 0;
+    for (size_t i = 0; i < 256; bsum += bkt_size[i++]) {
+        if (bkt_size[i] <= 1) continue;
+        if (depth + 1 == sizeof(Key)) {
+            // all key digits are equal: fall back to the comparator
+            std::sort(begin + bsum, begin + bsum + bkt_size[i], cmp);
+        }
+        else {
+            radix_sort_key_CI(begin + bsum, begin + bsum + bkt_size[i],
+                              cmp, depth + 1, key_cache + bsum);
+        }
+    }
+}
+
+/*!
+ * MSD radix sort the iterator range [begin,end) by the unsigned integer keys
+ * delivered by key_extractor, which must be a normalized prefix of the order
+ * defined by cmp: key(a) < key(b) implies cmp(a,b). Items with equal keys and
+ * small buckets are sorted using std::sort() with the comparator. The keys are
+ * cached, which requires sizeof(Key) * n extra bytes of memory.
+ */
+template <typename Iterator, typename KeyExtractor, typename Comparator>
+static inline
+void radix_sort_key_CI(Iterator begin, Iterator end,
+                       const KeyExtractor& key_extractor,
+                       const Comparator& cmp) {
+
+    const size_t size = end - begin;
+    if (size < 32)
+        return std::sort(begin, end, cmp);
+
+    using KeyRet = decltype(key_extractor(*begin));
+    using Key = typename std::remove_cv<
+              typename std::remove_reference<KeyRet>::type>::type;
+
+    // allocate and fill key cache once
+    Key* key_cache = new Key[size];
+    Key* kc = key_cache;
+    for (Iterator it = begin; it != end; ++it, ++kc)
+        *kc = key_extractor(*it);
+
+    radix_sort_key_CI(begin, end, cmp, /* depth */ 0, key_cache);
+    delete[] key_cache;
+}
+
 /*!
  * SortAlgorithm class for use with api::Sort() which calls radix_sort_CI() if K
  * is small enough.
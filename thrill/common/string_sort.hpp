@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * thrill/common/string_sort.hpp
+ *
+ * Multikey quicksort for ranges of std::string, which compares only characters
+ * beyond the common prefix of the current subproblem.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_COMMON_STRING_SORT_HEADER
+#define THRILL_COMMON_STRING_SORT_HEADER
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace thrill {
+namespace common {
+
+//! return character at depth of s as int, or -1 if s ends before depth.
+static inline int string_char_at(const std::string& s, size_t depth) {
+    return depth < s.size() ? static_cast<unsigned char>(s[depth]) : -1;
+}
+
+/*!
+ * Insertion sort of strings which all share a common prefix of length depth.
+ */
+template <typename Iterator>
+static inline
+void string_insertion_sort(Iterator begin, Iterator end, size_t depth) {
+    for (Iterator i = begin + 1; i < end; ++i) {
+        std::string tmp = std::move(*i);
+        Iterator j = i;
+        for ( ; j != begin; --j) {
+            const std::string& prev = *(j - 1);
+            // compare prev and tmp beyond the common prefix
+            size_t d = depth;
+            while (d < prev.size() && d < tmp.size() && prev[d] == tmp[d]) ++d;
+            if (string_char_at(prev, d) <= string_char_at(tmp, d)) break;
+            *j = std::move(*(j - 1));
+        }
+        *j = std::move(tmp);
+    }
+}
+
+/*!
+ * Multikey quicksort (Bentley and Sedgewick) of the std::string range
+ * [begin,end), in which all strings share a common prefix of length depth.
+ * Partitions by the character at depth into <, =, > parts, and only the =
+ * part proceeds to the next character. Small ranges are insertion sorted.
+ */
+template <typename Iterator>
+static inline
+void multikey_quicksort(Iterator begin, Iterator end, size_t depth = 0) {
+    static_assert(
+        std::is_same<typename std::iterator_traits<Iterator>::value_type,
+                     std::string>::value,
+        "multikey_quicksort() sorts std::string");
+
+    while (end - begin > 16)
+    {
+        // median of three pivot character
+        size_t n = end - begin;
+        int a = string_char_at(begin[0], depth);
+        int b = string_char_at(begin[n / 2], depth);
+        int c = string_char_at(begin[n - 1], depth);
+        int pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+        // three-way partition [begin,lt) < pivot, [lt,gt) == pivot, rest >
+        Iterator lt = begin, i = begin, gt = end;
+        while (i < gt) {
+            int ch = string_char_at(*i, depth);
+            if (ch < pivot)
+                std::swap(*lt++, *i++);
+            else if (ch > pivot)
+                std::swap(*i, *--gt);
+            else
+                ++i;
+        }
+
+        multikey_quicksort(begin, lt, depth);
+        multikey_quicksort(gt, end, depth);
+
+        // strings equal to the pivot end at depth, if pivot is -1.
+        if (pivot < 0) return;
+
+        begin = lt, end = gt, ++depth;
+    }
+
+    if (end - begin > 1)
+        string_insertion_sort(begin, end, depth);
+}
+
+} // namespace common
+} // namespace thrill
+
+#endif // !THRILL_COMMON_STRING_SORT_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,165 @@
+/*******************************************************************************
+ * thrill/core/golomb_bloom_filter.hpp
+ *
+ * Distributed single shot bloom filter of hashes, sent Golomb encoded.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_GOLOMB_BLOOM_FILTER_HEADER
+#define THRILL_CORE_GOLOMB_BLOOM_FILTER_HEADER
+
+#include <thrill/api/context.hpp>
+#include <thrill/common/logger.hpp>
+#include <thrill/core/delta_stream.hpp>
+#include <thrill/core/golomb_bit_stream.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Distributed single shot bloom filter of the hashes of all workers' items,
+ * which is replicated on every worker. This can be used to drop items of the
+ * other input of a join which certainly have no partner, before they are
+ * shuffled.
+ *
+ * Each worker sorts its hashes modulo max_hash and sends them to all workers
+ * as a Golomb encoded delta stream, like core::DuplicateDetection. Each worker
+ * then merges the received hashes into a bitset of max_hash bits. Due to the
+ * bloom filter's inherent properties, there are false positives with rate about
+ * 1/fpr_parameter, but no false negatives.
+ *
+ * Since the filter is replicated, each worker receives the encoded hashes of
+ * all workers and holds the bitset of size_bytes(n) for n hashes in total.
+ * Callers should check this size before building the filter.
+ */
+class GolombBloomFilter
+{
+    static constexpr bool debug = false;
+
+    using GolombBitStreamWriter =
+              core::GolombBitStreamWriter<data::CatStream::Writer>;
+
+    using GolombBitStreamReader =
+              core::GolombBitStreamReader<data::CatStream::Reader>;
+
+    using GolumbDeltaWriter =
+              core::DeltaStreamWriter<GolombBitStreamWriter, size_t, /* offset */ 1>;
+
+    using GolumbDeltaReader =
+              core::DeltaStreamReader<GolombBitStreamReader, size_t, /* offset */ 1>;
+
+    //! Parameter for false positive rate (FPR: 1/fpr_parameter)
+    static constexpr size_t fpr_parameter = 8;
+
+    //! Sends all distinct hashes to all workers, Golomb encoded.
+    void WriteEncodedHashes(const data::CatStreamPtr& stream_pointer,
+                            const std::vector<size_t>& hashes,
+                            size_t golomb_param) {
+
+        data::CatStream::Writers writers = stream_pointer->GetWriters();
+
+        for (size_t i = 0; i < writers.size(); ++i) {
+            GolombBitStreamWriter golomb_writer(writers[i], golomb_param);
+            GolumbDeltaWriter delta_writer(
+                golomb_writer,
+                /* initial */ size_t(-1) /* cancels with +1 bias */);
+
+            size_t prev_hash = size_t(-1);
+            for (const size_t& hash : hashes) {
+                if (hash == prev_hash)
+                    continue;
+                delta_writer.Put(hash);
+                prev_hash = hash;
+            }
+        }
+    }
+
+public:
+    //! Returns the size of the bitset on each worker in bytes, for num_hashes
+    //! hashes of all workers.
+    static size_t size_bytes(size_t num_hashes) {
+        return (std::max<size_t>(num_hashes * fpr_parameter, 1) + 7) / 8;
+    }
+
+    /*!
+     * Builds the filter from the hashes of the items of all workers. This is a
+     * collective operation.
+     *
+     * \param hashes Hashes for all elements on this worker, which are sorted
+     * modulo the bitset size afterwards.
+     * \param context Thrill context, used for collective communication
+     * \param dia_id Id of the operation, which calls this method. Used
+     *   to uniquely identify the data streams used.
+     */
+    void Build(std::vector<size_t>& hashes, Context& context, size_t dia_id) {
+
+        size_t upper_bound_uniques = context.net.AllReduce(hashes.size());
+
+        size_t golomb_param = fpr_parameter;
+        max_hash_ = std::max<size_t>(upper_bound_uniques * fpr_parameter, 1);
+
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            hashes[i] = hashes[i] % max_hash_;
+        }
+
+        std::sort(hashes.begin(), hashes.end());
+
+        data::CatStreamPtr golomb_data_stream = context.GetNewCatStream(dia_id);
+
+        WriteEncodedHashes(golomb_data_stream, hashes, golomb_param);
+
+        // read inbound Golomb/delta-encoded hashes into the bitset
+
+        bits_.assign(max_hash_, false);
+
+        std::vector<data::CatStream::Reader> readers =
+            golomb_data_stream->GetReaders();
+
+        for (data::CatStream::Reader& reader : readers)
+        {
+            GolombBitStreamReader golomb_reader(reader, golomb_param);
+            GolumbDeltaReader delta_reader(
+                golomb_reader, /* initial */ size_t(-1) /* cancels at +1 */);
+
+            while (delta_reader.HasNext()) {
+                size_t hash = delta_reader.Next<size_t>();
+                assert(hash < bits_.size());
+                bits_[hash] = true;
+            }
+        }
+
+        sLOG << "GolombBloomFilter::Build() uniques" << upper_bound_uniques
+             << "bits" << max_hash_;
+    }
+
+    //! Returns whether an item with the hash may be in the filter.
+    bool Contains(size_t hash) const {
+        return bits_[hash % max_hash_];
+    }
+
+    //! Deallocate the bitset.
+    void Clear() {
+        std::vector<bool>().swap(bits_);
+    }
+
+private:
+    //! bitset of hashes modulo max_hash_ of all workers
+    std::vector<bool> bits_;
+
+    //! modulo for all hashes
+    size_t max_hash_ = 1;
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_GOLOMB_BLOOM_FILTER_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,434 @@
+/*******************************************************************************
+ * thrill/core/group_by_hash_table.hpp
+ *
+ * Hash table grouping items by key without sorting, for GroupByKey.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_GROUP_BY_HASH_TABLE_HEADER
+#define THRILL_CORE_GROUP_BY_HASH_TABLE_HEADER
+
+#include <thrill/common/hash.hpp>
+#include <thrill/common/logger.hpp>
+#include <thrill/core/multiway_merge.hpp>
+#include <thrill/core/run_generator.hpp>
+#include <thrill/data/file.hpp>
+#include <thrill/mem/malloc_tracker.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Hash table which groups items by key, such that each group can be handed to
+ * a group function without any comparison sort.
+ *
+ * Items are appended to an array, and the items of each key are linked into a
+ * chain of array indexes in insertion order. If the table reaches its capacity
+ * or memory is exceeded, all items are spilled into num_partitions Files by
+ * their key hash, and after inserting all items each partition File is grouped
+ * on its own. Partitions still too large for the capacity are split again with
+ * a different salt of the hash, up to max_level times. A partition which is
+ * still too large then holds keys with more items than fit into memory: it is
+ * sorted into runs by key, which are merged and grouped while streaming, hence
+ * this fallback requires operator < on keys.
+ */
+template <typename ValueType, typename Key_,
+          typename KeyExtractor, typename HashFunction>
+class GroupByHashTable
+{
+    static constexpr bool debug = false;
+
+    //! end of a key's chain
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+public:
+    //! number of partitions spilled items are split into
+    static constexpr size_t num_partitions = 16;
+
+    //! maximum number of times a spilled partition is split
+    static constexpr size_t max_level = 4;
+
+    //! key type of the items
+    using Key = Key_;
+
+    //! memory needed per item beyond the item itself, if each has its own key
+    static constexpr size_t item_overhead = sizeof(Key) + 5 * sizeof(size_t);
+
+    //! Sorted stream of items, from which the groups of a partition too
+    //! large for memory are read.
+    class SortedSource
+    {
+    public:
+        virtual ~SortedSource() { }
+        //! whether the next item has the current group's key
+        virtual bool HasNextInGroup() const = 0;
+        //! return the next item
+        virtual ValueType Next() = 0;
+    };
+
+    /*!
+     * Iterator over the items of one group, handed to the group function. It
+     * has the interface of api::GroupByIterator: HasNext() and Next() iterate
+     * the group's items, and GetNextKey() returns the group's key. The items
+     * are read from the chain of the group in memory, or from a SortedSource.
+     */
+    class GroupIterator
+    {
+    public:
+        using ValueIn = ValueType;
+        using Key = Key_;
+
+        GroupIterator(const std::vector<ValueType>& items,
+                      const std::vector<size_t>& next, size_t first,
+                      const Key& key)
+            : items_(items), next_(next), pos_(first), key_(key) { }
+
+        GroupIterator(const std::vector<ValueType>& items,
+                      const std::vector<size_t>& next,
+                      SortedSource* source, const Key& key)
+            : items_(items), next_(next), pos_(npos), key_(key),
+              source_(source) { }
+
+        //! non-copyable: delete copy-constructor
+        GroupIterator(const GroupIterator&) = delete;
+        //! non-copyable: delete assignment operator
+        GroupIterator& operator = (const GroupIterator&) = delete;
+        //! move-constructor: default
+        GroupIterator(GroupIterator&&) = default;
+
+        bool HasNext() const {
+            if (source_ != nullptr)
+                return source_->HasNextInGroup();
+            return pos_ != npos;
+        }
+
+        ValueIn Next() {
+            assert(HasNext());
+            if (source_ != nullptr)
+                return source_->Next();
+            size_t pos = pos_;
+            pos_ = next_[pos];
+            return items_[pos];
+        }
+
+        //! Returns the key of the group.
+        const Key& GetNextKey() const { return key_; }
+
+    private:
+        const std::vector<ValueType>& items_;
+        const std::vector<size_t>& next_;
+        size_t pos_;
+        Key key_;
+        //! source of the items if the group is read from sorted runs
+        SortedSource* source_ = nullptr;
+    };
+
+    GroupByHashTable(data::BlockPool& block_pool, size_t local_worker_id,
+                     size_t dia_id, const KeyExtractor& key_extractor,
+                     const HashFunction& hash_function)
+        : block_pool_(block_pool), local_worker_id_(local_worker_id),
+          dia_id_(dia_id), key_extractor_(key_extractor),
+          hash_function_(hash_function),
+          index_(0, hash_function) { }
+
+    //! Set the capacity from a memory limit in bytes.
+    void Initialize(size_t limit_memory_bytes) {
+        capacity_ = std::max<size_t>(
+            limit_memory_bytes / (sizeof(ValueType) + item_overhead), 1);
+    }
+
+    //! Insert an item, after spilling all items if the table is full.
+    void Insert(const ValueType& v) {
+        if (items_.size() >= capacity_ ||
+            (mem::memory_exceeded && !items_.empty()))
+            Spill();
+        Append(v);
+    }
+
+    //! Finish inserting: if items were spilled, spill the remaining ones too.
+    void Finish() {
+        if (partitions_.empty()) return;
+
+        Spill();
+        for (data::File::Writer& w : writers_)
+            w.Close();
+        writers_.clear();
+        Clear();
+
+        sLOG << "GroupByHashTable::Finish() spilled into"
+             << partitions_.size() << "partitions";
+    }
+
+    /*!
+     * Calls visit(iterator, key) for each group, with a GroupIterator over the
+     * group's items. Spilled partitions are read and grouped one at a time.
+     */
+    template <typename Visit>
+    void ForEachGroup(const Visit& visit, bool consume) {
+        if (partitions_.empty()) {
+            VisitGroups(visit);
+            if (consume) Dispose();
+            return;
+        }
+        for (data::File& file : partitions_)
+            GroupFile(file, /* level */ 1, visit, consume);
+        if (consume) partitions_.clear();
+    }
+
+    //! Returns the number of items in memory.
+    size_t size() const { return items_.size(); }
+
+    //! Returns whether items were spilled into partition Files.
+    bool has_spilled() const { return !partitions_.empty(); }
+
+    //! Deallocate all items, chains and partition Files.
+    void Dispose() {
+        std::vector<ValueType>().swap(items_);
+        std::vector<size_t>().swap(next_);
+        std::vector<Group>().swap(groups_);
+        index_.clear();
+        writers_.clear();
+        partitions_.clear();
+    }
+
+private:
+    //! first and last item of a key's chain
+    struct Group {
+        size_t first, last;
+    };
+
+    data::BlockPool& block_pool_;
+    size_t local_worker_id_;
+    size_t dia_id_;
+
+    KeyExtractor key_extractor_;
+    HashFunction hash_function_;
+
+    //! maximum number of items in memory
+    size_t capacity_ = 1;
+
+    //! items in insertion order
+    std::vector<ValueType> items_;
+
+    //! index of the next item with the same key
+    std::vector<size_t> next_;
+
+    //! chain of each key in order of first occurrence
+    std::vector<Group> groups_;
+
+    //! index of keys into groups_
+    std::unordered_map<Key, size_t, HashFunction> index_;
+
+    //! Files of spilled items partitioned by hash, and their writers
+    std::deque<data::File> partitions_;
+    std::vector<data::File::Writer> writers_;
+
+    //! orders items by key for the sorting fallback
+    class KeyLess
+    {
+    public:
+        explicit KeyLess(const KeyExtractor& key_extractor)
+            : key_extractor_(key_extractor) { }
+
+        bool operator () (const ValueType& a, const ValueType& b) const {
+            return key_extractor_(a) < key_extractor_(b);
+        }
+
+    private:
+        KeyExtractor key_extractor_;
+    };
+
+    //! SortedSource reading the groups from a merge of sorted runs.
+    template <typename Puller>
+    class MergedSource final : public SortedSource
+    {
+    public:
+        MergedSource(Puller& puller, const KeyExtractor& key_extractor)
+            : puller_(puller), key_extractor_(key_extractor) {
+            Advance();
+        }
+
+        bool HasNextInGroup() const final {
+            return has_next_ && in_group_ && next_key_ == group_key_;
+        }
+
+        ValueType Next() final {
+            ValueType v = std::move(next_);
+            Advance();
+            return v;
+        }
+
+        //! whether another group follows
+        bool HasGroup() const { return has_next_; }
+
+        //! skip the rest of the current group, and start the next one
+        const Key& StartGroup() {
+            while (HasNextInGroup()) Advance();
+            group_key_ = next_key_;
+            in_group_ = true;
+            return group_key_;
+        }
+
+    private:
+        Puller& puller_;
+        const KeyExtractor& key_extractor_;
+        bool has_next_ = false;
+        //! whether StartGroup() was called, and group_key_ is valid
+        bool in_group_ = false;
+        ValueType next_;
+        Key next_key_, group_key_;
+
+        void Advance() {
+            has_next_ = puller_.HasNext();
+            if (!has_next_) return;
+            next_ = puller_.Next();
+            next_key_ = key_extractor_(next_);
+        }
+    };
+
+    //! partition of a key's hash, salted by the spill level
+    size_t partition_of(const ValueType& v, size_t level) const {
+        return common::Hash128to64(level, hash_function_(key_extractor_(v)))
+               % num_partitions;
+    }
+
+    //! Append an item to its key's chain.
+    void Append(const ValueType& v) {
+        size_t i = items_.size();
+        items_.push_back(v);
+        next_.push_back(npos);
+
+        auto it = index_.find(key_extractor_(v));
+        if (it == index_.end()) {
+            index_.emplace(key_extractor_(v), groups_.size());
+            groups_.push_back(Group { i, i });
+        }
+        else {
+            Group& g = groups_[it->second];
+            next_[g.last] = i;
+            g.last = i;
+        }
+    }
+
+    //! Remove all items from memory, keeping the arrays' capacity.
+    void Clear() {
+        items_.clear();
+        next_.clear();
+        groups_.clear();
+        index_.clear();
+    }
+
+    //! Write all items in memory to the partition Files.
+    void Spill() {
+        if (writers_.empty()) {
+            for (size_t p = 0; p < num_partitions; ++p) {
+                partitions_.emplace_back(block_pool_, local_worker_id_, dia_id_);
+                writers_.emplace_back(partitions_.back().GetWriter());
+            }
+        }
+        for (const ValueType& v : items_)
+            writers_[partition_of(v, /* level */ 0)].Put(v);
+        Clear();
+    }
+
+    //! Calls visit(iterator, key) for each group in memory.
+    template <typename Visit>
+    void VisitGroups(const Visit& visit) {
+        for (const Group& g : groups_) {
+            GroupIterator iter(
+                items_, next_, g.first, key_extractor_(items_[g.first]));
+            visit(iter, iter.GetNextKey());
+        }
+    }
+
+    //! Group the items of a spilled partition File, which is split further if
+    //! it does not fit into memory.
+    template <typename Visit>
+    void GroupFile(data::File& file, size_t level,
+                   const Visit& visit, bool consume) {
+        if (file.num_items() > capacity_ && level >= max_level)
+            return SortFile(file, visit, consume);
+
+        if (file.num_items() <= capacity_) {
+            auto reader = file.GetReader(consume);
+            while (reader.HasNext())
+                Append(reader.template Next<ValueType>());
+            VisitGroups(visit);
+            Clear();
+            return;
+        }
+
+        std::deque<data::File> parts;
+        std::vector<data::File::Writer> writers;
+        for (size_t p = 0; p < num_partitions; ++p) {
+            parts.emplace_back(block_pool_, local_worker_id_, dia_id_);
+            writers.emplace_back(parts.back().GetWriter());
+        }
+        {
+            auto reader = file.GetReader(consume);
+            while (reader.HasNext()) {
+                ValueType v = reader.template Next<ValueType>();
+                writers[partition_of(v, level)].Put(v);
+            }
+        }
+        for (data::File::Writer& w : writers)
+            w.Close();
+        writers.clear();
+
+        for (data::File& part : parts)
+            GroupFile(part, level + 1, visit, /* consume */ true);
+    }
+
+    //! Group the items of a partition File with keys having more items than
+    //! fit into memory: form runs sorted by key, merge them, and visit the
+    //! groups of the merged stream.
+    template <typename Visit>
+    void SortFile(data::File& file, const Visit& visit, bool consume) {
+        sLOG << "GroupByHashTable: sorting partition of"
+             << file.num_items() << "items";
+
+        std::deque<data::File> runs;
+        {
+            RunGenerator<ValueType, KeyLess> run_generator(
+                block_pool_, local_worker_id_, dia_id_, runs, capacity_,
+                KeyLess(key_extractor_));
+            auto reader = file.GetReader(consume);
+            while (reader.HasNext()) {
+                run_generator.UpdateMemoryPressure(mem::memory_exceeded);
+                run_generator.Insert(reader.template Next<ValueType>());
+            }
+            run_generator.Finish();
+        }
+
+        std::vector<data::File::ConsumeReader> seq;
+        seq.reserve(runs.size());
+        for (data::File& run : runs)
+            seq.emplace_back(run.GetConsumeReader());
+
+        auto puller = make_multiway_merge_tree<ValueType>(
+            seq.begin(), seq.end(), KeyLess(key_extractor_));
+
+        MergedSource<decltype(puller)> source(puller, key_extractor_);
+        while (source.HasGroup()) {
+            GroupIterator iter(items_, next_, &source, source.StartGroup());
+            visit(iter, iter.GetNextKey());
+        }
+    }
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_GROUP_BY_HASH_TABLE_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,149 @@
+/*******************************************************************************
+ * thrill/core/join_hash_table.hpp
+ *
+ * Hash table of the build side of a hash join.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_JOIN_HASH_TABLE_HEADER
+#define THRILL_CORE_JOIN_HASH_TABLE_HEADER
+
+#include <thrill/common/logger.hpp>
+
+#include <tlx/math/round_to_power_of_two.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Hash table holding the items of the build side of a hash join, such that the
+ * items of the probe side can be streamed through it.
+ *
+ * Items and their key hashes are appended to arrays by Insert(). Build() then
+ * links the items of each bucket into a chain of array indexes, with a power of
+ * two number of buckets of at least the number of items. Find() walks the chain
+ * of a key's bucket and compares the stored hashes before the keys. This costs
+ * two words per item plus one per bucket beyond the items themselves, and no
+ * allocation per item.
+ */
+template <typename ValueType, typename Key,
+          typename KeyExtractor, typename HashFunction>
+class JoinHashTable
+{
+    static constexpr bool debug = false;
+
+    //! end of a bucket chain
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+public:
+    //! memory needed per item beyond the item itself
+    static constexpr size_t item_overhead = 3 * sizeof(size_t);
+
+    JoinHashTable(const KeyExtractor& key_extractor,
+                  const HashFunction& hash_function)
+        : key_extractor_(key_extractor), hash_function_(hash_function) { }
+
+    //! Reserve space for n items.
+    void Reserve(size_t n) {
+        items_.reserve(n);
+        hashes_.reserve(n);
+    }
+
+    //! Insert an item, which can be found only after Build().
+    void Insert(const ValueType& item) {
+        items_.push_back(item);
+        hashes_.push_back(hash_function_(key_extractor_(item)));
+    }
+
+    //! Link the inserted items into bucket chains.
+    void Build() {
+        mask_ = tlx::round_up_to_power_of_two(
+            std::max<size_t>(items_.size(), 1)) - 1;
+
+        heads_.assign(mask_ + 1, size_t(npos));
+        next_.resize(items_.size());
+
+        for (size_t i = 0; i < items_.size(); ++i) {
+            size_t& head = heads_[hashes_[i] & mask_];
+            next_[i] = head;
+            head = i;
+        }
+
+        sLOG << "JoinHashTable::Build() items" << items_.size()
+             << "buckets" << heads_.size();
+    }
+
+    //! Calls visit(item) for each item with the given key and its hash.
+    template <typename Visit>
+    void Find(const Key& key, size_t hash, Visit visit) const {
+        for (size_t i = heads_[hash & mask_]; i != npos; i = next_[i]) {
+            if (hashes_[i] == hash && key_extractor_(items_[i]) == key)
+                visit(items_[i]);
+        }
+    }
+
+    //! Calls visit(item) for each item with the given key.
+    template <typename Visit>
+    void Find(const Key& key, Visit visit) const {
+        return Find(key, hash_function_(key), visit);
+    }
+
+    //! Returns the number of items.
+    size_t size() const { return items_.size(); }
+
+    //! Returns whether the table is empty.
+    bool empty() const { return items_.empty(); }
+
+    //! Move the items out of the table and deallocate the chains.
+    std::vector<ValueType> ReleaseItems() {
+        std::vector<ValueType> items = std::move(items_);
+        Clear();
+        return items;
+    }
+
+    //! Deallocate all items and chains.
+    void Clear() {
+        std::vector<ValueType>().swap(items_);
+        std::vector<size_t>().swap(hashes_);
+        std::vector<size_t>().swap(next_);
+        std::vector<size_t>().swap(heads_);
+        mask_ = 0;
+    }
+
+private:
+    //! key extractor of the build side
+    KeyExtractor key_extractor_;
+
+    //! hash function for keys
+    HashFunction hash_function_;
+
+    //! items of the build side
+    std::vector<ValueType> items_;
+
+    //! key hash of each item
+    std::vector<size_t> hashes_;
+
+    //! index of the next item in the same bucket
+    std::vector<size_t> next_;
+
+    //! index of the first item in each bucket
+    std::vector<size_t> heads_;
+
+    //! number of buckets minus one
+    size_t mask_ = 0;
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_JOIN_HASH_TABLE_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,247 @@
+/*******************************************************************************
+ * thrill/core/join_heavy_keys.hpp
+ *
+ * Detection of heavy join keys, whose items are split across several workers.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_JOIN_HEAVY_KEYS_HEADER
+#define THRILL_CORE_JOIN_HEAVY_KEYS_HEADER
+
+#include <thrill/common/logger.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Heavy key hashes of a join, whose items are not all sent to the single worker
+ * of the hash. Instead, the items of the input with more items of the key (the
+ * heavy input) are spread round-robin over a range of workers, and the items
+ * of the other input are replicated to all workers of the range. Each pair of
+ * items thus still meets on exactly one worker.
+ *
+ * The hashes of the first sample_size items of each input are counted in a
+ * SpaceSaving sketch with capacity counters. The counters are merged over all
+ * workers (MergeCounters), and hashes with at least rate of the sampled items
+ * are heavy (SetHeavyKeys). Hashes are counted instead of keys, hence keys with
+ * equal hash are treated alike, which is correct as items are only routed by
+ * the hash.
+ */
+class JoinHeavyKeys
+{
+    static constexpr bool debug = false;
+
+public:
+    //! sketch counter of a hash, with the number of items of both inputs
+    struct Counter {
+        size_t hash;
+        size_t count[2];
+
+        size_t total() const { return count[0] + count[1]; }
+    };
+
+    //! range of workers of a heavy hash
+    struct Heavy {
+        //! first worker of the range, which wraps around
+        size_t first_worker;
+        //! number of workers in the range
+        size_t num_workers;
+        //! index of the input whose items are spread over the range
+        size_t heavy_input;
+        //! round-robin counter of the next worker
+        size_t next;
+
+        //! Returns the i-th worker of the range
+        size_t worker(size_t i, size_t num_total_workers) const {
+            return (first_worker + i % num_workers) % num_total_workers;
+        }
+    };
+
+    JoinHeavyKeys(size_t capacity, size_t sample_size, double rate)
+        : capacity_(std::max<size_t>(capacity, 1)), sample_size_(sample_size),
+          rate_(rate) { }
+
+    //! Counts the hash of an item of the input with index input, if the sample
+    //! of this input is not complete.
+    void Insert(size_t hash, size_t input) {
+        if (num_sampled_[input] >= sample_size_) return;
+        ++num_sampled_[input];
+
+        auto it = index_.find(hash);
+        if (it != index_.end()) {
+            ++counters_[it->second].count[input];
+            return;
+        }
+        if (counters_.size() < capacity_) {
+            index_.emplace(hash, counters_.size());
+            counters_.push_back(Counter { hash, { 0, 0 } });
+            ++counters_.back().count[input];
+            return;
+        }
+        // replace the minimum counter, which keeps its counts
+        size_t min = 0;
+        for (size_t i = 1; i < counters_.size(); ++i) {
+            if (counters_[i].total() < counters_[min].total()) min = i;
+        }
+        index_.erase(counters_[min].hash);
+        index_.emplace(hash, min);
+        counters_[min].hash = hash;
+        ++counters_[min].count[input];
+    }
+
+    //! Returns the local sketch counters.
+    const std::vector<Counter>& counters() const { return counters_; }
+
+    //! Returns the number of sampled items of both inputs.
+    const std::array<size_t, 2>& num_sampled() const { return num_sampled_; }
+
+    //! Merges two counter lists by hash, limited to the capacity largest.
+    std::vector<Counter> MergeCounters(
+        const std::vector<Counter>& a, const std::vector<Counter>& b) const {
+        std::vector<Counter> out = a;
+        std::unordered_map<size_t, size_t> index(a.size() + b.size());
+        for (size_t i = 0; i < out.size(); ++i)
+            index.emplace(out[i].hash, i);
+
+        for (const Counter& c : b) {
+            auto it = index.find(c.hash);
+            if (it == index.end()) {
+                index.emplace(c.hash, out.size());
+                out.push_back(c);
+            }
+            else {
+                out[it->second].count[0] += c.count[0];
+                out[it->second].count[1] += c.count[1];
+            }
+        }
+
+        if (out.size() > capacity_) {
+            std::stable_sort(out.begin(), out.end(),
+                             [](const Counter& x, const Counter& y) {
+                                 return x.total() > y.total();
+                             });
+            out.resize(capacity_);
+        }
+        return out;
+    }
+
+    /*!
+     * Selects the heavy hashes from the merged counters, which are those with
+     * at least rate of all sampled items. The items of each input with the key
+     * are estimated from the sample, and the heavy input's items are spread
+     * over as many workers as needed to give each its average share of both
+     * inputs. Hashes needing only one worker are not heavy.
+     *
+     * \param global counters merged over all workers
+     *
+     * \param sampled number of items sampled of both inputs on all workers
+     *
+     * \param total number of items of both inputs on all workers
+     *
+     * \param num_workers total number of workers
+     *
+     * \param my_rank rank of this worker, to start the round-robin counters
+     */
+    void SetHeavyKeys(const std::vector<Counter>& global,
+                      const std::array<size_t, 2>& sampled,
+                      const std::array<size_t, 2>& total,
+                      size_t num_workers, size_t my_rank) {
+        num_workers_ = num_workers;
+
+        double num_sampled = static_cast<double>(sampled[0] + sampled[1]);
+        double share = static_cast<double>(total[0] + total[1])
+                       / static_cast<double>(num_workers);
+
+        for (const Counter& c : global) {
+            if (static_cast<double>(c.total()) < rate_ * num_sampled) continue;
+
+            double estimate[2];
+            for (size_t i = 0; i < 2; ++i) {
+                estimate[i] = sampled[i] == 0 ? 0.0 :
+                              static_cast<double>(c.count[i])
+                              * static_cast<double>(total[i])
+                              / static_cast<double>(sampled[i]);
+            }
+
+            size_t heavy_input = estimate[0] >= estimate[1] ? 0 : 1;
+            size_t range = static_cast<size_t>(
+                std::ceil(estimate[heavy_input] / std::max(share, 1.0)));
+            range = std::min(range, num_workers);
+            if (range <= 1) continue;
+
+            heavy_.emplace(c.hash, Heavy {
+                               c.hash % num_workers, range, heavy_input, my_rank
+                           });
+        }
+
+        sLOG << "JoinHeavyKeys: selected" << heavy_.size() << "heavy keys of"
+             << global.size() << "candidates";
+
+        std::vector<Counter>().swap(counters_);
+        index_.clear();
+    }
+
+    //! Returns the heavy hash range of a hash, or nullptr if it is not heavy.
+    Heavy * Find(size_t hash) {
+        if (heavy_.empty()) return nullptr;
+        auto it = heavy_.find(hash);
+        return it == heavy_.end() ? nullptr : &it->second;
+    }
+
+    /*!
+     * Calls send(worker) for the workers an item of the given input with a
+     * heavy hash is sent to: the next worker of the range for the heavy input,
+     * or all workers of the range for the other input.
+     */
+    template <typename Send>
+    void Route(Heavy& h, size_t input, const Send& send) const {
+        if (input == h.heavy_input) {
+            send(h.worker(h.next++, num_workers_));
+        }
+        else {
+            for (size_t i = 0; i < h.num_workers; ++i)
+                send(h.worker(i, num_workers_));
+        }
+    }
+
+    //! Returns the number of heavy hashes.
+    size_t num_heavy() const { return heavy_.size(); }
+
+private:
+    //! number of counters in the sketch and maximum number of heavy keys
+    size_t capacity_;
+    //! number of items sampled of each input
+    size_t sample_size_;
+    //! fraction of sampled items a heavy key has at least
+    double rate_;
+
+    //! number of items sampled of both inputs
+    std::array<size_t, 2> num_sampled_ = { { 0, 0 } };
+
+    //! counters of the sketch
+    std::vector<Counter> counters_;
+    //! index of hashes into counters_
+    std::unordered_map<size_t, size_t> index_;
+
+    //! total number of workers
+    size_t num_workers_ = 1;
+    //! heavy hashes and their worker ranges
+    std::unordered_map<size_t, Heavy> heavy_;
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_JOIN_HEAVY_KEYS_HEADER
+
+/******************************************************************************/
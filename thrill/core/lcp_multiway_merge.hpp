@@ -0,0 +1,287 @@
+/*******************************************************************************
+ * thrill/core/lcp_multiway_merge.hpp
+ *
+ * Front-coded string runs and an LCP-aware loser tree to merge them.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_LCP_MULTIWAY_MERGE_HEADER
+#define THRILL_CORE_LCP_MULTIWAY_MERGE_HEADER
+
+#include <thrill/data/serialization.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Item of a front-coded string run: the length of the common prefix with the
+ * previous string of the run, and the remaining suffix.
+ */
+struct FrontCodedString {
+    size_t      lcp;
+    std::string suffix;
+
+    static constexpr bool thrill_is_fixed_size = false;
+    static constexpr size_t thrill_fixed_size = 0;
+
+    template <typename Archive>
+    void ThrillSerialize(Archive& ar) const {
+        ar.PutVarint(lcp);
+        ar.PutString(suffix);
+    }
+
+    template <typename Archive>
+    static FrontCodedString ThrillDeserialize(Archive& ar) {
+        size_t lcp = ar.GetVarint();
+        return FrontCodedString { lcp, ar.GetString() };
+    }
+};
+
+//! length of the longest common prefix of a and b
+static inline size_t string_lcp(const std::string& a, const std::string& b) {
+    size_t h = 0, n = std::min(a.size(), b.size());
+    while (h < n && a[h] == b[h]) ++h;
+    return h;
+}
+
+/*!
+ * Writes a sorted sequence of std::string to a File::Writer front-coded as
+ * FrontCodedString items.
+ */
+template <typename Writer>
+class FrontCodedStringWriter
+{
+public:
+    explicit FrontCodedStringWriter(Writer&& writer)
+        : writer_(std::move(writer)) { }
+
+    FrontCodedStringWriter& Put(const std::string& s) {
+        size_t lcp = string_lcp(prev_, s);
+        writer_.Put(FrontCodedString { lcp, s.substr(lcp) });
+        prev_ = s;
+        return *this;
+    }
+
+    void Close() { writer_.Close(); }
+
+private:
+    Writer writer_;
+    //! previous string written
+    std::string prev_;
+};
+
+/*!
+ * Reads std::string items from a File::Reader of a front-coded run, and
+ * delivers the LCP of each string with its predecessor.
+ */
+template <typename Reader>
+class FrontCodedStringReader
+{
+public:
+    explicit FrontCodedStringReader(Reader&& reader)
+        : reader_(std::move(reader)) { }
+
+    bool HasNext() { return reader_.HasNext(); }
+
+    template <typename T>
+    T Next() {
+        static_assert(std::is_same<T, std::string>::value,
+                      "front-coded runs contain std::string");
+        FrontCodedString fc = reader_.template Next<FrontCodedString>();
+        assert(fc.lcp <= prev_.size());
+        prev_.resize(fc.lcp);
+        prev_ += fc.suffix;
+        lcp_ = fc.lcp;
+        return prev_;
+    }
+
+    //! LCP of the last string returned by Next() with its predecessor
+    size_t lcp() const { return lcp_; }
+
+    //! underlying reader's BlockSource, e.g. for prefetching
+    auto& source() { return reader_.source(); }
+
+private:
+    Reader reader_;
+    std::string prev_;
+    size_t lcp_ = 0;
+};
+
+/*!
+ * Multiway merge of sorted std::string sequences with an LCP-aware loser tree.
+ * Each reader must deliver lcp(): the LCP of its last string with the previous
+ * one, e.g. FrontCodedStringReader. The tree stores the LCP of each loser with
+ * the winner it lost against. After a winner is taken out, the losers on its
+ * path and the successor from its sequence all have LCPs relative to that
+ * winner. Hence, games are mostly decided by comparing LCPs, and characters
+ * are only compared beyond equal LCPs, so common prefixes are never compared
+ * twice.
+ */
+template <typename ReaderIterator>
+class LcpMultiwayMergeTree
+{
+public:
+    LcpMultiwayMergeTree(ReaderIterator readers_begin,
+                         ReaderIterator readers_end)
+        : readers_(readers_begin),
+          num_inputs_(readers_end - readers_begin) {
+
+        k_ = 1;
+        while (k_ < num_inputs_) k_ *= 2;
+
+        current_.resize(k_);
+        valid_.resize(k_, false);
+        tree_.resize(k_);
+
+        for (size_t t = 0; t < num_inputs_; ++t) {
+            if (readers_[t].HasNext()) {
+                current_[t] = readers_[t].template Next<std::string>();
+                valid_[t] = true;
+                ++remaining_inputs_;
+            }
+        }
+
+        // all LCPs are relative to the empty string initially.
+        winner_ = Init(1);
+    }
+
+    bool HasNext() const {
+        return (remaining_inputs_ != 0);
+    }
+
+    std::string Next() {
+        assert(HasNext());
+
+        // take next smallest string out
+        Entry cand = winner_;
+        size_t top = cand.source;
+        std::string res = std::move(current_[top]);
+        lcp_ = cand.lcp;
+
+        // its successor has an LCP relative to res, like the losers on the path
+        if (readers_[top].HasNext()) {
+            current_[top] = readers_[top].template Next<std::string>();
+            cand.lcp = readers_[top].lcp();
+        }
+        else {
+            valid_[top] = false;
+            cand.lcp = 0;
+            --remaining_inputs_;
+        }
+
+        for (size_t node = (k_ + top) / 2; node >= 1; node /= 2)
+            Play(cand, tree_[node]);
+
+        winner_ = cand;
+        return res;
+    }
+
+    //! LCP of the last string returned by Next() with the string before
+    size_t lcp() const { return lcp_; }
+
+private:
+    struct Entry {
+        //! index of input sequence
+        size_t source;
+        //! LCP with the reference string of the game
+        size_t lcp;
+    };
+
+    ReaderIterator readers_;
+    size_t num_inputs_;
+    size_t remaining_inputs_ = 0;
+
+    //! number of leaves, a power of two
+    size_t k_;
+    //! current strings of each input
+    std::vector<std::string> current_;
+    //! whether an input has a current string
+    std::vector<bool> valid_;
+    //! losers of the games in inner nodes [1,k)
+    std::vector<Entry> tree_;
+    //! overall winner
+    Entry winner_;
+    //! LCP of the last output string
+    size_t lcp_ = 0;
+
+    //! play initial games in the subtree of node, return its winner.
+    Entry Init(size_t node) {
+        if (node >= k_)
+            return Entry { node - k_, 0 };
+
+        Entry winner = Init(2 * node);
+        tree_[node] = Init(2 * node + 1);
+        Play(winner, tree_[node]);
+        return winner;
+    }
+
+    /*!
+     * Play a game between winner and loser, whose LCPs are relative to the
+     * same string which is not larger than either. Afterwards, winner holds
+     * the smaller entry with unchanged LCP, and loser the other with its LCP
+     * relative to the winner.
+     */
+    void Play(Entry& winner, Entry& loser) {
+        if (!valid_[loser.source]) return;
+        if (!valid_[winner.source]) {
+            std::swap(winner, loser);
+            return;
+        }
+
+        // the string sharing the longer prefix with the reference is smaller
+        if (winner.lcp > loser.lcp) return;
+        if (winner.lcp < loser.lcp) {
+            std::swap(winner, loser);
+            return;
+        }
+
+        // equal LCPs: compare characters beyond the common prefix
+        const std::string& a = current_[winner.source];
+        const std::string& b = current_[loser.source];
+        size_t h = winner.lcp;
+        while (h < a.size() && h < b.size() && a[h] == b[h]) ++h;
+
+        bool b_less;
+        if (h == a.size())
+            b_less = false;
+        else if (h == b.size())
+            b_less = true;
+        else
+            b_less = static_cast<unsigned char>(b[h])
+                     < static_cast<unsigned char>(a[h]);
+
+        if (b_less) {
+            winner.lcp = h;
+            std::swap(winner, loser);
+        }
+        else {
+            loser.lcp = h;
+        }
+    }
+};
+
+//! Construct an LcpMultiwayMergeTree of the string readers [begin,end).
+template <typename ReaderIterator>
+auto make_lcp_multiway_merge_tree(
+    ReaderIterator seqs_begin, ReaderIterator seqs_end) {
+    assert(seqs_end - seqs_begin >= 1);
+    return LcpMultiwayMergeTree<ReaderIterator>(seqs_begin, seqs_end);
+}
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_LCP_MULTIWAY_MERGE_HEADER
+
+/******************************************************************************/
@@ -20,7 +20,10 @@
 #include <thrill/core/delta_stream.hpp>
 #include <thrill/core/golomb_bit_stream.hpp>
 #include <thrill/core/multiway_merge.hpp>
+#include <thrill/core/reduce_adaptive_hash_table.hpp>
+#include <thrill/core/reduce_arena_hash_table.hpp>
 #include <thrill/core/reduce_bucket_hash_table.hpp>
+#include <thrill/core/reduce_fingerprint_hash_table.hpp>
 #include <thrill/core/reduce_functional.hpp>
 #include <thrill/core/reduce_old_probing_hash_table.hpp>
 #include <thrill/core/reduce_probing_hash_table.hpp>
@@ -12,10 +12,15 @@
 #ifndef THRILL_CORE_MULTIWAY_MERGE_HEADER
 #define THRILL_CORE_MULTIWAY_MERGE_HEADER
 
+#include <thrill/data/serialization.hpp>
+
+#include <tlx/define/likely.hpp>
 #include <tlx/loser_tree.hpp>
 
 #include <algorithm>
 #include <functional>
+#include <iterator>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -112,6 +117,161 @@ private:
     std::vector<std::pair<bool, ValueType> > current_;
 };
 
+/*!
+ * Multiway merge tree for comparators which deliver a normalized key prefix of
+ * each item via key(item), such as api::NormalizedKeyCompare: key(a) < key(b)
+ * must imply comp(a,b). The key of each input's current item is cached, games
+ * in the loser tree compare the integer keys and call the comparator only on
+ * equal keys. Items of fixed-size types are read in batches from each input,
+ * and their keys are extracted together.
+ */
+template <typename ValueType, typename ReaderIterator, typename Comparator>
+class PrefixMultiwayMergeTree
+{
+public:
+    using Reader = typename std::iterator_traits<ReaderIterator>::value_type;
+
+    using Key = typename std::decay<
+              decltype(std::declval<const Comparator&>().key(
+                           std::declval<const ValueType&>()))>::type;
+
+    //! number of items read from an input at once
+    static constexpr size_t batch_size_ =
+        data::Serialization<Reader, ValueType>::is_fixed_size ? 16 : 1;
+
+    PrefixMultiwayMergeTree(
+        ReaderIterator readers_begin, ReaderIterator readers_end,
+        const Comparator& comp)
+        : readers_(readers_begin),
+          num_inputs_(static_cast<size_t>(readers_end - readers_begin)),
+          comp_(comp) {
+
+        k_ = 1;
+        while (k_ < num_inputs_) k_ *= 2;
+
+        inputs_.resize(k_);
+        tree_.resize(k_);
+
+        for (size_t t = 0; t < num_inputs_; ++t) {
+            if (Refill(t)) ++remaining_inputs_;
+        }
+
+        winner_ = Init(1);
+    }
+
+    bool HasNext() const {
+        return (remaining_inputs_ != 0);
+    }
+
+    std::pair<ValueType, unsigned> NextWithSource() {
+        unsigned top = static_cast<unsigned>(winner_);
+        return std::make_pair(Next(), top);
+    }
+
+    ValueType Next() {
+        // take next smallest element out
+        size_t top = winner_;
+        Input& in = inputs_[top];
+        ValueType res = std::move(in.items[in.pos]);
+
+        if (++in.pos == in.items.size() && !Refill(top)) {
+            assert(remaining_inputs_ > 0);
+            --remaining_inputs_;
+        }
+
+        // replay games on the path to the root
+        for (size_t node = (k_ + top) / 2; node >= 1; node /= 2) {
+            if (Beats(tree_[node], top))
+                std::swap(tree_[node], top);
+        }
+        winner_ = top;
+
+        return res;
+    }
+
+private:
+    //! buffered items of an input with their keys
+    struct Input {
+        std::vector<ValueType> items;
+        std::vector<Key> keys;
+        size_t pos = 0;
+        bool valid = false;
+    };
+
+    ReaderIterator readers_;
+    size_t num_inputs_;
+    size_t remaining_inputs_ = 0;
+    Comparator comp_;
+
+    //! number of leaves, a power of two
+    size_t k_;
+    std::vector<Input> inputs_;
+    //! losers of the games in inner nodes [1,k)
+    std::vector<size_t> tree_;
+    //! overall winner
+    size_t winner_;
+
+    //! read the next batch of input t, returns false if it is exhausted.
+    bool Refill(size_t t) {
+        Input& in = inputs_[t];
+        in.items.clear();
+        in.keys.clear();
+        in.pos = 0;
+        while (in.items.size() < batch_size_ && readers_[t].HasNext())
+            in.items.emplace_back(readers_[t].template Next<ValueType>());
+        for (const ValueType& v : in.items)
+            in.keys.emplace_back(comp_.key(v));
+        return (in.valid = !in.items.empty());
+    }
+
+    //! whether the current item of input a is smaller than that of b.
+    bool Beats(size_t a, size_t b) const {
+        const Input& ia = inputs_[a], & ib = inputs_[b];
+        if (!ia.valid) return false;
+        if (!ib.valid) return true;
+        const Key& ka = ia.keys[ia.pos], & kb = ib.keys[ib.pos];
+        if (TLX_LIKELY(ka != kb)) return ka < kb;
+        return comp_(ia.items[ia.pos], ib.items[ib.pos]);
+    }
+
+    //! play initial games in the subtree of node, return its winner.
+    size_t Init(size_t node) {
+        if (node >= k_) return node - k_;
+
+        size_t a = Init(2 * node), b = Init(2 * node + 1);
+        if (Beats(b, a)) std::swap(a, b);
+        tree_[node] = b;
+        return a;
+    }
+};
+
+//! type trait whether Comparator delivers normalized keys of ValueType items
+template <typename Comparator, typename ValueType, typename = void>
+struct HasNormalizedKey : public std::false_type { };
+
+template <typename Comparator, typename ValueType>
+struct HasNormalizedKey<
+    Comparator, ValueType,
+    decltype(void(std::declval<const Comparator&>().key(
+                      std::declval<const ValueType&>())))>
+    : public std::true_type { };
+
+template <typename ValueType, typename ReaderIterator, typename Comparator>
+auto make_multiway_merge_tree(
+    ReaderIterator seqs_begin, ReaderIterator seqs_end,
+    const Comparator& comp, std::false_type /* normalized_key */) {
+    return MultiwayMergeTree<ValueType, ReaderIterator, Comparator>(
+        seqs_begin, seqs_end, comp);
+}
+
+template <typename ValueType, typename ReaderIterator, typename Comparator>
+auto make_multiway_merge_tree(
+    ReaderIterator seqs_begin, ReaderIterator seqs_end,
+    const Comparator& comp, std::true_type /* normalized_key */) {
+    return PrefixMultiwayMergeTree<ValueType, ReaderIterator, Comparator>(
+        seqs_begin, seqs_end, comp);
+}
+
 /*!
  * Sequential multi-way merging switch for a file writer as output
  *
@@ -131,8 +291,9 @@ auto make_multiway_merge_tree(
     const Comparator& comp = Comparator()) {
 
     assert(seqs_end - seqs_begin >= 1);
-    return MultiwayMergeTree<ValueType, ReaderIterator, Comparator>(
-        seqs_begin, seqs_end, comp);
+    return make_multiway_merge_tree<ValueType>(
+        seqs_begin, seqs_end, comp,
+        HasNormalizedKey<Comparator, ValueType>());
 }
 
 } // namespace core
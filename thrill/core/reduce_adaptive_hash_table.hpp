@@ -0,0 +1,427 @@
+/*******************************************************************************
+ * thrill/core/reduce_adaptive_hash_table.hpp
+ *
+ * Reduce table which selects the probing or bucket hash table at runtime from
+ * statistics measured on the first items of the input.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_REDUCE_ADAPTIVE_HASH_TABLE_HEADER
+#define THRILL_CORE_REDUCE_ADAPTIVE_HASH_TABLE_HEADER
+
+#include <thrill/common/logger.hpp>
+#include <thrill/core/reduce_bucket_hash_table.hpp>
+#include <thrill/core/reduce_functional.hpp>
+#include <thrill/core/reduce_probing_hash_table.hpp>
+#include <thrill/core/reduce_table.hpp>
+#include <thrill/data/file.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * A reduce table which dispatches to a ReduceProbingHashTable or a
+ * ReduceBucketHashTable, selected at runtime. Items are inserted into the
+ * probing table until calibration_items_ were seen. Meanwhile, the items are
+ * serialized into a File to measure their memory per item, and the probing
+ * table counts the distinct keys among them.
+ *
+ * The decision is computed from these measurements, not from timings, hence it
+ * is deterministic for a given input. For both tables at their fill limit under
+ * the actual memory limit, the expected number of cache lines touched by an
+ * insert is estimated: linear probing in the probing table, the bucket pointer
+ * and chain scan in the bucket table, and one access to the heap payload per
+ * key comparison. The distinct key rate weighs unsuccessful and successful
+ * searches. The cheaper table wins, and the decision is written to the
+ * JsonLogger. If the bucket table is selected, the items and spilled files of
+ * the probing table are moved into it. A spill or flush of the probing table
+ * before the sample is complete ends the calibration, keeping the probing
+ * table.
+ *
+ * Both tables derive from the same ReduceTable, hence all accessors are
+ * forwarded to the active one.
+ */
+template <typename ValueType, typename Key, typename Value,
+          typename KeyExtractor, typename ReduceFunction, typename Emitter,
+          const bool VolatileKey,
+          typename ReduceConfig_,
+          typename IndexFunction,
+          typename KeyEqualFunction = std::equal_to<Key> >
+class ReduceAdaptiveHashTable
+{
+    static constexpr bool debug = false;
+
+    using Super = ReduceTable<ValueType, Key, Value,
+                              KeyExtractor, ReduceFunction, Emitter,
+                              VolatileKey, ReduceConfig_, IndexFunction,
+                              KeyEqualFunction>;
+
+    template <typename TableEmitter>
+    using ProbingTableT = ReduceProbingHashTable<
+              ValueType, Key, Value, KeyExtractor, ReduceFunction,
+              TableEmitter, VolatileKey, ReduceConfig_,
+              IndexFunction, KeyEqualFunction>;
+
+    template <typename TableEmitter>
+    using BucketTableT = ReduceBucketHashTable<
+              ValueType, Key, Value, KeyExtractor, ReduceFunction,
+              TableEmitter, VolatileKey, ReduceConfig_,
+              IndexFunction, KeyEqualFunction>;
+
+    using ProbingTable = ProbingTableT<Emitter>;
+    using BucketTable = BucketTableT<Emitter>;
+
+public:
+    using ReduceConfig = ReduceConfig_;
+    using TableItem = typename Super::TableItem;
+    using MakeTableItem = typename Super::MakeTableItem;
+    using IndexResult = typename IndexFunction::Result;
+
+    ReduceAdaptiveHashTable(
+        Context& ctx, size_t dia_id,
+        const KeyExtractor& key_extractor,
+        const ReduceFunction& reduce_function,
+        Emitter& emitter,
+        size_t num_partitions,
+        const ReduceConfig& config = ReduceConfig(),
+        bool immediate_flush = false,
+        const IndexFunction& index_function = IndexFunction(),
+        const KeyEqualFunction& key_equal_function = KeyEqualFunction())
+        : probing_(ctx, dia_id, key_extractor, reduce_function, emitter,
+                   num_partitions, config, immediate_flush,
+                   index_function, key_equal_function),
+          bucket_(ctx, dia_id, key_extractor, reduce_function, emitter,
+                  num_partitions, config, immediate_flush,
+                  index_function, key_equal_function),
+          config_(config), immediate_flush_(immediate_flush),
+          sample_file_(ctx.GetFile(dia_id)),
+          sample_writer_(sample_file_.GetWriter()) { }
+
+    //! Initializes the probing table, which takes the items until the
+    //! calibration is done.
+    void Initialize(size_t limit_memory_bytes) {
+        limit_memory_bytes_ = limit_memory_bytes;
+        probing_.Initialize(limit_memory_bytes);
+    }
+
+    //! Lets the probing table acquire its memory from a shared budget, see
+    //! ReduceTable::SetMemoryBudget(). The bucket table does not use it.
+    void SetMemoryBudget(ReduceMemoryBudget* budget, size_t account) {
+        probing_.SetMemoryBudget(budget, account);
+    }
+
+    //! Initialize table for SkipPreReducePhase, no calibration required.
+    void InitializeSkip() {
+        probing_.InitializeSkip();
+        calibrating_ = false;
+    }
+
+    bool Insert(const TableItem& kv) {
+        return Insert(kv, calculate_index(kv));
+    }
+
+    void Prefetch(const IndexResult& h) const {
+        if (use_bucket_)
+            bucket_.Prefetch(h);
+        else
+            probing_.Prefetch(h);
+    }
+
+    bool Insert(const TableItem& kv, const IndexResult& h) {
+        if (TLX_LIKELY(!calibrating_)) {
+            return use_bucket_ ? bucket_.Insert(kv, h) : probing_.Insert(kv, h);
+        }
+        sample_writer_.Put(kv);
+        ++sample_items_;
+        size_t num_items = probing_.num_items();
+        bool new_key = probing_.Insert(kv, h);
+        // an internal spill or flush of the probing table also ends the
+        // calibration, as the table no longer holds the sample's keys.
+        if (sample_items_ >= config_.calibration_items_ ||
+            probing_.num_items() != num_items + (new_key ? 1 : 0))
+            Calibrate();
+        return new_key;
+    }
+
+    void Dispose() {
+        calibrating_ = false;
+        sample_writer_.Close();
+        sample_file_.Clear();
+        probing_.Dispose();
+        bucket_.Dispose();
+    }
+
+    //! \name Spilling and Flushing, which end the calibration
+    //! \{
+
+    void SpillPartition(size_t partition_id) {
+        Calibrate();
+        if (use_bucket_)
+            bucket_.SpillPartition(partition_id);
+        else
+            probing_.SpillPartition(partition_id);
+    }
+
+    void SpillAnyPartition() {
+        Calibrate();
+        if (use_bucket_)
+            bucket_.SpillAnyPartition();
+        else
+            probing_.SpillAnyPartition();
+    }
+
+    void SpillLargestPartition() {
+        Calibrate();
+        if (use_bucket_)
+            bucket_.SpillLargestPartition();
+        else
+            probing_.SpillLargestPartition();
+    }
+
+    template <typename Emit>
+    void FlushPartitionEmit(
+        size_t partition_id, bool consume, bool grow, Emit emit) {
+        Calibrate();
+        if (use_bucket_)
+            bucket_.FlushPartitionEmit(partition_id, consume, grow, emit);
+        else
+            probing_.FlushPartitionEmit(partition_id, consume, grow, emit);
+    }
+
+    void FlushPartition(size_t partition_id, bool consume, bool grow) {
+        Calibrate();
+        if (use_bucket_)
+            bucket_.FlushPartition(partition_id, consume, grow);
+        else
+            probing_.FlushPartition(partition_id, consume, grow);
+    }
+
+    void FlushAll() {
+        Calibrate();
+        if (use_bucket_)
+            bucket_.FlushAll();
+        else
+            probing_.FlushAll();
+    }
+
+    //! \}
+
+    //! \name Accessors of the active table
+    //! \{
+
+    //! Returns whether the bucket table was selected
+    bool use_bucket() const { return use_bucket_; }
+
+    Context& ctx() const { return active().ctx(); }
+    size_t dia_id() const { return active().dia_id(); }
+    const KeyExtractor& key_extractor() const
+    { return active().key_extractor(); }
+    const ReduceFunction& reduce_function() const
+    { return active().reduce_function(); }
+    const Emitter& emitter() const { return active().emitter(); }
+    const IndexFunction& index_function() const
+    { return active().index_function(); }
+    const KeyEqualFunction& key_equal_function() const
+    { return active().key_equal_function(); }
+    std::vector<data::File>& partition_files()
+    { return active().partition_files(); }
+    size_t num_partitions() { return active().num_partitions(); }
+    size_t num_buckets() const { return active().num_buckets(); }
+    size_t num_buckets_per_partition() const
+    { return active().num_buckets_per_partition(); }
+    size_t limit_memory_bytes() const { return limit_memory_bytes_; }
+    size_t items_per_partition(size_t id) const
+    { return active().items_per_partition(id); }
+    size_t num_items() const { return active().num_items(); }
+    size_t num_items_calc() const { return active().num_items_calc(); }
+    common::Range key_range(size_t partition_id)
+    { return active().key_range(partition_id); }
+    bool has_spilled_data() const { return active().has_spilled_data(); }
+    bool has_spilled_data_on_partition(size_t partition_id)
+    { return active().has_spilled_data_on_partition(partition_id); }
+
+    Key key(const TableItem& t) const { return active().key(t); }
+    TableItem reduce(const TableItem& a, const TableItem& b) const
+    { return active().reduce(a, b); }
+    IndexResult calculate_index(const TableItem& kv) const
+    { return active().calculate_index(kv); }
+
+    //! \}
+
+private:
+    ProbingTable probing_;
+    BucketTable bucket_;
+
+    //! config of the tables
+    ReduceConfig config_;
+    //! whether the tables flush instead of spilling
+    bool immediate_flush_;
+    //! memory limit of the tables
+    size_t limit_memory_bytes_ = 0;
+
+    //! whether the sample is being collected
+    bool calibrating_ = true;
+    //! whether the bucket table was selected
+    bool use_bucket_ = false;
+    //! first items of the input, serialized to measure their size
+    data::File sample_file_;
+    //! Writer to sample_file_
+    data::File::Writer sample_writer_;
+    //! number of items in sample_file_
+    size_t sample_items_ = 0;
+
+    const Super& active() const {
+        if (use_bucket_) return bucket_;
+        return probing_;
+    }
+    Super& active() {
+        if (use_bucket_) return bucket_;
+        return probing_;
+    }
+
+    //! Expected cache lines touched by inserting an item into the probing
+    //! table with linear probing at load alpha, where a fraction distinct_rate
+    //! of the items are new keys.
+    static double ProbingInsertCost(
+        double alpha, double distinct_rate, double payload_lines) {
+        double hit = 0.5 * (1.0 + 1.0 / (1.0 - alpha));
+        double miss = 0.5 * (1.0 + 1.0 / ((1.0 - alpha) * (1.0 - alpha)));
+        double probes = distinct_rate * miss + (1.0 - distinct_rate) * hit;
+        // consecutive slots share cache lines.
+        double lines = 1.0 + (probes - 1.0) * sizeof(TableItem) / 64.0;
+        return lines + probes * payload_lines;
+    }
+
+    //! Expected cache lines touched by inserting an item into the bucket table,
+    //! whose chains hold chain_length items on average.
+    static double BucketInsertCost(
+        double chain_length, double distinct_rate, double payload_lines) {
+        double scanned = distinct_rate * chain_length
+                         + (1.0 - distinct_rate) * (chain_length + 1.0) / 2.0;
+        // the bucket pointer, and the items of the chain's blocks.
+        double lines = 1.0 + std::max(
+            1.0, scanned * static_cast<double>(sizeof(TableItem)) / 64.0);
+        return lines + scanned * payload_lines;
+    }
+
+    //! select the cheaper table from the statistics of the sample.
+    void Calibrate() {
+        if (TLX_LIKELY(!calibrating_)) return;
+        calibrating_ = false;
+
+        sample_writer_.Close();
+        size_t sample_bytes = sample_file_.size_bytes();
+        sample_file_.Clear();
+
+        if (sample_items_ < config_.calibration_items_) {
+            // too few items to tell the tables apart.
+            return;
+        }
+
+        // memory per item: the serialized size, and the part exceeding the
+        // table slot, which lives in the heap and is touched by key compares.
+        double bytes_per_item =
+            static_cast<double>(sample_bytes)
+            / static_cast<double>(sample_items_);
+        double payload_bytes = std::max(
+            0.0, bytes_per_item - static_cast<double>(sizeof(TableItem)));
+        double payload_lines = payload_bytes / 64.0;
+        if (payload_bytes > 0) payload_lines += 1.0;
+
+        // fraction of items with a new key, which search unsuccessfully and
+        // fill the table.
+        double distinct_rate =
+            static_cast<double>(probing_.num_items())
+            / static_cast<double>(sample_items_);
+
+        // both tables are compared at their fill limit, where large inputs
+        // spend their time. Then the bucket table's chains hold block_size_ *
+        // fill / bucket_rate items on average, see
+        // ReduceBucketHashTable::Initialize().
+        double alpha = std::min(config_.limit_partition_fill_rate(), 0.95);
+        double chain_length =
+            static_cast<double>(BucketTable::block_size_) * alpha
+            / std::max(config_.bucket_rate(), 0.01);
+
+        double cost_probing =
+            ProbingInsertCost(alpha, distinct_rate, payload_lines);
+        double cost_bucket =
+            BucketInsertCost(chain_length, distinct_rate, payload_lines);
+
+        use_bucket_ = cost_bucket < cost_probing;
+
+        ctx().logger_
+            << "class" << "ReduceAdaptiveHashTable"
+            << "event" << "calibrate"
+            << "dia_id" << dia_id()
+            << "sample_items" << sample_items_
+            << "bytes_per_item" << bytes_per_item
+            << "distinct_rate" << distinct_rate
+            << "cost_probing" << cost_probing
+            << "cost_bucket" << cost_bucket
+            << "table" << (use_bucket_ ? "bucket" : "probing");
+
+        sLOG << "ReduceAdaptiveHashTable: bytes_per_item" << bytes_per_item
+             << "distinct_rate" << distinct_rate
+             << "cost probing" << cost_probing << "bucket" << cost_bucket
+             << "selected" << (use_bucket_ ? "bucket" : "probing");
+
+        if (!use_bucket_) return;
+
+        // move the items of the probing table into a vector, then the probing
+        // table is disposed before the bucket table allocates its memory.
+        std::vector<TableItem> items;
+        items.reserve(probing_.num_items());
+        for (size_t id = 0; id < probing_.num_partitions(); ++id) {
+            probing_.FlushPartitionEmit(
+                id, /* consume */ true, /* grow */ false,
+                [&items](const size_t&, const TableItem& p) {
+                    items.push_back(p);
+                });
+        }
+        if (!immediate_flush_) {
+            for (size_t id = 0; id < probing_.num_partitions(); ++id) {
+                std::swap(bucket_.partition_files()[id],
+                          probing_.partition_files()[id]);
+            }
+        }
+        probing_.Dispose();
+
+        bucket_.Initialize(limit_memory_bytes_);
+        for (const TableItem& kv : items)
+            bucket_.Insert(kv);
+    }
+};
+
+template <typename TableItem, typename Key, typename Value,
+          typename KeyExtractor, typename ReduceFunction,
+          typename Emitter, const bool VolatileKey,
+          typename ReduceConfig, typename IndexFunction,
+          typename KeyEqualFunction>
+class ReduceTableSelect<
+        ReduceTableImpl::ADAPTIVE,
+        TableItem, Key, Value, KeyExtractor, ReduceFunction,
+        Emitter, VolatileKey, ReduceConfig, IndexFunction, KeyEqualFunction>
+{
+public:
+    using type = ReduceAdaptiveHashTable<
+              TableItem, Key, Value, KeyExtractor, ReduceFunction,
+              Emitter, VolatileKey, ReduceConfig,
+              IndexFunction, KeyEqualFunction>;
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_REDUCE_ADAPTIVE_HASH_TABLE_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,633 @@
+/*******************************************************************************
+ * thrill/core/reduce_arena_hash_table.hpp
+ *
+ * Linear probing reduce table for std::string keys, which stores the key bytes
+ * inline or in per-partition bump arenas next to the keys' hashes.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_REDUCE_ARENA_HASH_TABLE_HEADER
+#define THRILL_CORE_REDUCE_ARENA_HASH_TABLE_HEADER
+
+#include <thrill/core/reduce_functional.hpp>
+#include <thrill/core/reduce_table.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Bump allocator for the key bytes of one partition of a
+ * ReduceArenaHashTable. Memory is allocated in blocks and only released all at
+ * once by Clear(), which keeps the first block for reuse.
+ */
+class ReduceKeyArena
+{
+public:
+    explicit ReduceKeyArena(size_t block_size)
+        : block_size_(block_size) { }
+
+    //! Returns size bytes of uninitialized memory.
+    char* Allocate(size_t size) {
+        if (TLX_UNLIKELY(size > left_)) {
+            size_t n = std::max(block_size_, size);
+            if (blocks_.empty()) first_size_ = n;
+            blocks_.emplace_back(new char[n]);
+            pos_ = blocks_.back().get();
+            left_ = n;
+        }
+        char* p = pos_;
+        pos_ += size;
+        left_ -= size;
+        size_ += size;
+        return p;
+    }
+
+    //! Releases all keys, keeps the first block if it is a regular one.
+    void Clear() {
+        if (!blocks_.empty() && first_size_ == block_size_) {
+            blocks_.resize(1);
+            pos_ = blocks_[0].get();
+            left_ = block_size_;
+        }
+        else {
+            blocks_.clear();
+            pos_ = nullptr;
+            left_ = 0;
+        }
+        size_ = 0;
+    }
+
+    //! Returns the number of key bytes allocated since the last Clear().
+    size_t size() const { return size_; }
+
+private:
+    //! size of regular blocks
+    size_t block_size_;
+    //! size of the first block
+    size_t first_size_ = 0;
+    //! allocated blocks
+    std::vector<std::unique_ptr<char[]> > blocks_;
+    //! free space in the last block
+    char* pos_ = nullptr;
+    size_t left_ = 0;
+    //! bytes allocated
+    size_t size_ = 0;
+};
+
+//! Part of a TableItem (a pair of key and Value) stored next to the key bytes
+//! in a ReduceArenaHashTable: only the Value.
+template <typename TableItem, typename Value>
+class ReduceArenaItem
+{
+public:
+    using Stored = Value;
+
+    static const std::string& GetKey(const TableItem& t) {
+        return t.first;
+    }
+
+    static const Stored& Store(const TableItem& t) { return t.second; }
+
+    template <typename ReduceFunction>
+    static void Reduce(Stored& s, const TableItem& t,
+                       ReduceFunction& reduce_function) {
+        s = reduce_function(s, t.second);
+    }
+
+    //! reassembles the pair in buffer, whose string capacity is reused.
+    static const TableItem& Make(
+        TableItem& buffer, const char* key, size_t size, const Stored& s) {
+        buffer.first.assign(key, size);
+        buffer.second = s;
+        return buffer;
+    }
+};
+
+/*!
+ * A linear probing reduce hash table for std::string keys, e.g. of text
+ * aggregations like WordCount. Instead of TableItems, the slots hold the key's
+ * hash, its length, its bytes and the Value. Hence, the table requires
+ * VolatileKey, where TableItems are pairs of key and Value: otherwise the key
+ * would be stored twice, in its bytes and within the item.
+ * Keys of up to inline_key_size bytes are stored in the slot itself, longer
+ * ones in a bump arena of the partition, which is cleared when the partition
+ * is flushed or spilled. Hence, inserting, reducing, growing and flushing do
+ * not allocate or free a std::string per key, and probing compares stored
+ * hashes before touching any key bytes.
+ *
+ * Half of the memory limit is used for the slots, the other half for the
+ * arenas. A partition whose arena exceeds its share is spilled. The
+ * partitioning and growing scheme is the same as in ReduceProbingHashTable.
+ * Keys are compared bytewise, hence KeyEqualFunction must be std::equal_to.
+ */
+template <typename TableItem, typename Key, typename Value,
+          typename KeyExtractor, typename ReduceFunction, typename Emitter,
+          const bool VolatileKey,
+          typename ReduceConfig_,
+          typename IndexFunction,
+          typename KeyEqualFunction = std::equal_to<Key> >
+class ReduceArenaHashTable
+    : public ReduceTable<TableItem, Key, Value,
+                         KeyExtractor, ReduceFunction, Emitter,
+                         VolatileKey, ReduceConfig_,
+                         IndexFunction, KeyEqualFunction>
+{
+    using Super = ReduceTable<TableItem, Key, Value,
+                              KeyExtractor, ReduceFunction, Emitter,
+                              VolatileKey, ReduceConfig_, IndexFunction,
+                              KeyEqualFunction>;
+    using Super::debug;
+
+    static_assert(VolatileKey,
+                  "ReduceArenaHashTable requires VolatileKey");
+    static_assert(std::is_same<Key, std::string>::value,
+                  "ReduceArenaHashTable requires std::string keys");
+    static_assert(std::is_same<KeyEqualFunction,
+                               std::equal_to<std::string> >::value,
+                  "ReduceArenaHashTable compares keys bytewise");
+
+    using ArenaItem = ReduceArenaItem<TableItem, Value>;
+    using Stored = typename ArenaItem::Stored;
+    using IndexResult = typename IndexFunction::Result;
+
+    //! maximum length of keys stored in the slot
+    static constexpr size_t inline_key_size = 16;
+
+    //! length of empty slots
+    static constexpr uint32_t empty_slot = uint32_t(-1);
+
+    struct Slot {
+        //! remaining hash bits of the key
+        size_t   hash;
+        //! short keys inline, longer ones in the partition's arena
+        union {
+            char        inline_key[inline_key_size];
+            const char* arena_key;
+        };
+        //! length of the key, or empty_slot
+        uint32_t size;
+        //! Value, only constructed in non-empty slots
+        Stored   stored;
+    };
+
+public:
+    using ReduceConfig = ReduceConfig_;
+
+    ReduceArenaHashTable(
+        Context& ctx, size_t dia_id,
+        const KeyExtractor& key_extractor,
+        const ReduceFunction& reduce_function,
+        Emitter& emitter,
+        size_t num_partitions,
+        const ReduceConfig& config = ReduceConfig(),
+        bool immediate_flush = false,
+        const IndexFunction& index_function = IndexFunction(),
+        const KeyEqualFunction& key_equal_function = KeyEqualFunction())
+        : Super(ctx, dia_id,
+                key_extractor, reduce_function, emitter,
+                num_partitions, config, immediate_flush,
+                index_function, key_equal_function)
+    { assert(num_partitions > 0); }
+
+    //! Construct the hash table itself and mark all slots empty, and the
+    //! partitions' arenas.
+    void Initialize(size_t limit_memory_bytes) {
+        assert(!slots_);
+
+        limit_memory_bytes_ = limit_memory_bytes;
+
+        // half of the memory is for the slots, the other half for the arenas
+        num_buckets_per_partition_ = std::max<size_t>(
+            1,
+            (size_t)(static_cast<double>(limit_memory_bytes_) / 2.0
+                     / static_cast<double>(sizeof(Slot))
+                     / static_cast<double>(num_partitions_)));
+
+        num_buckets_ = num_buckets_per_partition_ * num_partitions_;
+
+        limit_arena_bytes_ = limit_memory_bytes_ / 2 / num_partitions_;
+
+        partition_size_.resize(
+            num_partitions_,
+            std::min(size_t(config_.initial_items_per_partition_),
+                     num_buckets_per_partition_));
+
+        double limit_fill_rate = config_.limit_partition_fill_rate();
+
+        assert(limit_fill_rate >= 0.0 && limit_fill_rate <= 1.0
+               && "limit_partition_fill_rate must be between 0.0 and 1.0. "
+               "with a fill rate of 0.0, items are immediately flushed.");
+
+        limit_items_per_partition_.resize(
+            num_partitions_,
+            static_cast<size_t>(
+                static_cast<double>(partition_size_[0]) * limit_fill_rate));
+
+        slots_ = static_cast<Slot*>(operator new (num_buckets_ * sizeof(Slot)));
+        for (size_t i = 0; i < num_buckets_; ++i)
+            slots_[i].size = empty_slot;
+
+        size_t arena_block_size = std::max<size_t>(
+            256, std::min<size_t>(64 * 1024, limit_arena_bytes_ / 4));
+
+        arenas_.reserve(num_partitions_);
+        for (size_t id = 0; id < num_partitions_; ++id)
+            arenas_.emplace_back(arena_block_size);
+    }
+
+    ~ReduceArenaHashTable() {
+        if (slots_) Dispose();
+    }
+
+    //! Calculates the index of an item without copying its key.
+    IndexResult calculate_index(const TableItem& kv) const {
+        return index_function_(
+            ArenaItem::GetKey(kv),
+            num_partitions_, num_buckets_per_partition_, num_buckets_);
+    }
+
+    /*!
+     * Inserts a value into the table, potentially reducing it in case both the
+     * key of the value already in the table and the key of the value to be
+     * inserted are the same.
+     *
+     * An insert may trigger a resize of the partition in case the maximal fill
+     * ratio per partition is reached, or a spill or flush of it if the
+     * partition's arena is full.
+     *
+     * \param kv Value to be inserted into the table.
+     *
+     * \return true if a new key was inserted to the table
+     */
+    bool Insert(const TableItem& kv) {
+        return Insert(kv, calculate_index(kv));
+    }
+
+    //! Prefetch the home slot of an item with index h.
+    void Prefetch(const IndexResult& h) const {
+        common::prefetch(
+            slots_ + h.partition_id * num_buckets_per_partition_ +
+            h.local_index(partition_size_[h.partition_id]));
+    }
+
+    //! Inserts a value whose index h was already calculated, e.g. by a
+    //! ReduceTableInsertBatch which prefetched its slot.
+    bool Insert(const TableItem& kv, const IndexResult& h) {
+
+        assert(h.partition_id < num_partitions_);
+
+        const std::string& k = ArenaItem::GetKey(kv);
+        assert(k.size() < empty_slot);
+
+        const size_t size = partition_size_[h.partition_id];
+        Slot* pslots = slots_ + h.partition_id * num_buckets_per_partition_;
+
+        size_t pos = h.local_index(size);
+
+        for (size_t scanned = 0; ; ++scanned)
+        {
+            // flush partition and retry, if all slots are reserved
+            if (TLX_UNLIKELY(scanned >= size)) {
+                GrowAndRehash(h.partition_id);
+                return Insert(kv, h);
+            }
+
+            Slot& s = pslots[pos];
+            if (s.size == empty_slot) break;
+
+            if (s.hash == h.remaining_hash && s.size == k.size() &&
+                std::memcmp(key_data(s), k.data(), k.size()) == 0) {
+                ArenaItem::Reduce(s.stored, kv, reduce_function_);
+                return false;
+            }
+
+            // wrap around if beyond the current partition
+            if (++pos == size) pos = 0;
+        }
+
+        // insert new key
+        Slot& s = pslots[pos];
+        s.hash = h.remaining_hash;
+        s.size = static_cast<uint32_t>(k.size());
+        if (k.size() <= inline_key_size) {
+            std::memcpy(s.inline_key, k.data(), k.size());
+        }
+        else {
+            char* p = arenas_[h.partition_id].Allocate(k.size());
+            std::memcpy(p, k.data(), k.size());
+            s.arena_key = p;
+        }
+        new (&s.stored)Stored(ArenaItem::Store(kv));
+
+        // increase counter for partition
+        ++items_per_partition_[h.partition_id];
+        ++num_items_;
+
+        while (TLX_UNLIKELY(
+                   items_per_partition_[h.partition_id] >=
+                   limit_items_per_partition_[h.partition_id])) {
+            LOG << "Grow due to "
+                << items_per_partition_[h.partition_id] << " >= "
+                << limit_items_per_partition_[h.partition_id]
+                << " among " << partition_size_[h.partition_id];
+            GrowAndRehash(h.partition_id);
+        }
+
+        if (TLX_UNLIKELY(
+                arenas_[h.partition_id].size() > limit_arena_bytes_)) {
+            LOG << "Spill due to arena of "
+                << arenas_[h.partition_id].size() << " bytes";
+            SpillPartition(h.partition_id);
+        }
+
+        return true;
+    }
+
+    //! Deallocate items and memory
+    void Dispose() {
+        if (!slots_) return;
+
+        // dispose the items by destructor
+
+        for (size_t i = 0; i < num_buckets_; ++i) {
+            if (slots_[i].size != empty_slot)
+                slots_[i].stored.~Stored();
+        }
+
+        operator delete (slots_);
+        slots_ = nullptr;
+
+        std::vector<ReduceKeyArena>().swap(arenas_);
+
+        Super::Dispose();
+    }
+
+    void GrowAndRehash(size_t partition_id) {
+
+        size_t old_size = partition_size_[partition_id];
+        GrowPartition(partition_id);
+        if (partition_size_[partition_id] == old_size) {
+            SpillPartition(partition_id);
+            return;
+        }
+
+        if (partition_size_[partition_id] % old_size != 0) {
+            // in place rehashing won't work properly so we spill rather than
+            // potentially blasting memory limits by using an extra vector for
+            // temporary item storage
+            SpillPartition(partition_id);
+            return;
+        }
+
+        // move slots of the old range in place until passing a hole beyond
+        // it, using their stored hashes - the second half is still empty
+        const size_t size = partition_size_[partition_id];
+        Slot* pslots = slots_ + partition_id * num_buckets_per_partition_;
+
+        bool passed_first_half = false;
+        bool found_hole = false;
+        for (size_t i = 0; !passed_first_half || !found_hole; ++i) {
+            bool is_empty = (pslots[i].size == empty_slot);
+            if (!is_empty) {
+                Slot item(std::move(pslots[i]));
+                pslots[i].stored.~Stored();
+                pslots[i].size = empty_slot;
+
+                size_t pos = IndexResult { partition_id, item.hash }
+                .local_index(size);
+                while (pslots[pos].size != empty_slot) {
+                    if (++pos == size) pos = 0;
+                }
+                new (pslots + pos)Slot(std::move(item));
+            }
+
+            found_hole = passed_first_half && is_empty;
+            passed_first_half = passed_first_half || i + 1 == old_size;
+        }
+    }
+
+    //! Grow a partition after a spill or flush (if possible)
+    void GrowPartition(size_t partition_id) {
+
+        if (TLX_UNLIKELY(mem::memory_exceeded)) {
+            SpillPartition(partition_id);
+            return;
+        }
+
+        if (partition_size_[partition_id] == num_buckets_per_partition_)
+            return;
+
+        size_t new_size = std::min(
+            num_buckets_per_partition_, 2 * partition_size_[partition_id]);
+
+        sLOG << "Growing partition" << partition_id
+             << "from" << partition_size_[partition_id] << "to" << new_size
+             << "limit_items" << new_size * config_.limit_partition_fill_rate();
+
+        // new slots are already marked empty.
+        partition_size_[partition_id] = new_size;
+        limit_items_per_partition_[partition_id]
+            = new_size * config_.limit_partition_fill_rate();
+    }
+
+    //! \name Spilling Mechanisms to External Memory Files
+    //! \{
+
+    //! Spill all items of a partition into an external memory File.
+    void SpillPartition(size_t partition_id) {
+
+        if (immediate_flush_) {
+            return FlushPartition(
+                partition_id, /* consume */ true, /* grow */ !mem::memory_exceeded);
+        }
+
+        LOG << "Spilling " << items_per_partition_[partition_id]
+            << " items of partition with id: " << partition_id;
+
+        if (items_per_partition_[partition_id] == 0)
+            return;
+
+        data::File::Writer writer = partition_files_[partition_id].GetWriter();
+
+        ForEachItem(partition_id, /* consume */ true,
+                    [&writer](const TableItem& p) { writer.Put(p); });
+
+        // reset partition specific counter
+        num_items_ -= items_per_partition_[partition_id];
+        items_per_partition_[partition_id] = 0;
+        assert(num_items_ == this->num_items_calc());
+
+        LOG << "Spilled items of partition with id: " << partition_id;
+    }
+
+    //! Spill all items of an arbitrary partition into an external memory File.
+    void SpillAnyPartition() {
+        // maybe make a policy later -tb
+        return SpillLargestPartition();
+    }
+
+    //! Spill all items of the largest partition into an external memory File.
+    void SpillLargestPartition() {
+        // get partition with max size
+        size_t size_max = 0, index = 0;
+
+        for (size_t i = 0; i < num_partitions_; ++i)
+        {
+            if (items_per_partition_[i] > size_max)
+            {
+                size_max = items_per_partition_[i];
+                index = i;
+            }
+        }
+
+        if (size_max == 0) {
+            return;
+        }
+
+        return SpillPartition(index);
+    }
+
+    //! \}
+
+    //! \name Flushing Mechanisms to Next Stage or Phase
+    //! \{
+
+    template <typename Emit>
+    void FlushPartitionEmit(
+        size_t partition_id, bool consume, bool grow, Emit emit) {
+
+        LOG << "Flushing " << items_per_partition_[partition_id]
+            << " items of partition: " << partition_id;
+
+        ForEachItem(partition_id, consume,
+                    [&emit, partition_id](const TableItem& p) {
+                        emit(partition_id, p);
+                    });
+
+        if (consume) {
+            // reset partition specific counter
+            num_items_ -= items_per_partition_[partition_id];
+            items_per_partition_[partition_id] = 0;
+            assert(num_items_ == this->num_items_calc());
+        }
+
+        LOG << "Done flushed items of partition: " << partition_id;
+
+        if (grow)
+            GrowPartition(partition_id);
+    }
+
+    void FlushPartition(size_t partition_id, bool consume, bool grow) {
+        FlushPartitionEmit(
+            partition_id, consume, grow,
+            [this](const size_t& partition_id, const TableItem& p) {
+                this->emitter_.Emit(partition_id, p);
+            });
+    }
+
+    void FlushAll() {
+        for (size_t i = 0; i < num_partitions_; ++i) {
+            FlushPartition(i, /* consume */ true, /* grow */ false);
+        }
+    }
+
+    //! \}
+
+private:
+    using Super::config_;
+    using Super::immediate_flush_;
+    using Super::index_function_;
+    using Super::items_per_partition_;
+    using Super::limit_memory_bytes_;
+    using Super::num_buckets_;
+    using Super::num_buckets_per_partition_;
+    using Super::num_items_;
+    using Super::num_partitions_;
+    using Super::partition_files_;
+    using Super::reduce_function_;
+
+    //! Storing the actual hash table, only slots with a key length hold
+    //! constructed items.
+    Slot* slots_ = nullptr;
+
+    //! Arenas of the keys longer than inline_key_size of each partition
+    std::vector<ReduceKeyArena> arenas_;
+
+    //! Limit on the key bytes in a partition's arena
+    size_t limit_arena_bytes_ = 0;
+
+    //! Current sizes of the partitions because the valid allocated areas grow
+    std::vector<size_t> partition_size_;
+
+    //! Current limits on the number of items in a partitions, different for
+    //! different partitions, because the valid allocated areas grow.
+    std::vector<size_t> limit_items_per_partition_;
+
+    //! Buffer for items reassembled from slots
+    TableItem item_buffer_;
+
+    //! Returns the key bytes of a non-empty slot
+    const char* key_data(const Slot& s) const {
+        return s.size <= inline_key_size ? s.inline_key : s.arena_key;
+    }
+
+    //! Call func for all items of a partition, and remove them and clear the
+    //! partition's arena if consume is set.
+    template <typename Func>
+    void ForEachItem(size_t partition_id, bool consume, Func func) {
+        const size_t size = partition_size_[partition_id];
+        Slot* pslots = slots_ + partition_id * num_buckets_per_partition_;
+
+        for (size_t i = 0; i < size; ++i) {
+            Slot& s = pslots[i];
+            if (s.size == empty_slot) continue;
+
+            func(ArenaItem::Make(item_buffer_, key_data(s), s.size, s.stored));
+            if (consume) {
+                s.stored.~Stored();
+                s.size = empty_slot;
+            }
+        }
+
+        if (consume)
+            arenas_[partition_id].Clear();
+    }
+};
+
+template <typename TableItem, typename Key, typename Value,
+          typename KeyExtractor, typename ReduceFunction,
+          typename Emitter, const bool VolatileKey,
+          typename ReduceConfig, typename IndexFunction,
+          typename KeyEqualFunction>
+class ReduceTableSelect<
+        ReduceTableImpl::ARENA,
+        TableItem, Key, Value, KeyExtractor, ReduceFunction,
+        Emitter, VolatileKey, ReduceConfig, IndexFunction, KeyEqualFunction>
+{
+public:
+    using type = ReduceArenaHashTable<
+              TableItem, Key, Value, KeyExtractor, ReduceFunction,
+              Emitter, VolatileKey, ReduceConfig,
+              IndexFunction, KeyEqualFunction>;
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_REDUCE_ARENA_HASH_TABLE_HEADER
+
+/******************************************************************************/
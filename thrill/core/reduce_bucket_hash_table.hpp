@@ -255,12 +255,24 @@ public:
          * \return true if a new key was inserted to the table
      */
     bool Insert(const TableItem& kv) {
+        return Insert(kv, calculate_index(kv));
+    }
+
+    //! Prefetch the bucket head of an item with index h.
+    void Prefetch(const typename IndexFunction::Result& h) const {
+        common::prefetch(
+            buckets_.data() + h.partition_id * num_buckets_per_partition_ +
+            h.local_index(num_buckets_per_partition_));
+    }
+
+    //! Inserts a value whose index h was already calculated, e.g. by a
+    //! ReduceTableInsertBatch which prefetched its slot.
+    bool Insert(const TableItem& kv,
+                const typename IndexFunction::Result& h) {
 
         while (TLX_UNLIKELY(mem::memory_exceeded && num_items_ != 0))
             SpillAnyPartition();
 
-        typename IndexFunction::Result h = calculate_index(kv);
-
         size_t local_index = h.local_index(num_buckets_per_partition_);
 
         assert(h.partition_id < num_partitions_);
@@ -18,8 +18,12 @@
 
 #include <thrill/api/context.hpp>
 #include <thrill/common/logger.hpp>
+#include <thrill/core/reduce_adaptive_hash_table.hpp>
+#include <thrill/core/reduce_arena_hash_table.hpp>
 #include <thrill/core/reduce_bucket_hash_table.hpp>
+#include <thrill/core/reduce_fingerprint_hash_table.hpp>
 #include <thrill/core/reduce_functional.hpp>
+#include <thrill/core/reduce_memory_budget.hpp>
 #include <thrill/core/reduce_old_probing_hash_table.hpp>
 #include <thrill/core/reduce_probing_hash_table.hpp>
 #include <thrill/data/file.hpp>
@@ -47,6 +51,7 @@ class ReduceByHashPostPhase
 
 public:
     using ReduceConfig = ReduceConfig_;
+    using MakeTableItem = ReduceMakeTableItem<Value, TableItem, VolatileKey>;
     using PhaseEmitter = ReducePostPhaseEmitter<
               TableItem, Value, Emitter, VolatileKey>;
 
@@ -76,13 +81,20 @@ public:
                  key_extractor, reduce_function, emitter_,
                  /* num_partitions */ 32, /* TODO(tb): parameterize */
                  config, /* immediate_flush */ false,
-                 index_function, key_equal_function) { }
+                 index_function, key_equal_function),
+          batch_(table_) { }
 
     //! non-copyable: delete copy-constructor
     ReduceByHashPostPhase(const ReduceByHashPostPhase&) = delete;
     //! non-copyable: delete assignment operator
     ReduceByHashPostPhase& operator = (const ReduceByHashPostPhase&) = delete;
 
+    //! Shares the memory of the table with other tables, see
+    //! ReduceTable::SetMemoryBudget().
+    void SetMemoryBudget(ReduceMemoryBudget* budget, size_t account) {
+        table_.SetMemoryBudget(budget, account);
+    }
+
     void Initialize(size_t limit_memory_bytes) {
         table_.Initialize(limit_memory_bytes);
     }
@@ -91,6 +103,17 @@ public:
         return table_.Insert(kv);
     }
 
+    //! Inserts an item via a ReduceTableInsertBatch, which prefetches the
+    //! table slots of a batch of items before inserting them. The batch is
+    //! inserted at the latest by PushData().
+    void InsertBatched(const TableItem& kv) {
+        if (ReduceConfig::insert_batch_size_ <= 1) {
+            table_.Insert(kv);
+            return;
+        }
+        batch_.Insert(kv);
+    }
+
     //! Flushes all items in the whole table.
     template <bool DoCache>
     void Flush(bool consume, data::File::Writer* writer = nullptr) {
@@ -152,6 +175,10 @@ public:
 
         while (remaining_files.size())
         {
+            // split files which do not fit into the subtable, such that most
+            // are reduced in a single pass.
+            remaining_files = SplitFiles(std::move(remaining_files), iteration);
+
             sLOG << "ReducePostPhase: re-reducing items from"
                  << remaining_files.size() << "spilled files"
                  << "iteration" << iteration;
@@ -178,9 +205,12 @@ public:
 
                 data::File::ConsumeReader reader = file.GetConsumeReader();
 
+                ReduceTableInsertBatch<
+                    Table, ReduceConfig::insert_batch_size_> batch(subtable);
                 while (reader.HasNext()) {
-                    subtable.Insert(reader.Next<TableItem>());
+                    batch.Insert(reader.Next<TableItem>());
                 }
+                batch.Flush();
 
                 // after insertion, flush fully reduced partitions and save
                 // remaining files for next iteration.
@@ -200,6 +230,7 @@ public:
                              << subfile.num_items() << "partially reduced items";
 
                         next_remaining_files.emplace_back(std::move(subfile));
+                        subfile = subtable.ctx().GetFile(subtable.dia_id());
                     }
                     else {
                         sLOG << "partition" << id << "contains"
@@ -228,6 +259,8 @@ public:
     void PushData(bool consume = false) {
         if (!cache_)
         {
+            batch_.Flush();
+
             if (!table_.has_spilled_data()) {
                 // no items were spilled to disk, hence we can emit all data
                 // from RAM.
@@ -267,6 +300,79 @@ public:
     //! \}
 
 private:
+    /*!
+     * Splits the files whose items do not fit into a table with the memory
+     * limit into as many parts as required, by a salted hash of the keys
+     * (grace hash partitioning). The fan-out is calculated from the number of
+     * items and the byte volume of each file, and limited to the number of
+     * Blocks fitting into the memory limit, as each part's writer holds one
+     * Block. Parts which still overflow are split again in the next
+     * iteration. This terminates, since all items of one key are reduced into
+     * a single item, hence no part overflows due to a single large key group.
+     */
+    std::vector<data::File> SplitFiles(
+        std::vector<data::File>&& files, size_t iteration) {
+
+        double capacity = std::max(
+            static_cast<double>(table_.limit_memory_bytes())
+            * config_.limit_partition_fill_rate(),
+            static_cast<double>(sizeof(TableItem)));
+
+        // at least two parts, such that each split makes progress.
+        size_t max_fan_out = std::max<size_t>(
+            2, table_.limit_memory_bytes() / data::default_block_size);
+
+        // the salt differs from those of the subtables
+        IndexFunction index_function(~uint64_t(iteration),
+                                     table_.index_function());
+
+        std::vector<data::File> out;
+
+        for (data::File& file : files)
+        {
+            double volume = std::max(
+                static_cast<double>(file.num_items() * sizeof(TableItem)),
+                static_cast<double>(file.size_bytes()));
+
+            size_t fan_out = std::min(
+                max_fan_out, static_cast<size_t>(std::ceil(volume / capacity)));
+
+            if (fan_out <= 1) {
+                out.emplace_back(std::move(file));
+                continue;
+            }
+
+            sLOG << "ReducePostPhase: splitting file with"
+                 << file.num_items() << "items into" << fan_out << "parts";
+
+            std::vector<data::File> parts;
+            std::vector<data::File::Writer> writers;
+            for (size_t i = 0; i < fan_out; ++i)
+                parts.emplace_back(table_.ctx().GetFile(table_.dia_id()));
+            for (size_t i = 0; i < fan_out; ++i)
+                writers.emplace_back(parts[i].GetWriter());
+
+            data::File::ConsumeReader reader = file.GetConsumeReader();
+            while (reader.HasNext()) {
+                TableItem item = reader.Next<TableItem>();
+                size_t part = index_function(
+                    MakeTableItem::GetKey(item, table_.key_extractor()),
+                    fan_out, 1, fan_out).partition_id;
+                writers[part].Put(item);
+            }
+
+            for (data::File::Writer& w : writers)
+                w.Close();
+
+            for (data::File& part : parts) {
+                if (part.num_items() != 0)
+                    out.emplace_back(std::move(part));
+            }
+        }
+
+        return out;
+    }
+
     //! Stored reduce config to initialize the subtable.
     ReduceConfig config_;
 
@@ -276,6 +382,9 @@ private:
     //! the first-level hash table implementation
     Table table_;
 
+    //! batch buffer for InsertBatched()
+    ReduceTableInsertBatch<Table, ReduceConfig::insert_batch_size_> batch_;
+
     //! File for storing data in-case we need multiple re-reduce levels.
     data::FilePtr cache_;
 };
@@ -0,0 +1,596 @@
+/*******************************************************************************
+ * thrill/core/reduce_fingerprint_hash_table.hpp
+ *
+ * Linear probing reduce table with one-byte hash fingerprints per slot, which
+ * are scanned in groups using SIMD instructions.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_REDUCE_FINGERPRINT_HASH_TABLE_HEADER
+#define THRILL_CORE_REDUCE_FINGERPRINT_HASH_TABLE_HEADER
+
+#include <thrill/common/config.hpp>
+#include <thrill/core/reduce_functional.hpp>
+#include <thrill/core/reduce_table.hpp>
+
+#include <tlx/math/ffs.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#if defined(THRILL_HAVE_AVX2)
+#include <immintrin.h>
+#elif defined(THRILL_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace thrill {
+namespace core {
+
+/*!
+ * A group of consecutive one-byte slot fingerprints, which are compared all at
+ * once: 32 with AVX2, 16 with SSE2, or 8 with 64-bit word arithmetic as
+ * fallback. Match() returns a bit mask of the slots holding a fingerprint; slot
+ * i corresponds to bit (i << shift).
+ */
+class FingerprintGroup
+{
+public:
+#if defined(THRILL_HAVE_AVX2)
+    using Mask = uint32_t;
+    static constexpr size_t width = 32;
+    static constexpr size_t shift = 0;
+
+    explicit FingerprintGroup(const uint8_t* p)
+        : v_(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) { }
+
+    Mask Match(uint8_t fp) const {
+        return static_cast<Mask>(_mm256_movemask_epi8(
+                                     _mm256_cmpeq_epi8(
+                                         v_, _mm256_set1_epi8(
+                                             static_cast<char>(fp)))));
+    }
+
+    //! mask of the first n slots
+    static Mask Valid(size_t n) {
+        return n >= width ? ~Mask(0) : (Mask(1) << n) - 1;
+    }
+
+private:
+    __m256i v_;
+#elif defined(THRILL_HAVE_SSE2)
+    using Mask = uint32_t;
+    static constexpr size_t width = 16;
+    static constexpr size_t shift = 0;
+
+    explicit FingerprintGroup(const uint8_t* p)
+        : v_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) { }
+
+    Mask Match(uint8_t fp) const {
+        return static_cast<Mask>(_mm_movemask_epi8(
+                                     _mm_cmpeq_epi8(
+                                         v_, _mm_set1_epi8(
+                                             static_cast<char>(fp)))));
+    }
+
+    //! mask of the first n slots
+    static Mask Valid(size_t n) {
+        return (Mask(1) << std::min(n, width)) - 1;
+    }
+
+private:
+    __m128i v_;
+#else
+    using Mask = uint64_t;
+    static constexpr size_t width = 8;
+    static constexpr size_t shift = 3;
+
+    explicit FingerprintGroup(const uint8_t* p) {
+        std::memcpy(&v_, p, sizeof(v_));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v_ = __builtin_bswap64(v_);
+#endif
+    }
+
+    Mask Match(uint8_t fp) const {
+        // set the highest bit of each byte which is zero after xor-ing
+        uint64_t x = v_ ^ (lsb_ * fp);
+        return ~(((x & ~msb_) + ~msb_) | x) & msb_;
+    }
+
+    //! mask of the first n slots
+    static Mask Valid(size_t n) {
+        return n >= width ? msb_ : msb_ & ((Mask(1) << (8 * n)) - 1);
+    }
+
+private:
+    uint64_t v_;
+    static constexpr uint64_t lsb_ = 0x0101010101010101ull;
+    static constexpr uint64_t msb_ = 0x8080808080808080ull;
+#endif
+
+public:
+    //! fingerprint of an empty slot, all others have the highest bit set.
+    static constexpr uint8_t empty = 0;
+
+    Mask MatchEmpty() const { return Match(empty); }
+
+    //! index of the lowest slot in a non-zero mask
+    static size_t Lowest(Mask m) {
+        return static_cast<size_t>(tlx::ffs(m) - 1) >> shift;
+    }
+};
+
+/*!
+ * A linear probing reduce hash table in the style of Swiss tables. Next to the
+ * slots of TableItems, the table keeps an array of one-byte fingerprints of the
+ * items' hashes, zero marking an empty slot. Insert() scans the fingerprints
+ * from the home slot on in groups of FingerprintGroup::width slots with SIMD
+ * compares, and only extracts and compares the keys of the slots with matching
+ * fingerprints. As emptiness is stored in the fingerprints, there is no
+ * sentinel key, hence Key() may be a regular key, and empty slots hold no
+ * constructed items.
+ *
+ * The partitioning, growing and spilling scheme is the same as in
+ * ReduceProbingHashTable.
+ */
+template <typename TableItem, typename Key, typename Value,
+          typename KeyExtractor, typename ReduceFunction, typename Emitter,
+          const bool VolatileKey,
+          typename ReduceConfig_,
+          typename IndexFunction,
+          typename KeyEqualFunction = std::equal_to<Key> >
+class ReduceFingerprintHashTable
+    : public ReduceTable<TableItem, Key, Value,
+                         KeyExtractor, ReduceFunction, Emitter,
+                         VolatileKey, ReduceConfig_,
+                         IndexFunction, KeyEqualFunction>
+{
+    using Super = ReduceTable<TableItem, Key, Value,
+                              KeyExtractor, ReduceFunction, Emitter,
+                              VolatileKey, ReduceConfig_, IndexFunction,
+                              KeyEqualFunction>;
+    using Super::debug;
+
+    using Group = FingerprintGroup;
+    using Mask = typename Group::Mask;
+
+public:
+    using ReduceConfig = ReduceConfig_;
+
+    ReduceFingerprintHashTable(
+        Context& ctx, size_t dia_id,
+        const KeyExtractor& key_extractor,
+        const ReduceFunction& reduce_function,
+        Emitter& emitter,
+        size_t num_partitions,
+        const ReduceConfig& config = ReduceConfig(),
+        bool immediate_flush = false,
+        const IndexFunction& index_function = IndexFunction(),
+        const KeyEqualFunction& key_equal_function = KeyEqualFunction())
+        : Super(ctx, dia_id,
+                key_extractor, reduce_function, emitter,
+                num_partitions, config, immediate_flush,
+                index_function, key_equal_function)
+    { assert(num_partitions > 0); }
+
+    //! Construct the hash table itself and clear all fingerprints. Slots are
+    //! only constructed when items are inserted.
+    void Initialize(size_t limit_memory_bytes) {
+        assert(!items_);
+
+        limit_memory_bytes_ = limit_memory_bytes;
+
+        // each slot costs a TableItem and its fingerprint byte
+        num_buckets_per_partition_ = std::max<size_t>(
+            1,
+            (size_t)(static_cast<double>(limit_memory_bytes_)
+                     / static_cast<double>(sizeof(TableItem) + 1)
+                     / static_cast<double>(num_partitions_)));
+
+        num_buckets_ = num_buckets_per_partition_ * num_partitions_;
+
+        partition_size_.resize(
+            num_partitions_,
+            std::min(size_t(config_.initial_items_per_partition_),
+                     num_buckets_per_partition_));
+
+        double limit_fill_rate = config_.limit_partition_fill_rate();
+
+        assert(limit_fill_rate >= 0.0 && limit_fill_rate <= 1.0
+               && "limit_partition_fill_rate must be between 0.0 and 1.0. "
+               "with a fill rate of 0.0, items are immediately flushed.");
+
+        limit_items_per_partition_.resize(
+            num_partitions_,
+            static_cast<size_t>(
+                static_cast<double>(partition_size_[0]) * limit_fill_rate));
+
+        items_ = static_cast<TableItem*>(
+            operator new (num_buckets_ * sizeof(TableItem)));
+
+        // the padding allows loading a whole group at the end of the table.
+        fingerprints_ = new uint8_t[num_buckets_ + Group::width];
+        std::fill(fingerprints_, fingerprints_ + num_buckets_ + Group::width,
+                  Group::empty);
+    }
+
+    ~ReduceFingerprintHashTable() {
+        if (items_) Dispose();
+    }
+
+    /*!
+     * Inserts a value into the table, potentially reducing it in case both the
+     * key of the value already in the table and the key of the value to be
+     * inserted are the same.
+     *
+     * An insert may trigger a resize of the partition in case the maximal fill
+     * ratio per partition is reached, or a spill or flush of it.
+     *
+     * \param kv Value to be inserted into the table.
+     *
+     * \return true if a new key was inserted to the table
+     */
+    bool Insert(const TableItem& kv) {
+        return Insert(kv, calculate_index(kv));
+    }
+
+    //! Prefetch the fingerprints and the home slot of an item with index h.
+    void Prefetch(const typename IndexFunction::Result& h) const {
+        size_t index = h.partition_id * num_buckets_per_partition_ +
+                       h.local_index(partition_size_[h.partition_id]);
+        common::prefetch(fingerprints_ + index);
+        common::prefetch(items_ + index);
+    }
+
+    //! Inserts a value whose index h was already calculated, e.g. by a
+    //! ReduceTableInsertBatch which prefetched its slot.
+    bool Insert(const TableItem& kv,
+                const typename IndexFunction::Result& h) {
+
+        assert(h.partition_id < num_partitions_);
+
+        const uint8_t fp = h.fingerprint();
+        const Key k = key(kv);
+
+        const size_t size = partition_size_[h.partition_id];
+        const size_t offset = h.partition_id * num_buckets_per_partition_;
+        TableItem* pitems = items_ + offset;
+        uint8_t* pfps = fingerprints_ + offset;
+
+        size_t pos = h.local_index(size);
+
+        for (size_t scanned = 0; ; )
+        {
+            // flush partition and retry, if all slots are reserved
+            if (TLX_UNLIKELY(scanned >= size)) {
+                GrowAndRehash(h.partition_id);
+                return Insert(kv, h);
+            }
+
+            size_t n = std::min(Group::width, size - pos);
+            Group group(pfps + pos);
+
+            Mask valid = Group::Valid(n);
+            Mask empty = group.MatchEmpty() & valid;
+            Mask match = group.Match(fp) & valid;
+
+            // the key can only reside before the first empty slot
+            if (empty) match &= (empty & (~empty + 1)) - 1;
+
+            for ( ; match; match &= match - 1) {
+                TableItem& slot = pitems[pos + Group::Lowest(match)];
+                if (key_equal_function_(key(slot), k)) {
+                    slot = reduce(slot, kv);
+                    return false;
+                }
+            }
+
+            if (empty) {
+                // insert new pair
+                size_t i = pos + Group::Lowest(empty);
+                new (pitems + i)TableItem(kv);
+                pfps[i] = fp;
+                break;
+            }
+
+            scanned += n;
+            pos += n;
+            // wrap around if beyond the current partition
+            if (pos == size) pos = 0;
+        }
+
+        // increase counter for partition
+        ++items_per_partition_[h.partition_id];
+        ++num_items_;
+
+        while (TLX_UNLIKELY(
+                   items_per_partition_[h.partition_id] >=
+                   limit_items_per_partition_[h.partition_id])) {
+            LOG << "Grow due to "
+                << items_per_partition_[h.partition_id] << " >= "
+                << limit_items_per_partition_[h.partition_id]
+                << " among " << partition_size_[h.partition_id];
+            GrowAndRehash(h.partition_id);
+        }
+
+        return true;
+    }
+
+    //! Deallocate items and memory
+    void Dispose() {
+        if (!items_) return;
+
+        // dispose the items by destructor
+
+        for (size_t i = 0; i < num_buckets_; ++i) {
+            if (fingerprints_[i] != Group::empty)
+                items_[i].~TableItem();
+        }
+
+        operator delete (items_);
+        items_ = nullptr;
+
+        delete[] fingerprints_;
+        fingerprints_ = nullptr;
+
+        Super::Dispose();
+    }
+
+    void GrowAndRehash(size_t partition_id) {
+
+        size_t old_size = partition_size_[partition_id];
+        GrowPartition(partition_id);
+        if (partition_size_[partition_id] == old_size) {
+            SpillPartition(partition_id);
+            return;
+        }
+
+        if (partition_size_[partition_id] % old_size != 0) {
+            // in place rehashing won't work properly so we spill rather than
+            // potentially blasting memory limits by using an extra vector for
+            // temporary item storage
+            SpillPartition(partition_id);
+            return;
+        }
+
+        // reinsert items of the old range in place until passing a hole
+        // beyond it - the second half is still empty
+        size_t offset = partition_id * num_buckets_per_partition_;
+        TableItem* pitems = items_ + offset;
+        uint8_t* pfps = fingerprints_ + offset;
+
+        bool passed_first_half = false;
+        bool found_hole = false;
+        for (size_t i = 0; !passed_first_half || !found_hole; ++i) {
+            bool is_empty = (pfps[i] == Group::empty);
+            if (!is_empty) {
+                --items_per_partition_[partition_id];
+                --num_items_;
+                TableItem item = std::move(pitems[i]);
+                pitems[i].~TableItem();
+                pfps[i] = Group::empty;
+                Insert(item);
+            }
+
+            found_hole = passed_first_half && is_empty;
+            passed_first_half = passed_first_half || i + 1 == old_size;
+        }
+    }
+
+    //! Grow a partition after a spill or flush (if possible)
+    void GrowPartition(size_t partition_id) {
+
+        if (TLX_UNLIKELY(mem::memory_exceeded)) {
+            SpillPartition(partition_id);
+            return;
+        }
+
+        if (partition_size_[partition_id] == num_buckets_per_partition_)
+            return;
+
+        size_t new_size = std::min(
+            num_buckets_per_partition_, 2 * partition_size_[partition_id]);
+
+        sLOG << "Growing partition" << partition_id
+             << "from" << partition_size_[partition_id] << "to" << new_size
+             << "limit_items" << new_size * config_.limit_partition_fill_rate();
+
+        // new slots are already marked empty.
+        partition_size_[partition_id] = new_size;
+        limit_items_per_partition_[partition_id]
+            = new_size * config_.limit_partition_fill_rate();
+    }
+
+    //! \name Spilling Mechanisms to External Memory Files
+    //! \{
+
+    //! Spill all items of a partition into an external memory File.
+    void SpillPartition(size_t partition_id) {
+
+        if (immediate_flush_) {
+            return FlushPartition(
+                partition_id, /* consume */ true, /* grow */ !mem::memory_exceeded);
+        }
+
+        LOG << "Spilling " << items_per_partition_[partition_id]
+            << " items of partition with id: " << partition_id;
+
+        if (items_per_partition_[partition_id] == 0)
+            return;
+
+        data::File::Writer writer = partition_files_[partition_id].GetWriter();
+
+        ForEachItem(partition_id, /* consume */ true,
+                    [&writer](const TableItem& p) { writer.Put(p); });
+
+        // reset partition specific counter
+        num_items_ -= items_per_partition_[partition_id];
+        items_per_partition_[partition_id] = 0;
+        assert(num_items_ == this->num_items_calc());
+
+        LOG << "Spilled items of partition with id: " << partition_id;
+    }
+
+    //! Spill all items of an arbitrary partition into an external memory File.
+    void SpillAnyPartition() {
+        // maybe make a policy later -tb
+        return SpillLargestPartition();
+    }
+
+    //! Spill all items of the largest partition into an external memory File.
+    void SpillLargestPartition() {
+        // get partition with max size
+        size_t size_max = 0, index = 0;
+
+        for (size_t i = 0; i < num_partitions_; ++i)
+        {
+            if (items_per_partition_[i] > size_max)
+            {
+                size_max = items_per_partition_[i];
+                index = i;
+            }
+        }
+
+        if (size_max == 0) {
+            return;
+        }
+
+        return SpillPartition(index);
+    }
+
+    //! \}
+
+    //! \name Flushing Mechanisms to Next Stage or Phase
+    //! \{
+
+    template <typename Emit>
+    void FlushPartitionEmit(
+        size_t partition_id, bool consume, bool grow, Emit emit) {
+
+        LOG << "Flushing " << items_per_partition_[partition_id]
+            << " items of partition: " << partition_id;
+
+        ForEachItem(partition_id, consume,
+                    [&emit, partition_id](const TableItem& p) {
+                        emit(partition_id, p);
+                    });
+
+        if (consume) {
+            // reset partition specific counter
+            num_items_ -= items_per_partition_[partition_id];
+            items_per_partition_[partition_id] = 0;
+            assert(num_items_ == this->num_items_calc());
+        }
+
+        LOG << "Done flushed items of partition: " << partition_id;
+
+        if (grow)
+            GrowPartition(partition_id);
+    }
+
+    void FlushPartition(size_t partition_id, bool consume, bool grow) {
+        FlushPartitionEmit(
+            partition_id, consume, grow,
+            [this](const size_t& partition_id, const TableItem& p) {
+                this->emitter_.Emit(partition_id, p);
+            });
+    }
+
+    void FlushAll() {
+        for (size_t i = 0; i < num_partitions_; ++i) {
+            FlushPartition(i, /* consume */ true, /* grow */ false);
+        }
+    }
+
+    //! \}
+
+public:
+    using Super::calculate_index;
+
+private:
+    using Super::config_;
+    using Super::immediate_flush_;
+    using Super::items_per_partition_;
+    using Super::key;
+    using Super::key_equal_function_;
+    using Super::limit_memory_bytes_;
+    using Super::num_buckets_;
+    using Super::num_buckets_per_partition_;
+    using Super::num_items_;
+    using Super::num_partitions_;
+    using Super::partition_files_;
+    using Super::reduce;
+
+    //! Storing the actual hash table, only slots with non-empty fingerprints
+    //! hold constructed items.
+    TableItem* items_ = nullptr;
+
+    //! One-byte fingerprint of each slot's item or FingerprintGroup::empty,
+    //! plus one group of padding.
+    uint8_t* fingerprints_ = nullptr;
+
+    //! Current sizes of the partitions because the valid allocated areas grow
+    std::vector<size_t> partition_size_;
+
+    //! Current limits on the number of items in a partitions, different for
+    //! different partitions, because the valid allocated areas grow.
+    std::vector<size_t> limit_items_per_partition_;
+
+    //! Call func for all items of a partition, scanning the fingerprints
+    //! group-wise, and remove them if consume is set.
+    template <typename Func>
+    void ForEachItem(size_t partition_id, bool consume, Func func) {
+        const size_t size = partition_size_[partition_id];
+        const size_t offset = partition_id * num_buckets_per_partition_;
+        TableItem* pitems = items_ + offset;
+        uint8_t* pfps = fingerprints_ + offset;
+
+        for (size_t pos = 0; pos < size; pos += Group::width) {
+            Group group(pfps + pos);
+            Mask full =
+                ~group.MatchEmpty() & Group::Valid(size - pos);
+
+            for ( ; full; full &= full - 1) {
+                size_t i = pos + Group::Lowest(full);
+                func(pitems[i]);
+                if (consume) {
+                    pitems[i].~TableItem();
+                    pfps[i] = Group::empty;
+                }
+            }
+        }
+    }
+};
+
+template <typename TableItem, typename Key, typename Value,
+          typename KeyExtractor, typename ReduceFunction,
+          typename Emitter, const bool VolatileKey,
+          typename ReduceConfig, typename IndexFunction,
+          typename KeyEqualFunction>
+class ReduceTableSelect<
+        ReduceTableImpl::FINGERPRINT,
+        TableItem, Key, Value, KeyExtractor, ReduceFunction,
+        Emitter, VolatileKey, ReduceConfig, IndexFunction, KeyEqualFunction>
+{
+public:
+    using type = ReduceFingerprintHashTable<
+              TableItem, Key, Value, KeyExtractor, ReduceFunction,
+              Emitter, VolatileKey, ReduceConfig,
+              IndexFunction, KeyEqualFunction>;
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_REDUCE_FINGERPRINT_HASH_TABLE_HEADER
+
+/******************************************************************************/
@@ -42,6 +42,13 @@ public:
         size_t local_index(size_t size) const {
             return remaining_hash % size;
         }
+
+        //! one-byte fingerprint with the highest bit set, mixed from all hash
+        //! bits by multiplicative hashing
+        uint8_t fingerprint() const {
+            return static_cast<uint8_t>(
+                0x80 | ((remaining_hash * 0x9E3779B97F4A7C15ull) >> 57));
+        }
     };
 
     explicit ReduceByHash(
@@ -98,6 +105,13 @@ public:
             return global_index % num_buckets_per_partition
                    * size / num_buckets_per_partition;
         }
+
+        //! one-byte fingerprint with the highest bit set, mixed from the
+        //! global index by multiplicative hashing
+        uint8_t fingerprint() const {
+            return static_cast<uint8_t>(
+                0x80 | ((global_index * 0x9E3779B97F4A7C15ull) >> 57));
+        }
     };
 
     explicit ReduceByIndex(const common::Range& range)
@@ -0,0 +1,312 @@
+/*******************************************************************************
+ * thrill/core/reduce_hot_keys.hpp
+ *
+ * Detection and local aggregation of heavy hitter keys for skew-aware reduce.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_REDUCE_HOT_KEYS_HEADER
+#define THRILL_CORE_REDUCE_HOT_KEYS_HEADER
+
+#include <thrill/common/logger.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Heavy hitter keys of a reduce, which are aggregated locally on each worker
+ * instead of being sent to the single worker owning the key.
+ *
+ * The first sample_size items are counted in a SpaceSaving sketch with
+ * capacity counters. Keys whose count reaches rate times the sample are locally
+ * hot: their items are aggregated in a small resident table, all others are
+ * reduced as usual. The local aggregates are candidates, which are merged over
+ * all workers (MergeCandidates) to agree on the globally hot keys
+ * (SetHotKeys). Partial aggregates of hot keys are collected from the local
+ * table and from the reduce output (Absorb), and finally combined over all
+ * workers (MergePartials).
+ */
+template <typename ValueType, typename Key,
+          typename KeyExtractor, typename ReduceFunction,
+          typename KeyHashFunction = std::hash<Key>,
+          typename KeyEqualFunction = std::equal_to<Key> >
+class ReduceHotKeys
+{
+    static constexpr bool debug = false;
+
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+public:
+    //! candidate hot key: a (partially reduced) item and its number of items
+    using Candidate = std::pair<ValueType, size_t>;
+
+    //! partial aggregate of a hot key: index into the hot keys and item
+    using Partial = std::pair<size_t, ValueType>;
+
+    using KeyMap = std::unordered_map<
+              Key, size_t, KeyHashFunction, KeyEqualFunction>;
+
+    ReduceHotKeys(const KeyExtractor& key_extractor,
+                  const ReduceFunction& reduce_function,
+                  size_t capacity, size_t sample_size, double rate,
+                  const KeyHashFunction& key_hash_function = KeyHashFunction(),
+                  const KeyEqualFunction& key_equal_function = KeyEqualFunction())
+        : key_extractor_(key_extractor), reduce_function_(reduce_function),
+          capacity_(std::max<size_t>(capacity, 1)), sample_size_(sample_size),
+          rate_(rate),
+          sketch_index_(capacity_, key_hash_function, key_equal_function),
+          local_(capacity_, key_hash_function, key_equal_function),
+          hot_(capacity_, key_hash_function, key_equal_function) { }
+
+    //! Counts an item and aggregates it if its key is locally hot. Returns
+    //! false if the item must be reduced as usual.
+    bool Insert(const ValueType& v) {
+        ++num_items_;
+        if (sampling_) {
+            Count(key_extractor_(v));
+            if (num_items_ >= sample_size_)
+                FinishSample();
+            return false;
+        }
+        if (local_.empty()) return false;
+
+        auto it = local_.find(key_extractor_(v));
+        if (it == local_.end()) return false;
+
+        if (it->second == npos) {
+            it->second = local_items_.size();
+            local_items_.emplace_back(v, 1);
+        }
+        else {
+            Candidate& c = local_items_[it->second];
+            c.first = reduce_function_(c.first, v);
+            ++c.second;
+        }
+        return true;
+    }
+
+    //! Returns the local candidates, which are the local aggregates.
+    const std::vector<Candidate>& candidates() {
+        if (sampling_) FinishSample();
+        return local_items_;
+    }
+
+    //! Merges two candidate lists by key, the order of a is kept and new keys
+    //! from b are appended. The result is limited to the capacity largest.
+    std::vector<Candidate> MergeCandidates(
+        const std::vector<Candidate>& a, const std::vector<Candidate>& b) const {
+        std::vector<Candidate> out = a;
+        KeyMap index(a.size() + b.size(),
+                     local_.hash_function(), local_.key_eq());
+        for (size_t i = 0; i < out.size(); ++i)
+            index.emplace(key_extractor_(out[i].first), i);
+
+        for (const Candidate& c : b) {
+            auto it = index.find(key_extractor_(c.first));
+            if (it == index.end()) {
+                index.emplace(key_extractor_(c.first), out.size());
+                out.push_back(c);
+            }
+            else {
+                out[it->second].second += c.second;
+            }
+        }
+
+        if (out.size() > capacity_) {
+            std::stable_sort(out.begin(), out.end(),
+                             [](const Candidate& x, const Candidate& y) {
+                                 return x.second > y.second;
+                             });
+            out.resize(capacity_);
+        }
+        return out;
+    }
+
+    /*!
+     * Selects the globally hot keys from the merged candidates, which are those
+     * with at least rate times total_items items. The local aggregates of all
+     * other keys are passed to emit_cold() to be reduced as usual.
+     */
+    template <typename EmitCold>
+    void SetHotKeys(const std::vector<Candidate>& global, size_t total_items,
+                    const EmitCold& emit_cold) {
+        for (const Candidate& c : global) {
+            if (static_cast<double>(c.second) <
+                rate_ * static_cast<double>(total_items)) continue;
+            hot_.emplace(key_extractor_(c.first), hot_items_.size());
+            hot_items_.push_back(c.first);
+        }
+        partial_index_.resize(hot_items_.size(), size_t(npos));
+
+        sLOG << "ReduceHotKeys: selected" << hot_items_.size() << "hot keys of"
+             << global.size() << "candidates and" << total_items << "items";
+
+        for (Candidate& c : local_items_) {
+            if (!Absorb(c.first))
+                emit_cold(c.first);
+        }
+
+        std::vector<Candidate>().swap(local_items_);
+        local_.clear();
+    }
+
+    //! Aggregates a partial result if its key is hot. Returns false if the key
+    //! is not hot.
+    bool Absorb(const ValueType& v) {
+        if (hot_.empty()) return false;
+
+        auto it = hot_.find(key_extractor_(v));
+        if (it == hot_.end()) return false;
+
+        if (!final_) {
+            size_t& pos = partial_index_[it->second];
+            if (pos == npos) {
+                pos = partials_.size();
+                partials_.emplace_back(it->second, v);
+            }
+            else {
+                partials_[pos].second =
+                    reduce_function_(partials_[pos].second, v);
+            }
+        }
+        return true;
+    }
+
+    //! Returns the partial aggregates sorted by hot key index, afterwards no
+    //! more partials are collected.
+    std::vector<Partial> TakePartials() {
+        final_ = true;
+        std::sort(partials_.begin(), partials_.end(),
+                  [](const Partial& a, const Partial& b) {
+                      return a.first < b.first;
+                  });
+        std::vector<Partial> out = std::move(partials_);
+        std::vector<Partial>().swap(partials_);
+        return out;
+    }
+
+    //! Merges two partial lists sorted by hot key index.
+    std::vector<Partial> MergePartials(
+        const std::vector<Partial>& a, const std::vector<Partial>& b) const {
+        std::vector<Partial> out;
+        out.reserve(a.size() + b.size());
+        auto ia = a.begin(), ib = b.begin();
+        while (ia != a.end() || ib != b.end()) {
+            if (ib == b.end() || (ia != a.end() && ia->first < ib->first))
+                out.push_back(*ia++);
+            else if (ia == a.end() || ib->first < ia->first)
+                out.push_back(*ib++);
+            else {
+                out.emplace_back(ia->first,
+                                 reduce_function_(ia->second, ib->second));
+                ++ia, ++ib;
+            }
+        }
+        return out;
+    }
+
+    //! Returns the representative items of the hot keys.
+    const std::vector<ValueType>& hot_items() const { return hot_items_; }
+
+    //! Returns the number of items counted.
+    size_t num_items() const { return num_items_; }
+
+private:
+    KeyExtractor key_extractor_;
+    ReduceFunction reduce_function_;
+
+    //! number of counters in the sketch and maximum number of hot keys
+    size_t capacity_;
+    //! number of items sampled
+    size_t sample_size_;
+    //! fraction of items a hot key has at least
+    double rate_;
+
+    //! number of items counted by Insert()
+    size_t num_items_ = 0;
+
+    //! \name SpaceSaving Sketch
+    //! \{
+
+    //! whether the sample is being counted
+    bool sampling_ = true;
+    //! counters of the sketch
+    std::vector<std::pair<Key, size_t> > counters_;
+    //! index of keys into counters_
+    KeyMap sketch_index_;
+
+    //! \}
+
+    //! locally hot keys mapped to index in local_items_, or npos if there is
+    //! no item yet
+    KeyMap local_;
+    //! local aggregates of locally hot keys
+    std::vector<Candidate> local_items_;
+
+    //! globally hot keys mapped to index in hot_items_
+    KeyMap hot_;
+    //! representative items of globally hot keys
+    std::vector<ValueType> hot_items_;
+
+    //! partial aggregates of hot keys
+    std::vector<Partial> partials_;
+    //! index of hot keys into partials_, or npos
+    std::vector<size_t> partial_index_;
+    //! whether the partials were taken
+    bool final_ = false;
+
+    //! count key in SpaceSaving sketch: replace the minimum counter if full.
+    void Count(const Key& k) {
+        auto it = sketch_index_.find(k);
+        if (it != sketch_index_.end()) {
+            ++counters_[it->second].second;
+            return;
+        }
+        if (counters_.size() < capacity_) {
+            sketch_index_.emplace(k, counters_.size());
+            counters_.emplace_back(k, 1);
+            return;
+        }
+        size_t min = 0;
+        for (size_t i = 1; i < counters_.size(); ++i) {
+            if (counters_[i].second < counters_[min].second) min = i;
+        }
+        sketch_index_.erase(counters_[min].first);
+        sketch_index_.emplace(k, min);
+        counters_[min].first = k;
+        ++counters_[min].second;
+    }
+
+    //! select locally hot keys from the sketch
+    void FinishSample() {
+        sampling_ = false;
+        for (const std::pair<Key, size_t>& c : counters_) {
+            if (static_cast<double>(c.second) >=
+                rate_ * static_cast<double>(num_items_))
+                local_.emplace(c.first, size_t(npos));
+        }
+        sLOG << "ReduceHotKeys: sampled" << num_items_ << "items, found"
+             << local_.size() << "locally hot keys";
+
+        std::vector<std::pair<Key, size_t> >().swap(counters_);
+        sketch_index_.clear();
+    }
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_REDUCE_HOT_KEYS_HEADER
+
+/******************************************************************************/
@@ -0,0 +1,193 @@
+/*******************************************************************************
+ * thrill/core/reduce_memory_budget.hpp
+ *
+ * Memory budget shared by the reduce tables of concurrently running phases.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_REDUCE_MEMORY_BUDGET_HEADER
+#define THRILL_CORE_REDUCE_MEMORY_BUDGET_HEADER
+
+#include <thrill/common/logger.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Memory budget shared by the reduce tables of phases which run at the same
+ * time, e.g. the pre and post phase of a ReduceNode with a post thread.
+ *
+ * Each table is an account, which acquires the memory of a partition from the
+ * budget before growing it. Every account is guaranteed a reserve of
+ * reserve_rate times the budget, the rest is granted to whichever table fills
+ * its partitions first. A denied request is a spill event of its table: it
+ * puts the other accounts under pressure, which then release the memory of
+ * partitions emptied by a flush or spill, until the starved table grew again.
+ * Hence the memory follows the phase which currently receives the most new
+ * keys, instead of being split in fixed halves.
+ *
+ * The budget is locked by a mutex, since the phases run in different threads.
+ * Tables acquire memory only when doubling a partition, hence rarely.
+ */
+class ReduceMemoryBudget
+{
+    static constexpr bool debug = false;
+
+public:
+    ReduceMemoryBudget(size_t num_accounts, double reserve_rate)
+        : reserve_rate_(reserve_rate),
+          held_(num_accounts, 0), denied_(num_accounts, 0),
+          pressure_(num_accounts, false) {
+        assert(num_accounts > 0);
+        assert(reserve_rate >= 0.0 &&
+               reserve_rate * static_cast<double>(num_accounts) <= 1.0 &&
+               "the reserves of all accounts must fit into the budget");
+    }
+
+    //! non-copyable: delete copy-constructor
+    ReduceMemoryBudget(const ReduceMemoryBudget&) = delete;
+    //! non-copyable: delete assignment operator
+    ReduceMemoryBudget& operator = (const ReduceMemoryBudget&) = delete;
+
+    //! Sets the total size of the budget. Must be called before the tables
+    //! acquire memory.
+    void Initialize(size_t limit_bytes) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        limit_bytes_ = limit_bytes;
+        reserve_bytes_ = static_cast<size_t>(
+            static_cast<double>(limit_bytes) * reserve_rate_);
+    }
+
+    //! Returns the maximum memory a single account can hold, which is the
+    //! budget minus the reserves of all other accounts.
+    size_t max_account_bytes() const {
+        return limit_bytes_ - (held_.size() - 1) * reserve_bytes_;
+    }
+
+    /*!
+     * Acquires bytes for account. The request is granted if it fits into the
+     * account's reserve, or into the budget minus the unused reserves of the
+     * other accounts. Otherwise, the other accounts are put under pressure to
+     * release memory.
+     */
+    bool Acquire(size_t account, size_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        assert(account < held_.size());
+
+        size_t other_reserves = 0;
+        for (size_t a = 0; a < held_.size(); ++a) {
+            if (a != account && held_[a] < reserve_bytes_)
+                other_reserves += reserve_bytes_ - held_[a];
+        }
+
+        if (held_[account] + bytes > reserve_bytes_ &&
+            used_bytes_ + other_reserves + bytes > limit_bytes_)
+        {
+            sLOG << "ReduceMemoryBudget: denied" << bytes << "bytes"
+                 << "to account" << account << "holding" << held_[account]
+                 << "used" << used_bytes_ << "of" << limit_bytes_;
+
+            ++denied_[account];
+            for (size_t a = 0; a < held_.size(); ++a)
+                pressure_[a] = pressure_[a] || (a != account);
+            return false;
+        }
+
+        held_[account] += bytes;
+        used_bytes_ += bytes;
+        return true;
+    }
+
+    //! Acquires bytes for account even if they exceed the budget, e.g. for the
+    //! initial minimum partitions of a table.
+    void Force(size_t account, size_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        assert(account < held_.size());
+        held_[account] += bytes;
+        used_bytes_ += bytes;
+    }
+
+    //! Releases bytes of account, which relieves its pressure.
+    void Release(size_t account, size_t bytes) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        assert(account < held_.size());
+        assert(held_[account] >= bytes);
+        held_[account] -= bytes;
+        used_bytes_ -= bytes;
+        pressure_[account] = false;
+    }
+
+    //! Returns whether another account was denied memory since account last
+    //! released some.
+    bool pressure(size_t account) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return pressure_[account];
+    }
+
+    //! \name Accessors
+    //! \{
+
+    //! Returns limit_bytes_
+    size_t limit_bytes() const { return limit_bytes_; }
+
+    //! Returns the number of bytes currently held by all accounts.
+    size_t used_bytes() const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return used_bytes_;
+    }
+
+    //! Returns the number of bytes currently held by account.
+    size_t held_bytes(size_t account) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return held_[account];
+    }
+
+    //! Returns the number of requests of account which were denied.
+    size_t num_denied(size_t account) const {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return denied_[account];
+    }
+
+    //! \}
+
+private:
+    //! fraction of the budget reserved for each account
+    double reserve_rate_;
+
+    //! total size of the budget
+    size_t limit_bytes_ = 0;
+
+    //! bytes reserved for each account
+    size_t reserve_bytes_ = 0;
+
+    //! bytes currently held by all accounts
+    size_t used_bytes_ = 0;
+
+    //! bytes currently held by each account
+    std::vector<size_t> held_;
+
+    //! number of denied requests of each account
+    std::vector<size_t> denied_;
+
+    //! whether each account should release memory for another one
+    std::vector<bool> pressure_;
+
+    //! lock for all members, the tables run in different threads
+    mutable std::mutex mutex_;
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_REDUCE_MEMORY_BUDGET_HEADER
+
+/******************************************************************************/
@@ -20,8 +20,12 @@
 #include <thrill/common/logger.hpp>
 #include <thrill/common/math.hpp>
 #include <thrill/core/duplicate_detection.hpp>
+#include <thrill/core/reduce_adaptive_hash_table.hpp>
+#include <thrill/core/reduce_arena_hash_table.hpp>
 #include <thrill/core/reduce_bucket_hash_table.hpp>
+#include <thrill/core/reduce_fingerprint_hash_table.hpp>
 #include <thrill/core/reduce_functional.hpp>
+#include <thrill/core/reduce_memory_budget.hpp>
 #include <thrill/core/reduce_old_probing_hash_table.hpp>
 #include <thrill/core/reduce_probing_hash_table.hpp>
 #include <thrill/data/block_reader.hpp>
@@ -55,14 +59,27 @@ public:
     //! output an element into a partition, template specialized for robust and
     //! non-robust keys
     void Emit(const size_t& partition_id, const TableItem& p) {
-        assert(partition_id < writer_.size());
-        stats_[partition_id]++;
-        writer_[partition_id].Put(p);
+        size_t w = writer_of(partition_id);
+        assert(w < writer_.size());
+        stats_[w]++;
+        writer_[w].Put(p);
     }
 
     void Flush(size_t partition_id) {
-        assert(partition_id < writer_.size());
-        writer_[partition_id].Flush();
+        size_t w = writer_of(partition_id);
+        assert(w < writer_.size());
+        writer_[w].Flush();
+    }
+
+    //! Map partitions to writers, e.g. to send several partitions to the same
+    //! worker. An empty map sends partition i to writer i.
+    void SetWriterMap(std::vector<size_t> writer_map) {
+        writer_map_ = std::move(writer_map);
+    }
+
+    //! Returns the writer of a partition
+    size_t writer_of(size_t partition_id) const {
+        return writer_map_.empty() ? partition_id : writer_map_[partition_id];
     }
 
     void CloseAll() {
@@ -80,6 +97,9 @@ public:
 
     //! Emitter stats.
     std::vector<size_t> stats_;
+
+    //! Optional map of partitions to writers.
+    std::vector<size_t> writer_map_;
 };
 
 template <typename TableItem, typename Key, typename Value,
@@ -142,7 +162,9 @@ public:
           table_(ctx, dia_id,
                  key_extractor, reduce_function, emit_,
                  num_partitions, config, !duplicates,
-                 index_function, key_equal_function) {
+                 index_function, key_equal_function),
+          batch_(table_),
+          bypass_new_key_rate_(config.bypass_new_key_rate()) {
 
         tlx::unused(hash_function);
 
@@ -156,6 +178,12 @@ public:
     //! non-copyable: delete assignment operator
     ReducePrePhase& operator = (const ReducePrePhase&) = delete;
 
+    //! Shares the memory of the table with other tables, see
+    //! ReduceTable::SetMemoryBudget().
+    void SetMemoryBudget(ReduceMemoryBudget* budget, size_t account) {
+        table_.SetMemoryBudget(budget, account);
+    }
+
     void Initialize(size_t limit_memory_bytes) {
         table_.Initialize(limit_memory_bytes);
     }
@@ -169,6 +197,61 @@ public:
         return table_.Insert(MakeTableItem::Make(v, table_.key_extractor()));
     }
 
+    //! Inserts a value via a ReduceTableInsertBatch, which prefetches the
+    //! table slots of a batch of items before inserting them. The batch is
+    //! inserted at the latest by FlushAll(). Returns the number of new keys
+    //! inserted into the table.
+    size_t InsertBatched(const Value& v) {
+        if (ReduceConfig::insert_batch_size_ <= 1)
+            return Insert(v);
+        return batch_.Insert(MakeTableItem::Make(v, table_.key_extractor()));
+    }
+
+    /*!
+     * Inserts a value with adaptive pre-aggregation. The fraction of new keys
+     * among a sample of bypass_sample_size_ items is measured. If it exceeds
+     * bypass_new_key_rate, the table does not reduce enough to pay off, and
+     * the next bypass_skip_size_ items are emitted directly via InsertSkip().
+     * Afterwards another sample is taken, hence the table is used again when
+     * the rate of duplicate keys improves.
+     */
+    void InsertAdaptive(const Value& v) {
+        if (ReduceConfig::bypass_sample_size_ == 0) {
+            InsertBatched(v);
+            return;
+        }
+
+        if (bypass_) {
+            InsertSkip(v);
+            ++num_bypassed_;
+            if (++sample_items_ >= ReduceConfig::bypass_skip_size_) {
+                bypass_ = false;
+                sample_items_ = sample_new_keys_ = 0;
+            }
+            return;
+        }
+
+        sample_new_keys_ += InsertBatched(v);
+        if (++sample_items_ >= ReduceConfig::bypass_sample_size_) {
+            sample_new_keys_ += batch_.Flush();
+            bypass_ = sample_new_keys_ >
+                      bypass_new_key_rate_ * static_cast<double>(sample_items_);
+            sLOG << "ReducePrePhase: sampled" << sample_new_keys_
+                 << "new keys in" << sample_items_ << "items, bypass" << bypass_;
+            sample_items_ = sample_new_keys_ = 0;
+        }
+    }
+
+    //! Inserts an item which already is a TableItem, e.g. one received from
+    //! the pre phase of another worker. The batch is inserted at the latest by
+    //! FlushAll().
+    void InsertTableItem(const TableItem& t) {
+        if (ReduceConfig::insert_batch_size_ <= 1)
+            table_.Insert(t);
+        else
+            batch_.Insert(t);
+    }
+
     void InsertSkip(const Value& v) {
         TableItem t = MakeTableItem::Make(v, table_.key_extractor());
         typename IndexFunction::Result h = table_.calculate_index(t);
@@ -177,6 +260,8 @@ public:
 
     //! Flush all partitions
     void FlushAll() {
+        batch_.Flush();
+        sLOG << "ReducePrePhase: bypassed table with" << num_bypassed_ << "items";
         for (size_t id = 0; id < table_.num_partitions(); ++id) {
             FlushPartition(id, /* consume */ true, /* grow */ false);
         }
@@ -188,6 +273,11 @@ public:
         // data is flushed immediately, there is no spilled data
     }
 
+    //! Map partitions to output writers, see ReducePrePhaseEmitter.
+    void SetWriterMap(std::vector<size_t> writer_map) {
+        emit_.SetWriterMap(std::move(writer_map));
+    }
+
     //! Closes all emitter
     void CloseAll() {
         emit_.CloseAll();
@@ -200,6 +290,18 @@ public:
     //! Returns the total num of items in the table.
     size_t num_items() const { return table_.num_items(); }
 
+    //! Returns the partition a value is emitted to.
+    size_t partition_id(const Value& v) const {
+        return table_.calculate_index(
+            MakeTableItem::Make(v, table_.key_extractor())).partition_id;
+    }
+
+    //! Returns whether InsertAdaptive() currently bypasses the table.
+    bool bypass() const { return bypass_; }
+
+    //! Returns the number of items InsertAdaptive() emitted directly.
+    size_t num_bypassed() const { return num_bypassed_; }
+
     //! calculate key range for the given output partition
     common::Range key_range(size_t partition_id)
     { return table_.key_range(partition_id); }
@@ -215,6 +317,29 @@ protected:
 
     //! the first-level hash table implementation
     Table table_;
+
+    //! batch buffer for InsertBatched()
+    ReduceTableInsertBatch<Table, ReduceConfig::insert_batch_size_> batch_;
+
+    //! \name Adaptive Pre-Aggregation
+    //! \{
+
+    //! rate of new keys in a sample above which the table is bypassed
+    double bypass_new_key_rate_;
+
+    //! whether the table is currently bypassed
+    bool bypass_ = false;
+
+    //! items in the current sample or bypass round
+    size_t sample_items_ = 0;
+
+    //! new keys inserted in the current sample
+    size_t sample_new_keys_ = 0;
+
+    //! total number of items emitted directly
+    size_t num_bypassed_ = 0;
+
+    //! \}
 };
 
 template <typename TableItem, typename Key, typename Value,
@@ -275,6 +400,19 @@ public:
         }
     }
 
+    //! Duplicate detection records the hashes of new keys, hence inserts are
+    //! not batched.
+    size_t InsertBatched(const Value& v) {
+        Insert(v);
+        return 0;
+    }
+
+    //! Duplicate detection needs all keys in the table, hence it is never
+    //! bypassed.
+    void InsertAdaptive(const Value& v) {
+        Insert(v);
+    }
+
     //! Flush all partitions
     void FlushAll() {
         DuplicateDetection dup_detect;
@@ -108,7 +108,7 @@ public:
     //! Construct the hash table itself. fill it with sentinels. have one extra
     //! cell beyond the end for reducing the sentinel itself.
     void Initialize(size_t limit_memory_bytes) {
-        assert(!items_);
+        assert(!sentinel_);
 
         limit_memory_bytes_ = limit_memory_bytes;
 
@@ -151,14 +151,41 @@ public:
 
         assert(limit_items_per_partition_[0] >= 0);
 
-        // actually allocate the table and initialize the valid ranges, the + 1
-        // is for the sentinel's slot.
+        // the initial partitions are always granted by a shared budget.
+        if (budget_) {
+            budget_->Force(
+                budget_account_,
+                num_partitions_ * partition_size_[0] * sizeof(TableItem));
+        }
 
-        items_ = static_cast<TableItem*>(
-            operator new ((num_buckets_ + 1) * sizeof(TableItem)));
+        // actually allocate the table and initialize the valid ranges, the + 1
+        // is for the sentinel's slot. With a shared budget, each partition is
+        // allocated separately with its current size, such that the tables
+        // sharing the budget only allocate the memory granted by it.
+
+        separate_partitions_ = (budget_ != nullptr);
+
+        if (!separate_partitions_) {
+            items_ = static_cast<TableItem*>(
+                operator new ((num_buckets_ + 1) * sizeof(TableItem)));
+            sentinel_ = items_ + num_buckets_;
+            for (size_t id = 0; id < num_partitions_; ++id) {
+                partition_items_.push_back(
+                    items_ + id * num_buckets_per_partition_);
+            }
+        }
+        else {
+            sentinel_ = static_cast<TableItem*>(
+                operator new (sizeof(TableItem)));
+            for (size_t id = 0; id < num_partitions_; ++id) {
+                partition_items_.push_back(
+                    static_cast<TableItem*>(
+                        operator new (partition_size_[id] * sizeof(TableItem))));
+            }
+        }
 
         for (size_t id = 0; id < num_partitions_; ++id) {
-            TableItem* iter = items_ + id * num_buckets_per_partition_;
+            TableItem* iter = partition_items_[id];
             TableItem* pend = iter + partition_size_[id];
 
             for ( ; iter != pend; ++iter)
@@ -167,7 +194,7 @@ public:
     }
 
     ~ReduceProbingHashTable() {
-        if (items_) Dispose();
+        if (sentinel_) Dispose();
     }
 
     /*!
@@ -187,14 +214,27 @@ public:
      * \return true if a new key was inserted to the table
      */
     bool Insert(const TableItem& kv) {
+        return Insert(kv, calculate_index(kv));
+    }
+
+    //! Prefetch the home slot of an item with index h.
+    void Prefetch(const typename IndexFunction::Result& h) const {
+        common::prefetch(
+            partition_items_[h.partition_id] +
+            h.local_index(partition_size_[h.partition_id]));
+    }
+
+    //! Inserts a value whose index h was already calculated, e.g. by a
+    //! ReduceTableInsertBatch which prefetched its slot.
+    bool Insert(const TableItem& kv,
+                const typename IndexFunction::Result& h) {
 
-        typename IndexFunction::Result h = calculate_index(kv);
         assert(h.partition_id < num_partitions_);
 
         if (TLX_UNLIKELY(key_equal_function_(key(kv), Key()))) {
             // handle pairs with sentinel key specially by reducing into last
             // element of items.
-            TableItem& sentinel = items_[num_buckets_];
+            TableItem& sentinel = *sentinel_;
             if (sentinel_partition_ == invalid_partition_) {
                 // first occurrence of sentinel key
                 new (&sentinel)TableItem(kv);
@@ -219,7 +259,7 @@ public:
         // calculate local index depending on the current subtable's size
         size_t local_index = h.local_index(partition_size_[h.partition_id]);
 
-        TableItem* pbegin = items_ + h.partition_id * num_buckets_per_partition_;
+        TableItem* pbegin = partition_items_[h.partition_id];
         TableItem* pend = pbegin + partition_size_[h.partition_id];
 
         TableItem* begin_iter = pbegin + local_index;
@@ -242,7 +282,7 @@ public:
             // flush partition and retry, if all slots are reserved
             if (TLX_UNLIKELY(iter == begin_iter)) {
                 GrowAndRehash(h.partition_id);
-                return Insert(kv);
+                return Insert(kv, h);
             }
         }
 
@@ -268,23 +308,41 @@ public:
 
     //! Deallocate items and memory
     void Dispose() {
-        if (!items_) return;
+        if (!sentinel_) return;
 
         // dispose the items by destructor
 
         for (size_t id = 0; id < num_partitions_; ++id) {
-            TableItem* iter = items_ + id * num_buckets_per_partition_;
+            TableItem* iter = partition_items_[id];
             TableItem* pend = iter + partition_size_[id];
 
             for ( ; iter != pend; ++iter)
                 iter->~TableItem();
         }
 
-        if (sentinel_partition_ != invalid_partition_)
-            items_[num_buckets_].~TableItem();
+        if (sentinel_partition_ != invalid_partition_) {
+            sentinel_->~TableItem();
+            sentinel_partition_ = invalid_partition_;
+        }
+
+        if (budget_) {
+            size_t bytes = 0;
+            for (size_t id = 0; id < num_partitions_; ++id)
+                bytes += partition_size_[id] * sizeof(TableItem);
+            budget_->Release(budget_account_, bytes);
+        }
 
-        operator delete (items_);
+        if (separate_partitions_) {
+            for (size_t id = 0; id < num_partitions_; ++id)
+                operator delete (partition_items_[id]);
+            operator delete (sentinel_);
+        }
+        else {
+            operator delete (items_);
+        }
         items_ = nullptr;
+        sentinel_ = nullptr;
+        std::vector<TableItem*>().swap(partition_items_);
 
         Super::Dispose();
     }
@@ -307,8 +365,7 @@ public:
         }
 
         // initialize pointers to old range - the second half is still empty
-        TableItem* pbegin =
-            items_ + partition_id * num_buckets_per_partition_;
+        TableItem* pbegin = partition_items_[partition_id];
         TableItem* iter = pbegin;
         TableItem* pend = pbegin + old_size;
 
@@ -345,14 +402,22 @@ public:
         size_t new_size = std::min(
             num_buckets_per_partition_, 2 * partition_size_[partition_id]);
 
+        // a denied budget leaves the partition as is, which is then spilled.
+        if (budget_ && !budget_->Acquire(
+                budget_account_,
+                (new_size - partition_size_[partition_id]) * sizeof(TableItem)))
+            return;
+
         sLOG << "Growing partition" << partition_id
              << "from" << partition_size_[partition_id] << "to" << new_size
              << "limit_items" << new_size * config_.limit_partition_fill_rate();
 
+        if (separate_partitions_)
+            ReallocatePartition(partition_id, new_size);
+
         // initialize new items
 
-        TableItem* pbegin =
-            items_ + partition_id * num_buckets_per_partition_;
+        TableItem* pbegin = partition_items_[partition_id];
         TableItem* iter = pbegin + partition_size_[partition_id];
         TableItem* pend = pbegin + new_size;
 
@@ -364,6 +429,43 @@ public:
             = new_size * config_.limit_partition_fill_rate();
     }
 
+    //! Shrink an empty partition to its initial size if another table sharing
+    //! the memory budget was denied memory. Returns true if it was shrunk.
+    bool ShrinkPartition(size_t partition_id) {
+        assert(items_per_partition_[partition_id] == 0);
+
+        if (!separate_partitions_ || !budget_->pressure(budget_account_))
+            return false;
+
+        size_t initial_size = std::min(
+            size_t(config_.initial_items_per_partition_),
+            num_buckets_per_partition_);
+
+        if (partition_size_[partition_id] <= initial_size)
+            return false;
+
+        sLOG << "Shrinking partition" << partition_id
+             << "from" << partition_size_[partition_id] << "to" << initial_size;
+
+        TableItem* pbegin = partition_items_[partition_id];
+        TableItem* iter = pbegin + initial_size;
+        TableItem* pend = pbegin + partition_size_[partition_id];
+
+        for ( ; iter != pend; ++iter)
+            iter->~TableItem();
+
+        ReallocatePartition(partition_id, initial_size);
+
+        budget_->Release(
+            budget_account_,
+            (partition_size_[partition_id] - initial_size) * sizeof(TableItem));
+
+        partition_size_[partition_id] = initial_size;
+        limit_items_per_partition_[partition_id]
+            = initial_size * config_.limit_partition_fill_rate();
+        return true;
+    }
+
     //! \name Spilling Mechanisms to External Memory Files
     //! \{
 
@@ -384,12 +486,12 @@ public:
         data::File::Writer writer = partition_files_[partition_id].GetWriter();
 
         if (sentinel_partition_ == partition_id) {
-            writer.Put(items_[num_buckets_]);
-            items_[num_buckets_].~TableItem();
+            writer.Put(*sentinel_);
+            sentinel_->~TableItem();
             sentinel_partition_ = invalid_partition_;
         }
 
-        TableItem* iter = items_ + partition_id * num_buckets_per_partition_;
+        TableItem* iter = partition_items_[partition_id];
         TableItem* pend = iter + partition_size_[partition_id];
 
         for ( ; iter != pend; ++iter) {
@@ -404,6 +506,8 @@ public:
         items_per_partition_[partition_id] = 0;
         assert(num_items_ == this->num_items_calc());
 
+        ShrinkPartition(partition_id);
+
         LOG << "Spilled items of partition with id: " << partition_id;
     }
 
@@ -447,14 +551,14 @@ public:
             << " items of partition: " << partition_id;
 
         if (sentinel_partition_ == partition_id) {
-            emit(partition_id, items_[num_buckets_]);
+            emit(partition_id, *sentinel_);
             if (consume) {
-                items_[num_buckets_].~TableItem();
+                sentinel_->~TableItem();
                 sentinel_partition_ = invalid_partition_;
             }
         }
 
-        TableItem* iter = items_ + partition_id * num_buckets_per_partition_;
+        TableItem* iter = partition_items_[partition_id];
         TableItem* pend = iter + partition_size_[partition_id];
 
         for ( ; iter != pend; ++iter)
@@ -472,6 +576,10 @@ public:
             num_items_ -= items_per_partition_[partition_id];
             items_per_partition_[partition_id] = 0;
             assert(num_items_ == this->num_items_calc());
+
+            // leave the memory to the table which needs it.
+            if (ShrinkPartition(partition_id))
+                grow = false;
         }
 
         LOG << "Done flushed items of partition: " << partition_id;
@@ -500,6 +608,8 @@ public:
     using Super::calculate_index;
 
 private:
+    using Super::budget_;
+    using Super::budget_account_;
     using Super::config_;
     using Super::immediate_flush_;
     using Super::index_function_;
@@ -514,9 +624,20 @@ private:
     using Super::partition_files_;
     using Super::reduce;
 
-    //! Storing the actual hash table.
+    //! Storing the actual hash table, if the partitions are not allocated
+    //! separately.
     TableItem* items_ = nullptr;
 
+    //! Begin of the slots of each partition.
+    std::vector<TableItem*> partition_items_;
+
+    //! Slot of the sentinel key's item.
+    TableItem* sentinel_ = nullptr;
+
+    //! Whether each partition is allocated separately with its current size,
+    //! which is done if the table uses a shared memory budget.
+    bool separate_partitions_ = false;
+
     //! Current sizes of the partitions because the valid allocated areas grow
     std::vector<size_t> partition_size_;
 
@@ -528,9 +649,28 @@ private:
     static constexpr size_t invalid_partition_ = size_t(-1);
 
     //! store the partition id of the sentinel key. implicitly this also stored
-    //! whether the sentinel key was found and reduced into
-    //! items_[num_buckets_].
+    //! whether the sentinel key was found and reduced into *sentinel_.
     size_t sentinel_partition_ = invalid_partition_;
+
+    //! Move the constructed slots of a separately allocated partition into a
+    //! new allocation of size slots, for growing or shrinking it.
+    void ReallocatePartition(size_t partition_id, size_t size) {
+        assert(separate_partitions_);
+
+        TableItem* old_items = partition_items_[partition_id];
+        size_t num_moved = std::min(size, partition_size_[partition_id]);
+
+        TableItem* new_items = static_cast<TableItem*>(
+            operator new (size * sizeof(TableItem)));
+
+        for (size_t i = 0; i < num_moved; ++i) {
+            new (new_items + i)TableItem(std::move(old_items[i]));
+            old_items[i].~TableItem();
+        }
+
+        operator delete (old_items);
+        partition_items_[partition_id] = new_items;
+    }
 };
 
 template <typename TableItem, typename Key, typename Value,
@@ -14,7 +14,9 @@
 #define THRILL_CORE_REDUCE_TABLE_HEADER
 
 #include <thrill/api/context.hpp>
+#include <thrill/common/defines.hpp>
 #include <thrill/core/reduce_functional.hpp>
+#include <thrill/core/reduce_memory_budget.hpp>
 
 #include <algorithm>
 #include <functional>
@@ -27,7 +29,7 @@ namespace core {
 
 //! Enum class to select a hash table implementation.
 enum class ReduceTableImpl {
-    PROBING, OLD_PROBING, BUCKET
+    PROBING, OLD_PROBING, BUCKET, FINGERPRINT, ARENA, ADAPTIVE
 };
 
 /*!
@@ -56,6 +58,10 @@ public:
     //! (must be a static constexpr)
     static constexpr size_t bucket_block_size_ = 512;
 
+    //! only for AdaptiveHashTable: number of items inserted before selecting
+    //! the probing or bucket table.
+    static constexpr size_t calibration_items_ = 16384;
+
     //! use MixStream instead of CatStream in ReduceNodes: this makes the order
     //! of items delivered in the ReduceFunction arbitrary.
     static constexpr bool use_mix_stream_ = true;
@@ -64,6 +70,54 @@ public:
     //! the pre and post phases simultaneously.
     static constexpr bool use_post_thread_ = true;
 
+    //! number of items collected by batched inserts into reduce tables: the
+    //! slots of a whole batch are prefetched before inserting it. 1 disables
+    //! batching.
+    static constexpr size_t insert_batch_size_ = 16;
+
+    //! only for ReduceNode: number of items sampled in the pre phase to decide
+    //! whether pre-aggregation pays off. 0 disables the adaptive bypass.
+    static constexpr size_t bypass_sample_size_ = 16384;
+
+    //! only for ReduceNode: number of items emitted directly while the pre
+    //! phase table is bypassed, before sampling again.
+    static constexpr size_t bypass_skip_size_ = 16 * bypass_sample_size_;
+
+    //! only for ReduceNode: the pre phase table is bypassed if the fraction of
+    //! new keys among the sampled items exceeds this rate.
+    double bypass_new_key_rate_ = 0.95;
+
+    //! only for ReduceNode: detect heavy hitter keys in the pre phase and
+    //! aggregate them locally on all workers, instead of sending all their
+    //! items to a single worker.
+    static constexpr bool use_hot_keys_ = false;
+
+    //! only for ReduceNode with use_hot_keys_: number of counters in the
+    //! SpaceSaving sketch, which is also the maximum number of hot keys.
+    static constexpr size_t hot_key_capacity_ = 64;
+
+    //! only for ReduceNode with use_hot_keys_: number of items sampled in the
+    //! sketch to detect locally hot keys.
+    static constexpr size_t hot_key_sample_size_ = 16384;
+
+    //! only for ReduceNode with use_hot_keys_: fraction of all items a key
+    //! must have to be hot.
+    double hot_key_rate_ = 0.01;
+
+    //! only for ReduceNode: if there are multiple hosts and workers per host,
+    //! send the pre phase output to a local worker first, which combines the
+    //! items of all its host's workers, and only then to the remote workers.
+    static constexpr bool use_host_combine_ = false;
+
+    //! only for ReduceNode with use_post_thread_ and ProbingHashTable: the pre
+    //! and post phase tables grow their partitions from one shared memory
+    //! budget, instead of getting half of the memory each.
+    static constexpr bool use_shared_memory_budget_ = false;
+
+    //! only for ReduceNode with use_shared_memory_budget_: fraction of the
+    //! memory reserved for each of the pre and post phase tables.
+    double memory_reserve_rate_ = 0.25;
+
     //! \name Accessors
     //! \{
 
@@ -74,6 +128,15 @@ public:
     //! Returns bucket_rate_
     double bucket_rate() const { return bucket_rate_; }
 
+    //! Returns bypass_new_key_rate_
+    double bypass_new_key_rate() const { return bypass_new_key_rate_; }
+
+    //! Returns hot_key_rate_
+    double hot_key_rate() const { return hot_key_rate_; }
+
+    //! Returns memory_reserve_rate_
+    double memory_reserve_rate() const { return memory_reserve_rate_; }
+
     //! \}
 };
 
@@ -162,6 +225,19 @@ public:
         assert(num_buckets_ > 0);
     }
 
+    /*!
+     * Lets the table acquire the memory of its partitions from a budget shared
+     * with other tables, as account. Must be called before Initialize(), whose
+     * limit is then the maximum size of the table. Only the ProbingHashTable,
+     * which grows its partitions, uses the budget. It then allocates each
+     * partition separately with its current size, hence the tables sharing the
+     * budget allocate only the memory granted by it.
+     */
+    void SetMemoryBudget(ReduceMemoryBudget* budget, size_t account) {
+        budget_ = budget;
+        budget_account_ = account;
+    }
+
     //! \name Accessors
     //! \{
 
@@ -320,6 +396,12 @@ protected:
     //! next phase.
     bool immediate_flush_;
 
+    //! Memory budget shared with other tables, or nullptr.
+    ReduceMemoryBudget* budget_ = nullptr;
+
+    //! Account of this table in budget_.
+    size_t budget_account_ = 0;
+
     //! \}
 
     //! \name Current Statistical Parameters
@@ -345,6 +427,72 @@ template <ReduceTableImpl ImplSelect,
           typename KeyEqualFunction = std::equal_to<Key> >
 class ReduceTableSelect;
 
+/*!
+ * Buffer for batched inserts into a reduce table. Items are collected until
+ * the batch is full, then the indexes of all items are calculated and their
+ * slots prefetched via Table::Prefetch(), and only then are they inserted. For
+ * tables much larger than the cache this overlaps the cache misses of a whole
+ * batch instead of stalling on each insert.
+ */
+template <typename Table, size_t BatchSize>
+class ReduceTableInsertBatch
+{
+public:
+    using TableItem = typename Table::TableItem;
+    using IndexResult = decltype(
+        std::declval<const Table&>().calculate_index(
+            std::declval<const TableItem&>()));
+
+    explicit ReduceTableInsertBatch(Table& table)
+        : table_(table) {
+        items_.reserve(BatchSize);
+        indexes_.reserve(BatchSize);
+    }
+
+    //! non-copyable: delete copy-constructor
+    ReduceTableInsertBatch(const ReduceTableInsertBatch&) = delete;
+    //! non-copyable: delete assignment operator
+    ReduceTableInsertBatch& operator = (const ReduceTableInsertBatch&) = delete;
+
+    //! Buffers an item, and inserts the batch if it is full. Returns the
+    //! number of new keys inserted into the table.
+    size_t Insert(const TableItem& kv) {
+        items_.push_back(kv);
+        if (items_.size() >= BatchSize)
+            return Flush();
+        return 0;
+    }
+
+    //! Inserts all buffered items into the table. Returns the number of new
+    //! keys inserted.
+    size_t Flush() {
+        for (const TableItem& kv : items_) {
+            indexes_.push_back(table_.calculate_index(kv));
+            table_.Prefetch(indexes_.back());
+        }
+        size_t new_keys = 0;
+        for (size_t i = 0; i < items_.size(); ++i)
+            new_keys += table_.Insert(items_[i], indexes_[i]);
+
+        items_.clear();
+        indexes_.clear();
+        return new_keys;
+    }
+
+    //! Returns the number of buffered items.
+    size_t size() const { return items_.size(); }
+
+private:
+    //! reduce table to insert into
+    Table& table_;
+
+    //! buffered items
+    std::vector<TableItem> items_;
+
+    //! indexes of the buffered items, calculated in Flush()
+    std::vector<IndexResult> indexes_;
+};
+
 } // namespace core
 } // namespace thrill
 
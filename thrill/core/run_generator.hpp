@@ -0,0 +1,329 @@
+/*******************************************************************************
+ * thrill/core/run_generator.hpp
+ *
+ * Replacement selection run generator for external sorting.
+ *
+ * Part of Project Thrill - http://project-thrill.org
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#pragma once
+#ifndef THRILL_CORE_RUN_GENERATOR_HEADER
+#define THRILL_CORE_RUN_GENERATOR_HEADER
+
+#include <thrill/common/logger.hpp>
+#include <thrill/data/block_pool.hpp>
+#include <thrill/data/file.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace thrill {
+namespace core {
+
+/*!
+ * Forms sorted runs from a sequence of items and writes them into Files
+ * appended to a deque.
+ *
+ * Items are first collected into a buffer of capacity items. If all items fit,
+ * Finish() sorts the buffer and writes a single run, just like sort-then-write.
+ * Once the buffer overflows, the generator switches to replacement selection:
+ * the buffer is turned into a min-heap, and each new item replaces the smallest
+ * item, which is appended to the current run. A new item which is smaller than
+ * the item just written cannot join the current run, it is parked at the end of
+ * the array and the heap shrinks by one. When the heap is empty, the parked
+ * items form the heap of the next run. Hence, on random input, runs are about
+ * twice the capacity long, and presorted input yields a single run.
+ *
+ * The item array grows on demand up to the capacity. Under memory pressure,
+ * signaled via UpdateMemoryPressure(), the capacity is limited once per
+ * pressure episode and grows back to the configured capacity afterwards.
+ */
+template <typename ValueType, typename Compare>
+class RunGenerator
+{
+    static constexpr bool debug = false;
+
+public:
+    RunGenerator(data::BlockPool& block_pool, size_t local_worker_id,
+                 size_t dia_id, std::deque<data::File>& files,
+                 size_t capacity, const Compare& compare = Compare())
+        : block_pool_(block_pool), local_worker_id_(local_worker_id),
+          dia_id_(dia_id), files_(files),
+          max_capacity_(std::max<size_t>(capacity, 1)),
+          capacity_(max_capacity_), compare_(compare) { }
+
+    //! non-copyable: delete copy-constructor
+    RunGenerator(const RunGenerator&) = delete;
+    //! non-copyable: delete assignment operator
+    RunGenerator& operator = (const RunGenerator&) = delete;
+
+    //! Insert an item, which may write the smallest item to the current run.
+    void Insert(ValueType item) {
+        if (!heap_mode_) {
+            if (items_.size() < capacity_) {
+                Append(std::move(item));
+                return;
+            }
+            StartReplacementSelection();
+        }
+        else if (items_.size() < capacity_) {
+            // the capacity grew back after memory pressure: add the item
+            // without writing one.
+            Grow(std::move(item));
+            return;
+        }
+        Replace(std::move(item));
+    }
+
+    /*!
+     * Signal the current memory state, e.g. mem::memory_exceeded, before each
+     * Insert(). The capacity is limited only when the memory limit is first
+     * exceeded, and restored to the configured capacity once the pressure is
+     * gone, such that repeated signals do not shrink the runs further.
+     */
+    void UpdateMemoryPressure(bool memory_exceeded) {
+        if (memory_exceeded == limited_) return;
+        limited_ = memory_exceeded;
+        if (limited_)
+            LimitCapacity();
+        else
+            capacity_ = max_capacity_;
+    }
+
+    /*!
+     * Limit the capacity, e.g. if the memory limit was exceeded. While
+     * collecting items, the capacity is limited to the current number of
+     * items. In replacement selection the heap does not grow anymore, hence it
+     * is shrunk to half its items by writing the smallest ones to the current
+     * run.
+     */
+    void LimitCapacity() {
+        if (!heap_mode_) {
+            capacity_ = std::max<size_t>(items_.size(), 1);
+            return;
+        }
+        capacity_ = std::max<size_t>(items_.size() / 2, 1);
+        Shrink(capacity_);
+    }
+
+    //! Write all remaining items, sorting them with std::sort.
+    void Finish() {
+        Finish([](auto begin, auto end, const Compare& cmp) {
+                   std::sort(begin, end, cmp);
+               });
+    }
+
+    /*!
+     * Write all remaining items, sorting them with sort_function, which is
+     * called like a SortAlgorithm of api::Sort(): sort_function(begin, end,
+     * compare).
+     */
+    template <typename SortFunction>
+    void Finish(const SortFunction& sort_function) {
+        if (!heap_mode_) {
+            if (!items_.empty()) {
+                sort_function(items_.begin(), items_.end(), compare_);
+                StartRun();
+                WriteRange(0, items_.size());
+            }
+        }
+        else {
+            // the heap completes the current run, parked items form the last.
+            sort_function(items_.begin(), items_.begin() + heap_size_,
+                          compare_);
+            WriteRange(0, heap_size_);
+            if (heap_size_ != items_.size()) {
+                sort_function(items_.begin() + heap_size_, items_.end(),
+                              compare_);
+                StartRun();
+                WriteRange(heap_size_, items_.size());
+            }
+        }
+        writer_.Close();
+
+        LOG << "RunGenerator::Finish() total_items=" << total_items_
+            << " num_runs=" << num_runs_;
+
+        std::vector<ValueType>().swap(items_);
+        heap_mode_ = false;
+        heap_size_ = 0;
+    }
+
+    //! number of runs written
+    size_t num_runs() const { return num_runs_; }
+
+    //! number of items written
+    size_t total_items() const { return total_items_; }
+
+    //! current maximum number of items held
+    size_t capacity() const { return capacity_; }
+
+private:
+    //! reference to BlockPool and ids for creating Files
+    data::BlockPool& block_pool_;
+    size_t local_worker_id_;
+    size_t dia_id_;
+
+    //! output Files, one per run
+    std::deque<data::File>& files_;
+    //! Writer to the current run
+    data::File::Writer writer_;
+
+    //! configured maximum number of items held
+    size_t max_capacity_;
+    //! current maximum number of items held, limited under memory pressure
+    size_t capacity_;
+    //! whether the capacity is limited by the current memory pressure episode
+    bool limited_ = false;
+    //! item comparator
+    Compare compare_;
+
+    //! item array: heap in [0,heap_size_) and parked items for the next run
+    std::vector<ValueType> items_;
+    //! whether items_ is organized as heap
+    bool heap_mode_ = false;
+    //! size of the heap in items_
+    size_t heap_size_ = 0;
+
+    //! statistics
+    size_t num_runs_ = 0, total_items_ = 0;
+
+    //! min-heap comparator
+    bool Greater(const ValueType& a, const ValueType& b) const {
+        return compare_(b, a);
+    }
+
+    void MakeHeap() {
+        std::make_heap(items_.begin(), items_.begin() + heap_size_,
+                       [this](const ValueType& a, const ValueType& b) {
+                           return Greater(a, b);
+                       });
+    }
+
+    //! Append an item to items_, growing the array by doubling up to the
+    //! capacity instead of allocating the whole capacity up front.
+    void Append(ValueType&& item) {
+        if (items_.size() == items_.capacity()) {
+            items_.reserve(std::min(
+                                std::max<size_t>(2 * items_.capacity(), 16),
+                                std::max(capacity_, items_.size() + 1)));
+        }
+        items_.emplace_back(std::move(item));
+    }
+
+    //! Add an item in replacement selection without writing one. The item
+    //! joins the heap if it is not smaller than the heap's minimum, which is
+    //! not smaller than the last item written, otherwise it is parked.
+    void Grow(ValueType&& item) {
+        if (heap_size_ == 0 || compare_(item, items_[0])) {
+            Append(std::move(item));
+            if (heap_size_ == 0) {
+                heap_size_ = items_.size();
+                MakeHeap();
+                StartRun();
+            }
+            return;
+        }
+        // move the first parked item to the end to make room in the heap.
+        if (heap_size_ == items_.size()) {
+            Append(std::move(item));
+        }
+        else {
+            Append(std::move(items_[heap_size_]));
+            items_[heap_size_] = std::move(item);
+        }
+        ++heap_size_;
+        std::push_heap(items_.begin(), items_.begin() + heap_size_,
+                       [this](const ValueType& a, const ValueType& b) {
+                           return Greater(a, b);
+                       });
+    }
+
+    void StartRun() {
+        // advise block pool to write out data if necessary
+        block_pool_.AdviseFree(items_.size() * sizeof(ValueType));
+
+        writer_.Close();
+        files_.emplace_back(block_pool_, local_worker_id_, dia_id_);
+        writer_ = files_.back().GetWriter();
+        ++num_runs_;
+    }
+
+    void StartReplacementSelection() {
+        heap_mode_ = true;
+        heap_size_ = items_.size();
+        MakeHeap();
+        StartRun();
+    }
+
+    void WriteRange(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            writer_.Put(items_[i]);
+        total_items_ += end - begin;
+    }
+
+    //! Write the smallest item of the heap and replace it with item.
+    void Replace(ValueType&& item) {
+        auto greater = [this](const ValueType& a, const ValueType& b) {
+                           return Greater(a, b);
+                       };
+
+        // move smallest item to the end of the heap and write it.
+        std::pop_heap(items_.begin(), items_.begin() + heap_size_, greater);
+        ValueType& slot = items_[heap_size_ - 1];
+        writer_.Put(slot);
+        ++total_items_;
+
+        bool next_run = compare_(item, slot);
+        slot = std::move(item);
+
+        if (!next_run) {
+            std::push_heap(items_.begin(), items_.begin() + heap_size_, greater);
+            return;
+        }
+
+        // park item for next run
+        if (--heap_size_ == 0) {
+            heap_size_ = items_.size();
+            MakeHeap();
+            StartRun();
+        }
+    }
+
+    //! Write the smallest items of the heap until only size items remain. The
+    //! parked items form the next run's heap, if the heap runs empty.
+    void Shrink(size_t size) {
+        auto greater = [this](const ValueType& a, const ValueType& b) {
+                           return Greater(a, b);
+                       };
+
+        while (items_.size() > size) {
+            std::pop_heap(items_.begin(), items_.begin() + heap_size_, greater);
+            size_t last = --heap_size_;
+            writer_.Put(items_[last]);
+            ++total_items_;
+
+            // fill the hole with a parked item, which stays parked
+            if (last + 1 != items_.size())
+                items_[last] = std::move(items_.back());
+            items_.pop_back();
+
+            if (heap_size_ == 0 && !items_.empty()) {
+                heap_size_ = items_.size();
+                MakeHeap();
+                StartRun();
+            }
+        }
+    }
+};
+
+} // namespace core
+} // namespace thrill
+
+#endif // !THRILL_CORE_RUN_GENERATOR_HEADER
+
+/******************************************************************************/
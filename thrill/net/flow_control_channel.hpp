@@ -448,6 +448,46 @@ public:
         return local;
     }
 
+    /*!
+     * Broadcasts a value of a copyable type T from one worker thread to all
+     * other worker threads on this host. No network communication is
+     * performed, hence the value need not be serializable: this is used to
+     * share pointers to host-local data.
+     *
+     * \param value The value to broadcast. This value is ignored for each
+     * worker except the origin.
+     *
+     * \param origin Local worker id to broadcast value from.
+     *
+     * \return The value sent by the origin.
+     */
+    template <typename T>
+    T TLX_ATTRIBUTE_WARN_UNUSED_RESULT
+    LocalBroadcast(const T& value, size_t origin = 0) {
+
+        RunTimer run_timer(timer_broadcast_);
+        if (enable_stats || debug) ++count_broadcast_;
+        LOG << "FCC::LocalBroadcast() ENTER count=" << count_broadcast_;
+
+        T local = value;
+
+        size_t step = GetNextStep();
+        SetLocalShared(step, &local);
+
+        barrier_.Await(
+            [&]() {
+                // copy from origin to all others
+                T res = *GetLocalShared<T>(step, origin);
+                for (size_t i = 0; i < thread_count_; i++) {
+                    *GetLocalShared<T>(step, i) = res;
+                }
+            });
+
+        LOG << "FCC::LocalBroadcast() EXIT count=" << count_broadcast_;
+
+        return local;
+    }
+
     /*!
      * Gathers the value of a serializable type T over all workers and
      * provides result to all workers as a shared pointer to a